@@ -0,0 +1,102 @@
+#ifndef BOOT_GRAPH_H
+#define BOOT_GRAPH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define BOOT_WORKERS portNUM_PROCESSORS  // one per core
+#define BOOT_WORKER_STACK 8192           // module init()/start() run on these
+#define BOOT_MAX_PHASES 2
+
+class Module;
+
+/**
+ * Runs one boot phase (init, start) over the modules as a dependency graph
+ * instead of one after another. Edges come from Module::getDependencies()
+ * and getStartsAfter(). Modules whose dependencies have finished are queued
+ * (in priority order) to short-lived workers, one pinned to each core, so a
+ * module blocking in init()/start() (WiFi connecting, the LCD welcome
+ * screen) only delays the modules that depend on it. Finishing a module is
+ * the readiness event for its dependents: the worker that ran it queues
+ * every dependent whose last dependency it was.
+ *
+ * Names that match no module are ignored, and modules in or behind a
+ * dependency cycle lose their edges (both with a warning), so a bad config
+ * never stalls boot. A critical module that fails skips every step not yet
+ * begun, like the old sequential loop did.
+ *
+ * Each run records per module when it started and finished and on which
+ * core, plus the phase's wall time, the sum of the steps (what a sequential
+ * boot would take) and the critical path through the graph.
+ */
+class BootGraph {
+ public:
+  typedef std::function<bool(Module*)> Step;
+
+  BootGraph();
+
+  // Runs step for every module once its dependencies are done; false if a
+  // critical module failed. modules is in priority order.
+  bool run(const char* phase, const std::vector<Module*>& modules, Step step);
+  // Both phases: total/sequential/critical ms, the critical path and per-module timings.
+  void toJson(JsonObject out) const;
+  // One line per phase for the boot log.
+  String summary(const char* phase) const;
+
+ private:
+  struct Node {
+    Module* module;
+    std::vector<uint16_t> deps;
+    std::vector<uint16_t> dependents;
+    uint16_t pending;  // dependencies not finished yet
+    int64_t startUs;
+    int64_t endUs;
+    int8_t core;
+    bool ok;
+    bool skipped;
+  };
+  struct Timing {
+    String name;
+    uint32_t startMs;  // relative to the phase start
+    uint32_t durMs;
+    int8_t core;
+    bool ok;
+    bool skipped;
+  };
+  struct Phase {
+    String name;
+    uint32_t totalMs;
+    uint32_t sequentialMs;
+    uint32_t criticalMs;
+    uint8_t workers;  // 0: ran on the caller
+    bool cycle;
+    std::vector<String> criticalPath;
+    std::vector<Timing> modules;
+  };
+
+  void build(const std::vector<Module*>& modules);
+  void runSequential();
+  static void workerMain(void* arg);
+  void execute(uint16_t idx);
+  void record(const char* phase, int64_t t0, int64_t t1, uint8_t workers);
+
+  std::vector<Node> nodes_;
+  Step step_;
+  QueueHandle_t ready_;        // indices of modules whose dependencies are done
+  SemaphoreHandle_t done_;     // given when the last module finished
+  SemaphoreHandle_t exited_;   // one give per worker on exit
+  portMUX_TYPE lock_;          // pending counts, remaining_, failed_
+  uint16_t remaining_;
+  bool failed_;                // a critical module failed
+  bool cycle_;
+  Phase phases_[BOOT_MAX_PHASES];
+  uint8_t phaseCount_;
+};
+
+#endif
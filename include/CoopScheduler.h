@@ -0,0 +1,62 @@
+#ifndef COOP_SCHEDULER_H
+#define COOP_SCHEDULER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "LatencyHistogram.h"
+
+class Module;
+
+/**
+ * Cooperative deadline scheduler for modules without their own task
+ * (useTask == false); they all share the task that calls runDue(), i.e.
+ * loop(). Each module is kept in a min-heap by due time: runDue() runs every
+ * module whose time has come (drainQueue() then update()) and reschedules it
+ * nextDeadlineMs() after the run started, and waitMs() tells the caller how
+ * long it may sleep. A queued message or pending input makes a module due
+ * at once; notifyWork() wakes the sleeping task for that.
+ *
+ * Lateness (how long after its due time a timed run started) is tracked per
+ * module. A run that took longer than the module's period, or started more
+ * than a whole period late, is counted as an overrun: the module (or one
+ * sharing the task) cannot keep its cadence.
+ */
+class CoopScheduler {
+ public:
+  CoopScheduler();
+
+  // Adds newly eligible modules (run by runner) and drops ones that got a task
+  // or were disabled.
+  void sync(const std::vector<Module*>& modules, TaskHandle_t runner);
+  // Runs every due module; returns how many ran.
+  size_t runDue();
+  // Milliseconds until the next module is due, at most maxMs; 0 if one is due now.
+  uint32_t waitMs(uint32_t maxMs);
+  void toJson(JsonArray out) const;
+
+ private:
+  struct Entry {
+    Module* module;
+    int64_t dueUs;       // INT64_MAX: waits for messages only
+    uint32_t periodMs;   // last nextDeadlineMs() of the module
+    bool woken;          // due because of a message, not its deadline
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t maxRunUs;
+    LatencyHistogram lateness;
+  };
+  struct Later {
+    bool operator()(const Entry& a, const Entry& b) const { return a.dueUs > b.dueUs; }
+  };
+
+  // Pulls modules with queued messages or pending input forward to now.
+  void wakePending(int64_t now);
+  void run(Entry& e, int64_t now);
+
+  std::vector<Entry> heap_;  // min-heap on dueUs
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CORE_PLANNER_H
+#define CORE_PLANNER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+#define CORE_PLAN_PATH "/core_plan.json"
+
+class Module;
+
+/**
+ * Proposes a core for every module task from its measured load (the
+ * module's update/message busy time since boot) so that the two cores end
+ * up evenly loaded. Tasks marked freertos.task.pinned stay where they are,
+ * and so does everything that is not a module task: its load (WiFi, lwIP,
+ * loop(), ...) is taken from the FreeRTOS run-time counters per core when
+ * they are available and counts as a fixed base. Movable tasks are placed
+ * heaviest first on the currently lighter core (ties keep the current core).
+ *
+ * save() writes the proposal to CORE_PLAN_PATH; with system.core_planner
+ * .apply set, coreFor() uses it when the tasks are created on the next boot.
+ */
+class CorePlanner {
+ public:
+  CorePlanner();
+
+  void configure(JsonVariantConst cfg);
+  // Reads the saved plan; false if there is none.
+  bool load();
+  // Core to create taskName on: the saved plan's if applied, else configured.
+  int8_t coreFor(const String& taskName, int8_t configured) const;
+  // Fills out with per-task load, current/proposed core and before/after core utilization.
+  void plan(const std::vector<Module*>& modules, JsonObject out);
+  // Persists the current proposal for the next boot. Refused (false, reason
+  // in *error) unless the base load was measured: without it the plan would
+  // pile movable tasks onto the core running WiFi and lwIP.
+  bool save(const std::vector<Module*>& modules, String* error = nullptr);
+
+ private:
+  struct Item {
+    Module* module;
+    String task;
+    float load;  // percent of one core
+    int8_t core;
+    int8_t proposed;
+    bool pinned;
+  };
+  struct Saved {
+    String task;
+    int8_t core;
+  };
+  // Returns whether the base load per core could be measured.
+  bool compute(const std::vector<Module*>& modules, std::vector<Item>& items, float* before, float* after);
+
+  std::vector<Saved> saved_;
+  bool apply_;
+};
+
+#endif
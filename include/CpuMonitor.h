@@ -0,0 +1,37 @@
+#ifndef CPU_MONITOR_H
+#define CPU_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CPU_MONITOR_MAX_TASKS 32
+
+/**
+ * Per-task and per-core CPU load from the FreeRTOS run-time counters
+ * (uxTaskGetSystemState). Loads cover the interval since the previous
+ * sample() of the same monitor, so each viewer (web API, serial live view)
+ * owns one. A core's load is 100 % minus its idle task's share.
+ *
+ * Needs configUSE_TRACE_FACILITY; without configGENERATE_RUN_TIME_STATS the
+ * tasks are still listed but "run_time_stats" is false and no loads are given.
+ */
+class CpuMonitor {
+ public:
+  CpuMonitor();
+  void sample(JsonObject out);
+
+ private:
+  struct Prev {
+    TaskHandle_t handle;
+    uint32_t runTime;
+  };
+  uint32_t previousRunTime(TaskHandle_t h) const;
+
+  Prev prev_[CPU_MONITOR_MAX_TASKS];
+  size_t prevCount_;
+  uint32_t prevTotal_;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef EVAL_VM_H
+#define EVAL_VM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define EVAL_REGISTERS 32
+#define EVAL_MAX_STEPS 512      // longest program; a run is aborted after this many instructions
+#define EVAL_MAX_FMT_ARGS 4
+#define EVAL_OUTPUT_MAX 64      // bytes of result text, including the terminator
+
+/**
+ * Where a program reads and writes its $parameters. ModuleRegistry binds it
+ * to the call's DynamicJsonDocument; a missing parameter reads as 0.
+ */
+class EvalEnv {
+ public:
+  virtual ~EvalEnv() {}
+  virtual bool get(const char* name, float& out) = 0;
+  virtual void set(const char* name, float value) = 0;
+};
+
+enum EvalStatus : uint8_t { EVAL_OK = 0, EVAL_FAILED, EVAL_STEP_LIMIT };
+
+/**
+ * Small glue language for EVAL registry functions, compiled once into
+ * bytecode for a register machine (EVAL_REGISTERS floats). A run touches no
+ * heap: registers and the result buffer live on the stack.
+ *
+ *   c = ($f - 32) * 5 / 9
+ *   if (c > $limit) { $alarm = 1; return fmt("HOT %.1f C", c) }
+ *   return c >= 0 ? c : 0
+ *
+ * Statements: `name = expr`, `$param = expr`, `if (expr) ... [else ...]`
+ * with blocks in braces, `return expr | "text" | fmt("...", expr...)` and
+ * `fail`; `;` or a newline separates them. Expressions: float literals,
+ * true/false, $params, locals, + - * / %, comparisons, && || ! (values are
+ * 0/1), `c ? a : b`, and min max abs round floor ceil sqrt clamp. fmt()
+ * takes up to EVAL_MAX_FMT_ARGS %f/%e/%g conversions. There are no loops and
+ * jumps only go forward, so no run executes more instructions than the
+ * program holds (at most EVAL_MAX_STEPS).
+ */
+class EvalProgram {
+ public:
+  EvalProgram() : registers_(0) {}
+
+  // Replaces any previous program; false with error() set on a syntax error.
+  bool compile(const char* source);
+  bool valid() const { return !code_.empty(); }
+  const std::string& error() const { return error_; }
+  size_t instructions() const { return code_.size(); }
+
+  // out receives the returned value as text ("" if nothing was returned).
+  EvalStatus run(EvalEnv& env, char* out, size_t outSize) const;
+
+  struct Instr {
+    uint8_t op;
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+  };
+
+ private:
+  friend class EvalCompiler;
+
+  std::vector<Instr> code_;
+  std::vector<float> consts_;
+  std::vector<uint16_t> strings_;  // offsets into pool_: names, literals, formats
+  std::string pool_;
+  uint8_t registers_;              // registers the program uses
+  std::string error_;
+};
+
+#endif
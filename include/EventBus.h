@@ -0,0 +1,69 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "FreeRTOSTypes.h"
+#include "TypedPayload.h"
+
+#define EVENT_BUS_MAX_TOPICS 16
+#define EVENT_BUS_MAX_SUBSCRIBERS 8
+#define EVENT_BUS_PAYLOAD_SLOTS 16
+
+class Module;
+
+/**
+ * Topic-based publish/subscribe on top of the module queues. A subscriber
+ * names the call it wants a topic delivered as (e.g. "radar/sample" ->
+ * "lcd_radar_update"); a publish copies the typed value once into a
+ * reference-counted SharedPayload and queues one pooled message per
+ * subscriber pointing at it. Delivery goes through QueueBase::send, so
+ * subscriber mailboxes and batching apply unchanged.
+ */
+class EventBus {
+ public:
+  EventBus();
+
+  bool subscribe(const String& topic, Module* subscriber, const String& callName);
+  bool unsubscribe(const String& topic, Module* subscriber);
+
+  // Returns the number of subscribers the value was queued for.
+  size_t publish(SymbolId topicId, const void* data, uint16_t size, const String& from);
+  template <typename T>
+  size_t publish(SymbolId topicId, const T& value, const String& from) {
+    static_assert(std::is_trivially_copyable<T>::value, "bus payloads are copied bytewise");
+    static_assert(sizeof(T) <= SHARED_PAYLOAD_MAX, "bus payload exceeds SHARED_PAYLOAD_MAX");
+    return publish(topicId, &value, (uint16_t)sizeof(T), from);
+  }
+
+  void releasePayload(SharedPayload* p);
+  void toJson(JsonObject out) const;
+
+ private:
+  struct Subscriber {
+    Module* module;
+    SymbolId callId;
+  };
+  struct Topic {
+    SymbolId id;
+    uint8_t subscriberCount;
+    Subscriber subscribers[EVENT_BUS_MAX_SUBSCRIBERS];
+    uint32_t published;
+    uint32_t delivered;
+    uint32_t dropped;
+  };
+
+  Topic* findTopic(SymbolId id);
+  SharedPayload* allocPayload();
+
+  Topic topics_[EVENT_BUS_MAX_TOPICS];
+  size_t topicCount_;
+  SharedPayload payloads_[EVENT_BUS_PAYLOAD_SLOTS];
+  uint8_t freePayloads_[EVENT_BUS_PAYLOAD_SLOTS];
+  size_t freeTop_;
+  uint32_t payloadExhausted_;
+  mutable portMUX_TYPE lock_;
+};
+
+#endif
@@ -7,7 +7,7 @@ struct FSDefault { const char* path; const char* content; };
 
 static const FSDefault FS_DEFAULTS[] = {
     {"/config_example.json", "{\n  \"version\": \"1.0.0\",\n  \"fileSystem\": {\n    \"maxSize\": 2097152,\n    \"comment\": \"2 MB\"\n  },\n  \"logSystem\": {\n    \"maxSize\": 1048576,\n    \"comment\": \"1 MB\"\n  }\n}"},
-    {"/config.json", "{\n  \"version\": \"1.0.0\",\n  \"filesystem\": {\n    \"max_size\": 2097152,\n    \"comment\": \"2 MB default\"\n  },\n  \"log_system\": {\n    \"max_size\": 1048576,\n    \"comment\": \"1 MB default\"\n  },\n  \"modules\": {\n    \"CONTROL_FS\": {\n      \"state\": \"enabled\",\n      \"priority\": 100,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.1\",\n      \"critical\": true,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_FS_TASK\",\n          \"stack\": 4096,\n          \"priority\": 3,\n          \"core\": 0,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": false,\n          \"length\": 8,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 100\n        }\n      }\n    },\n    \"CONTROL_WIFI\": {\n      \"state\": \"enabled\",\n      \"priority\": 90,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": true,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_WIFI_TASK\",\n          \"stack\": 4096,\n          \"priority\": 4,\n          \"core\": 0,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": false,\n          \"length\": 8,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 100\n        }\n      }\n    },\n    \"CONTROL_LCD\": {\n      \"state\": \"enabled\",\n      \"priority\": 85,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": true,\n      \"version\": \"1.0.1\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_LCD_TASK\",\n          \"stack\": 4096,\n          \"priority\": 3,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000\n        }\n      }\n    },\n    \"CONTROL_SERIAL\": {\n      \"state\": \"enabled\",\n      \"priority\": 80,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_SERIAL_TASK\",\n          \"stack\": 4096,\n          \"priority\": 2,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000\n        }\n      }\n    },\n    \"CONTROL_WEB\": {\n      \"state\": \"enabled\",\n      \"priority\": 75,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_WEB_TASK\",\n          \"stack\": 8192,\n          \"priority\": 3,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000\n        }\n      }\n    },\n    \"CONTROL_RADAR\": {\n      \"state\": \"enabled\",\n      \"priority\": 50,\n      \"autostart\": false,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_RADAR_TASK\",\n          \"stack\": 4096,\n          \"priority\": 2,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000\n        }\n      }\n    }\n  }\n}"},
+    {"/config.json", "{\n  \"version\": \"1.0.0\",\n  \"filesystem\": {\n    \"max_size\": 2097152,\n    \"comment\": \"2 MB default\"\n  },\n  \"log_system\": {\n    \"max_size\": 1048576,\n    \"comment\": \"1 MB default\"\n  },\n  \"modules\": {\n    \"CONTROL_FS\": {\n      \"state\": \"enabled\",\n      \"priority\": 100,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.1\",\n      \"critical\": true,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_FS_TASK\",\n          \"stack\": 4096,\n          \"priority\": 3,\n          \"core\": 0,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": false,\n          \"length\": 8,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 100\n        }\n      }\n    },\n    \"CONTROL_WIFI\": {\n      \"state\": \"enabled\",\n      \"priority\": 90,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": true,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_WIFI_TASK\",\n          \"stack\": 4096,\n          \"priority\": 4,\n          \"core\": 0,\n          \"pinned\": true,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": false,\n          \"length\": 8,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 100\n        }\n      }\n    },\n    \"CONTROL_LCD\": {\n      \"state\": \"enabled\",\n      \"priority\": 85,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": true,\n      \"version\": \"1.0.1\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_LCD_TASK\",\n          \"stack\": 4096,\n          \"priority\": 3,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000,\n          \"batch_size\": 16,\n          \"batch_budget_us\": 8000,\n          \"mailbox\": [\"lcd_radar_update\"],\n          \"policy\": \"drop_oldest\",\n          \"urgent\": [\"lcd_boot_step\", \"lcd_status\"]\n        }\n      }\n    },\n    \"CONTROL_SERIAL\": {\n      \"state\": \"enabled\",\n      \"priority\": 80,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_SERIAL_TASK\",\n          \"stack\": 4096,\n          \"priority\": 2,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000\n        }\n      }\n    },\n    \"CONTROL_WEB\": {\n      \"state\": \"enabled\",\n      \"priority\": 75,\n      \"autostart\": true,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_WEB_TASK\",\n          \"stack\": 8192,\n          \"priority\": 3,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000,\n          \"mailbox\": [\"web_radar_update\"]\n        }\n      }\n    },\n    \"CONTROL_RADAR\": {\n      \"state\": \"enabled\",\n      \"priority\": 50,\n      \"autostart\": false,\n      \"test\": true,\n      \"debug\": false,\n      \"version\": \"1.0.0\",\n      \"critical\": false,\n      \"freertos\": {\n        \"task\": {\n          \"name\": \"CONTROL_RADAR_TASK\",\n          \"stack\": 4096,\n          \"priority\": 2,\n          \"core\": 1,\n          \"enabled\": true\n        },\n        \"queue\": {\n          \"enabled\": true,\n          \"length\": 16,\n          \"send_timeout_ms\": 1000,\n          \"recv_timeout_ms\": 1000,\n          \"allow_isr\": true\n        }\n      }\n    }\n  }\n}"},
     {"/cfg/CONTROL_FS.json", "{\n  \"max_size\": 2097152,\n  \"log_max_size\": 1048576,\n  \"auto_format\": false,\n  \"enable_cache\": true\n}"},
     {"/cfg/CONTROL_LCD.json", "{\n  \"brightness\": 255,\n  \"backlight_on\": true,\n  \"width\": 170,\n  \"height\": 320,\n  \"rotation\": 0,\n  \"pins\": {\n    \"mosi\": 23,\n    \"sclk\": 18,\n    \"cs\": 15,\n    \"dc\": 2,\n    \"rst\": 4,\n    \"blk\": 32\n  }\n}"},
     {"/cfg/CONTROL_MEASURE.json", "{\n  \"type\": 0,\n  \"pin_sensor\": 34,\n  \"pin_led\": 25,\n  \"queue_speed\": 1000,\n  \"led_blink_interval\": 500,\n  \"max_queue_size\": 100,\n  \"description\": \"Measurement module - MBT2 or DIBL1\"\n}"},
@@ -6,16 +6,37 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include <vector>
+#include <atomic>
+#include "SymbolTable.h"
 
 enum EventType { EVENT_NONE = 0, EVENT_DATA_READY, EVENT_PROCESS_DONE, EVENT_ACK };
 enum CallType { CALL_NONE = 0, CALL_FUNCTION_SYNC, CALL_FUNCTION_ASYNC, CALL_VARIABLE_GET, CALL_VARIABLE_SET, CALL_RECEIVE_RETURN };
 
+class MessagePool;
+
 struct TaskConfig {
   String name;
   uint32_t stackSize;
   UBaseType_t priority;
   void* params;
   int8_t core;
+  bool pinned;  // the core planner must not move this task
+};
+
+// What QueueBase::send() does when the queue is full.
+enum QueuePolicy : uint8_t {
+  QUEUE_POLICY_BLOCK = 0,    // wait up to sendTimeoutTicks, then drop the new message
+  QUEUE_POLICY_DROP_NEWEST,  // never wait, drop the new message
+  QUEUE_POLICY_DROP_OLDEST,  // never wait, discard the oldest queued message to make room
+  QUEUE_POLICY_COALESCE      // every call is last-value-wins (mailbox), overflow falls back to drop-newest
+};
+
+// Priority lane of a queued message; the consumer drains urgent before bulk.
+enum QueueLane : uint8_t {
+  QUEUE_LANE_BULK = 0,
+  QUEUE_LANE_URGENT,
+  QUEUE_LANE_COUNT
 };
 
 struct QueueConfig {
@@ -24,26 +45,72 @@ struct QueueConfig {
   TickType_t sendTimeoutTicks;
   TickType_t recvTimeoutTicks;
   bool allowISR;
+  size_t payloadSize;
+  size_t batchSize;         // messages per receiveBatch by the runner, at least 1
+  uint32_t batchBudgetUs;   // keep draining batches until empty or budget spent, 0 = one batch per wake
+  std::vector<String> mailbox;  // callNames delivered last-value-wins instead of queued
+  QueuePolicy policy;
+  std::vector<String> urgent;  // callNames always sent on the urgent lane
+  size_t urgentLength;         // depth of the urgent lane, 0 = bulk lane only
+};
+
+const char* queuePolicyName(QueuePolicy p);
+// QUEUE_POLICY_BLOCK for unknown names.
+QueuePolicy queuePolicyFromName(const String& name);
+
+#define QUEUE_BATCH_MAX 32
+#define QUEUE_PAYLOAD_INLINE 64
+#define SHARED_PAYLOAD_MAX 128
+
+// Typed payload published once on the EventBus and referenced by every
+// subscriber's message; returned to the bus when the last reference drops.
+struct SharedPayload {
+  std::atomic<uint16_t> refs;
+  uint16_t size;
+  alignas(8) uint8_t data[SHARED_PAYLOAD_MAX];
 };
+void sharedPayloadRelease(SharedPayload* p);
 
 struct QueueMessage {
-  String eventUUID;
+  uint32_t eventId;  // monotonic, assigned by QueueBase::send() when 0
   String toQueue;
   String fromQueue;
   EventType eventType;
   CallType callType;
   String callName;
   DynamicJsonDocument* callVariables;
+  MessagePool* pool;  // owning pool, nullptr for heap-allocated messages
+  SymbolId toId;      // interned toQueue, set by the owning pool
+  SymbolId callId;    // interned callName, SYMBOL_NONE if only callName is set
+  uint16_t payloadSize;  // bytes of typed payload in payload[], 0 = callVariables only
+  alignas(8) uint8_t payload[QUEUE_PAYLOAD_INLINE];
+  SharedPayload* shared;  // bus payload shared with other subscribers, takes precedence over payload[]
+  uint64_t correlationId;  // Rpc call this message belongs to, 0 = not an Rpc request
+  int64_t enqueuedUs;      // esp_timer time of the last send(), for queue-wait tracing
+  QueueLane lane;          // bulk unless set by the sender or the queue's urgent list
 };
 
-static inline String genUUID4() {
-  uint32_t r1 = esp_random();
-  uint32_t r2 = esp_random();
-  uint32_t r3 = esp_random();
-  uint32_t r4 = esp_random();
-  char buf[37];
-  snprintf(buf, sizeof(buf), "%08lx-%04lx-%04lx-%04lx-%08lx", (unsigned long)r1, (unsigned long)(r2 & 0xFFFF), (unsigned long)((r2 >> 16) & 0xFFFF), (unsigned long)(r3 & 0xFFFF), (unsigned long)r4);
-  return String(buf);
+// Next message event ID: one relaxed atomic increment (IDs wrap after 2^32 messages, never 0).
+inline uint32_t queueNextEventId() {
+  static std::atomic<uint32_t> next(1);
+  uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+  return id ? id : next.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Typed payload bytes of msg (shared or inline), nullptr if it only has callVariables.
+static inline const uint8_t* queueMessagePayloadData(const QueueMessage* msg, uint16_t& size) {
+  if (msg->shared) { size = msg->shared->size; return msg->shared->data; }
+  size = msg->payloadSize;
+  return size ? msg->payload : nullptr;
+}
+
+// Set callName and its interned ID from a string literal (hash computed at compile time).
+#define QUEUE_MESSAGE_CALL(msg, lit) do { (msg)->callName = lit; (msg)->callId = SYMBOL_ID(lit); } while (0)
+
+// Interned callName of a message, resolving and caching it for messages built by name only.
+static inline SymbolId queueMessageCallId(QueueMessage* msg) {
+  if (msg->callId == SYMBOL_NONE) msg->callId = SymbolTable::global().intern(msg->callName.c_str());
+  return msg->callId;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef JSON_EVAL_ENV_H
+#define JSON_EVAL_ENV_H
+
+#include <ArduinoJson.h>
+#include "EvalVm.h"
+
+// Binds an EVAL program's $parameters to the call's JSON document.
+class JsonEvalEnv : public EvalEnv {
+ public:
+  explicit JsonEvalEnv(DynamicJsonDocument* doc) : doc_(doc) {}
+  bool get(const char* name, float& out) override {
+    if (!doc_) return false;
+    JsonVariantConst v = doc_->as<JsonVariantConst>()[name];
+    if (v.isNull()) return false;
+    out = v.is<bool>() ? (v.as<bool>() ? 1.0f : 0.0f) : v.as<float>();
+    return true;
+  }
+  void set(const char* name, float value) override {
+    // A char* key is copied into the document's pool, so it may outlive the program
+    if (doc_) (*doc_)[const_cast<char*>(name)] = value;
+  }
+ private:
+  DynamicJsonDocument* doc_;
+};
+
+#endif
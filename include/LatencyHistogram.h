@@ -0,0 +1,64 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <string.h>
+
+// Bucket 0 counts 0 us, bucket i (i >= 1) counts [2^(i-1), 2^i) us; the last
+// bucket is open-ended (>= 2^(LATENCY_BUCKETS-2) us, about 0.5 s).
+#define LATENCY_BUCKETS 21
+
+/**
+ * Log2-bucketed latency histogram in microseconds. record() is a count-leading
+ * zeros and two increments, so it can sit on the message path. Percentiles are
+ * reported as the upper bound of the bucket they fall in (capped at the exact
+ * maximum), i.e. within a factor of two of the true value.
+ *
+ * Single writer; readers on other tasks may see a sample half-recorded, which
+ * only matters for the instant it is read.
+ */
+struct LatencyHistogram {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+  static uint8_t bucketOf(uint32_t us) {
+    uint8_t b = us ? (uint8_t)(32 - __builtin_clz(us)) : 0;
+    return b < LATENCY_BUCKETS ? b : LATENCY_BUCKETS - 1;
+  }
+
+  void record(uint32_t us) {
+    buckets[bucketOf(us)]++;
+    count++;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // pct in 1..100; 0 if nothing was recorded.
+  uint32_t percentile(uint32_t pct) const {
+    if (count == 0) return 0;
+    uint64_t target = ((uint64_t)count * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+      seen += buckets[b];
+      if (seen >= target) {
+        uint32_t upper = b == 0 ? 0 : (b == LATENCY_BUCKETS - 1 ? maxUs : (1u << b) - 1);
+        return upper < maxUs ? upper : maxUs;
+      }
+    }
+    return maxUs;
+  }
+
+  // count, p50, p95, p99 and max (us).
+  void toJson(JsonObject out) const {
+    out["count"] = count;
+    out["p50"] = percentile(50);
+    out["p95"] = percentile(95);
+    out["p99"] = percentile(99);
+    out["max"] = maxUs;
+  }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "FreeRTOSTypes.h"
+
+#define MAILBOX_MAX_KEYS 8
+
+/**
+ * Last-value-wins channel attached to a QueueBase. Each key is a callId on the
+ * owning queue; posting replaces whatever is still pending for that key and the
+ * consumer only ever receives the newest message. Suited to state snapshots
+ * (e.g. radar telemetry) where intermediate values have no meaning.
+ */
+class Mailbox {
+ public:
+  Mailbox();
+
+  bool addKey(SymbolId callId);
+  bool accepts(SymbolId callId) const;
+  size_t keyCount() const { return count_; }
+  // Stores msg as the pending value for its callId. Returns the message it
+  // displaced (caller recycles it) or nullptr.
+  QueueMessage* post(QueueMessage* msg);
+  // Moves up to maxCount pending messages into out.
+  size_t take(QueueMessage** out, size_t maxCount);
+  size_t pending() const;
+  void toJson(JsonObject out) const;
+
+ private:
+  struct Slot {
+    SymbolId callId;
+    QueueMessage* pending;
+    uint32_t posted;
+    uint32_t coalesced;
+    uint32_t delivered;
+  };
+  Slot slots_[MAILBOX_MAX_KEYS];
+  size_t count_;
+  mutable portMUX_TYPE lock_;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MESSAGE_POOL_H
+#define MESSAGE_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "FreeRTOSTypes.h"
+
+/**
+ * Fixed-capacity slab of QueueMessage objects and their payload documents.
+ * Messages are allocated once when the pool is created; payload documents are
+ * allocated the first time their slot is handed out and then kept for the
+ * lifetime of the pool, so steady-state traffic never touches the heap.
+ * acquire()/release() are safe to call from any task on either core.
+ */
+class MessagePool {
+ public:
+  MessagePool(size_t count, size_t payloadSize);
+  ~MessagePool();
+
+  bool create(const String& toQueue);
+  void destroy();
+  QueueMessage* acquire();
+  void release(QueueMessage* msg);
+  bool owns(const QueueMessage* msg) const;
+
+  size_t capacity() const { return count_; }
+  size_t payloadSize() const { return payloadSize_; }
+  size_t inUse() const { return inUse_; }
+  size_t highWater() const { return highWater_; }
+  uint32_t acquired() const { return acquired_; }
+  uint32_t exhausted() const { return exhausted_; }
+  void toJson(JsonObject out) const;
+
+ private:
+  size_t count_;
+  size_t payloadSize_;
+  QueueMessage* slab_;
+  DynamicJsonDocument** docs_;
+  uint16_t* freeList_;
+  size_t freeTop_;
+  size_t inUse_;
+  size_t highWater_;
+  uint32_t acquired_;
+  uint32_t exhausted_;
+  portMUX_TYPE lock_;
+};
+
+#endif
@@ -55,8 +55,8 @@ public:
         queueBase = nullptr;
         useTask = true;
         useQueue = false;
-        taskCfg = {String(name) + String("_TASK"), 4096, 3, nullptr, -1};
-        queueCfg = {8, sizeof(QueueMessage*), portMAX_DELAY, pdMS_TO_TICKS(100), false};
+        taskCfg = {String(name) + String("_TASK"), 4096, 3, nullptr, -1, false};
+        queueCfg = {8, sizeof(QueueMessage*), portMAX_DELAY, pdMS_TO_TICKS(100), false, 256, 8, 0, {}, QUEUE_POLICY_DROP_NEWEST, {}, 4};
     }
     
     virtual ~ModuleBase() {
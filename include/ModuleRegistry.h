@@ -5,20 +5,42 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include <map>
 #include <vector>
 #include <functional>
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "SymbolTable.h"
+#include "FreeRTOSTypes.h"
+#include "TypedPayload.h"
+#include "EventBus.h"
+#include "Rpc.h"
+#include "ReadMostly.h"
+#include "VarStore.h"
+#include "EvalVm.h"
 
-struct JsonVarTemplate {
-  String n;
-  DynamicJsonDocument* v;
-  String t;
-  size_t s;
-  uint32_t c;
+#define REGISTRY_SLOT_CHUNK 16   // function slots allocated at a time
+#define REGISTRY_MAX_CHUNKS 32   // up to 512 functions
+
+// Slot of a registered function in the registry's flat table. Stable for the
+// life of the process: registering the same module:function again returns the
+// same handle, and after unregisterFunction() calls through it simply fail.
+struct FunctionHandle {
+  int16_t slot;
+  bool valid() const { return slot >= 0; }
 };
 
+/**
+ * Directory of module tasks, queues and callable functions. The
+ * tables are read on every dispatch from tasks on both cores and written at
+ * registration. Tasks, queues and the module:function index sit in ReadMostly
+ * snapshots, held only for the lookup. Function entries live in slots that
+ * are never freed or moved; a call pins its slot with an in-flight count
+ * instead of holding a snapshot, so registering other functions never waits
+ * for a running handler. Re-registering a function waits for that
+ * function's own calls to finish, so a handler must not re-register itself.
+ */
 class ModuleRegistry {
  public:
   static ModuleRegistry* getInstance();
@@ -26,47 +48,110 @@ class ModuleRegistry {
   void registerQueue(const String& moduleName, QueueHandle_t handle);
   TaskHandle_t findTask(const String& moduleName);
   QueueHandle_t findQueue(const String& moduleName);
-  void setVar(const String& cls, const String& var, const JsonVarTemplate& tmpl);
-  bool getVar(const String& cls, const String& var, JsonVarTemplate& out);
   void toJson(DynamicJsonDocument& doc);
   String exportJson();
   bool importJson(const String& json);
-  enum FunctionsCallType { NAME = 0, POINTER = 1, DYNAMIC = 2, EVAL = 3 };
+  enum FunctionsCallType { NAME = 0, POINTER = 1, DYNAMIC = 2, EVAL = 3, TYPED = 4 };
+  typedef std::function<bool(void*, const void*, String&)> TypedFunction;
   std::vector<String> getFunctionsForModule(const String& moduleName);
-  bool registerFunctionName(const String& moduleName, const String& functionName, const String& handleName);
-  bool registerFunctionPointer(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn);
-  bool registerFunctionDynamic(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn);
-  bool registerFunctionEval(const String& moduleName, const String& functionName, const String& code);
+  // Each returns the function's handle (invalid if registration failed).
+  FunctionHandle registerFunctionName(const String& moduleName, const String& functionName, const String& handleName);
+  FunctionHandle registerFunctionPointer(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn);
+  FunctionHandle registerFunctionDynamic(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn);
+  // Compiles code once (EvalVm.h); on a syntax error returns an invalid handle and sets *error.
+  FunctionHandle registerFunctionEval(const String& moduleName, const String& functionName, const String& code, String* error = nullptr);
+  // Handler taking a typed payload T (see TypedPayload.h); JSON callers are adapted via PayloadTraits<T>.
+  template <typename T>
+  FunctionHandle registerFunctionTyped(const String& moduleName, const String& functionName, std::function<bool(void*, const T&, String&)> fn) {
+    SymbolId fid = SymbolTable::global().intern(functionName.c_str());
+    if (!TypedPayloads::global().registerType<T>(fid)) return FunctionHandle{-1};
+    TypedFunction erased = [fn](void* ctx, const void* p, String& r) { return fn(ctx, *static_cast<const T*>(p), r); };
+    return functions_.moduleNameFunctionRegister(moduleName, functionName, String(), TYPED, nullptr, String(), erased);
+  }
+  // Resolves a name once for callers that did not register the function themselves.
+  FunctionHandle findFunction(const String& moduleName, const String& functionName) const;
+  // Hot path: one bounds check and an index, no lookup and no allocation.
+  bool call(FunctionHandle h, DynamicJsonDocument* params, String& result);
+  // Same for a queued message, e.g. a module dispatching its own hot calls.
+  bool call(FunctionHandle h, QueueMessage* msg, String& result);
+  // By name, for the serial/web func commands.
   bool callFunction(const String& moduleName, const String& functionName, DynamicJsonDocument* params, String& result);
+  bool callFunction(SymbolId moduleId, SymbolId functionId, DynamicJsonDocument* params, String& result);
+  // Queue dispatch: typed payloads go straight to TYPED handlers and are converted to JSON only for JSON handlers.
+  bool callFunction(SymbolId moduleId, QueueMessage* msg, String& result);
   bool unregisterFunction(const String& moduleName, const String& functionName);
+  // Deactivates every function of a module about to be deleted and drops the
+  // cached module pointer; returns once no call is still running in it.
+  void unregisterModuleFunctions(SymbolId moduleId);
   bool isFunctionRegistered(const String& moduleName, const String& functionName);
+  // Topic publish/subscribe between modules
+  EventBus& bus() { return bus_; }
+  // Request/response calls executed on the target module's task
+  Rpc& rpc() { return rpc_; }
+  // Typed cross-module variables, readable without locks
+  VarStore& vars() { return vars_; }
  private:
   ModuleRegistry();
   static ModuleRegistry* instance_;
-  std::map<String, TaskHandle_t> tasks_;
-  std::map<String, QueueHandle_t> queues_;
-  std::map<String, std::map<String, JsonVarTemplate>> vars_;
+  struct Directory {
+    std::map<String, TaskHandle_t> tasks;
+    std::map<String, QueueHandle_t> queues;
+  };
+  ReadMostly<Directory> dir_;
+  EventBus bus_;
+  Rpc rpc_;
+  VarStore vars_;
   struct FunctionEntry {
+    FunctionEntry() : callType(NAME), moduleId(SYMBOL_NONE), functionId(SYMBOL_NONE), ctx(nullptr), active(false), calls(0) {}
     String moduleName;
     String functionName;
     String handleName;
     FunctionsCallType callType;
     std::function<bool(void*, DynamicJsonDocument*, String&)> func;
     String evalCode;
+    EvalProgram program;  // compiled evalCode
+    TypedFunction typedFunc;
+    SymbolId moduleId;
+    SymbolId functionId;
+    void* ctx;
+    // Fields above change only while active is false and calls is 0
+    std::atomic<bool> active;
+    std::atomic<uint16_t> calls;  // calls running in this entry
   };
  public:
   class Functions {
    public:
-    bool moduleNameFunctionRegister(const String& moduleName, const String& functionName, const String& handleName, FunctionsCallType type, std::function<bool(void*, DynamicJsonDocument*, String&)> fn, const String& evalCode);
+    Functions();
+    FunctionHandle moduleNameFunctionRegister(const String& moduleName, const String& functionName, const String& handleName, FunctionsCallType type, std::function<bool(void*, DynamicJsonDocument*, String&)> fn, const String& evalCode, TypedFunction typedFn = nullptr, const EvalProgram* program = nullptr);
+    FunctionHandle handleOf(SymbolId moduleId, SymbolId functionId) const;
+    bool handleCall(FunctionHandle h, DynamicJsonDocument* params, String& result);
+    bool handleMessageCall(FunctionHandle h, QueueMessage* msg, String& result);
     bool moduleNameFunctionCall(const String& moduleName, const String& functionName, DynamicJsonDocument* params, String& result);
-    bool has(const String& key) const;
-    FunctionEntry get(const String& key) const;
+    bool moduleIdFunctionCall(SymbolId moduleId, SymbolId functionId, DynamicJsonDocument* params, String& result);
+    bool moduleIdMessageCall(SymbolId moduleId, QueueMessage* msg, String& result);
     std::vector<String> listModuleFunctions(const String& moduleName) const;
     bool remove(const String& moduleName, const String& functionName);
+    void removeModule(SymbolId moduleId);
     bool contains(const String& moduleName, const String& functionName) const;
    private:
-    std::map<String, FunctionEntry> entries_;
-    static String keyOf(const String& moduleName, const String& functionName);
+    // index[moduleId][functionId] is the entry slot or -1. Slots are
+    // append-only, so a slot (FunctionHandle) never moves to another function.
+    struct Table {
+      std::vector<std::vector<int16_t>> index;
+      int16_t find(SymbolId moduleId, SymbolId functionId) const;
+    };
+    ReadMostly<Table> table_;  // also serializes writers
+    std::atomic<FunctionEntry*> chunks_[REGISTRY_MAX_CHUNKS];
+    std::atomic<uint16_t> count_;  // slots in use
+
+    FunctionEntry* slot(int16_t s) const;
+    int16_t lookup(SymbolId moduleId, SymbolId functionId) const;
+    // Pins an active entry against re-registration for the duration of a call.
+    FunctionEntry* pin(int16_t s) const;
+    static void unpin(FunctionEntry* fe) { fe->calls.fetch_sub(1, std::memory_order_release); }
+    static void waitForCalls(const FunctionEntry* fe);
+    bool invoke(const FunctionEntry& fe, DynamicJsonDocument* params, String& result);
+    bool invokeMessage(const FunctionEntry& fe, QueueMessage* msg, String& result);
   };
   Functions functions_;
 };
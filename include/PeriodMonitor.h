@@ -0,0 +1,79 @@
+#ifndef PERIOD_MONITOR_H
+#define PERIOD_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "LatencyHistogram.h"
+
+#define PERIOD_MONITOR_MAX_ACTIVITIES 16
+
+/**
+ * One periodic activity of a module (a sensor sample, a motor step) with the
+ * period it is supposed to keep. The owner calls tick() each time the
+ * activity actually fires; the interval since the previous tick is compared
+ * with the period and the difference recorded as jitter, late and early
+ * separately. A tick more than toleranceUs late is a deadline miss.
+ *
+ * tick() is the owner's only cost: a timer read and a histogram record.
+ * Changing the period or pausing (the activity stopped on purpose) starts a
+ * new series, so the gap is not counted against it. Single writer, like
+ * LatencyHistogram; readers on other tasks may see a tick half-recorded.
+ */
+class PeriodicActivity {
+ public:
+  // toleranceUs 0: a quarter of the period.
+  PeriodicActivity(const char* name, uint32_t periodUs, uint32_t toleranceUs = 0);
+
+  void tick();
+  void setPeriodUs(uint32_t periodUs);
+  void pause() { lastUs_ = 0; }
+  void reset();
+
+  const char* name() const { return name_; }
+  uint32_t periodUs() const { return periodUs_; }
+  uint32_t ticks() const { return ticks_; }
+  uint32_t misses() const { return misses_; }
+  void toJson(JsonObject out) const;
+
+ private:
+  const char* name_;
+  uint32_t periodUs_;
+  uint32_t toleranceUs_;  // 0: periodUs_ / 4
+  int64_t lastUs_;        // 0: next tick starts a series
+  uint32_t ticks_;        // measured intervals
+  uint32_t misses_;
+  uint32_t maxIntervalUs_;
+  LatencyHistogram late_;   // interval - period, when the tick came late
+  LatencyHistogram early_;  // period - interval, when it came early
+};
+
+/**
+ * Registry of the PeriodicActivity objects modules own, for the serial
+ * `system periodic` command and GET /api/system/periodic. Registering only
+ * makes an activity visible; measuring happens in tick().
+ */
+class PeriodMonitor {
+ public:
+  static PeriodMonitor& global();
+
+  // False if the table is full; the activity still measures, it is just not listed.
+  bool add(PeriodicActivity* activity, const char* owner);
+  void remove(PeriodicActivity* activity);
+  void resetAll();
+  void toJson(JsonArray out);
+
+ private:
+  struct Registered {
+    PeriodicActivity* activity;
+    const char* owner;
+  };
+
+  PeriodMonitor();
+
+  Registered entries_[PERIOD_MONITOR_MAX_ACTIVITIES];
+  size_t count_;
+  portMUX_TYPE lock_;
+};
+
+#endif
@@ -3,9 +3,16 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "FreeRTOSTypes.h"
+#include "MessagePool.h"
+#include "Mailbox.h"
+#include "LatencyHistogram.h"
+
+// Calls tracked per queue; further call names share the last (SYMBOL_NONE) entry.
+#define QUEUE_LATENCY_CALLS 8
 
 class Module;
 
@@ -16,15 +23,71 @@ class QueueBase {
 
   bool create();
   bool destroy();
+  // Pooled message addressed to this queue; nullptr when the pool is exhausted.
+  QueueMessage* acquire();
+  // Takes ownership of msg: on failure it is recycled, never leaked. Calls
+  // configured as mailbox keys replace their pending value instead of queueing.
+  // A full queue is handled per cfg.policy (block / drop_newest / drop_oldest /
+  // coalesce); only the block policy ever waits. msg goes on the urgent lane
+  // if msg->lane says so or its call is in cfg.urgent, else on the bulk lane.
   bool send(QueueMessage* msg);
+  // Same, with block policy waiting at most timeout instead of the configured one.
+  bool send(QueueMessage* msg, TickType_t timeout);
   bool receive(QueueMessage*& out);
+  // Receives up to maxCount messages: waits at most firstWait for the first one,
+  // then takes whatever is already queued until maxCount or budgetUs (0 = none) is hit.
+  // Urgent messages always come first, then bulk, then mailbox values. Only the
+  // bulk lane is waited on; module runners wake on notifyWork() for either lane.
+  size_t receiveBatch(QueueMessage** out, size_t maxCount, uint32_t budgetUs, TickType_t firstWait);
+  // True if messages are queued or a mailbox value is pending.
+  bool hasPending() const;
+  // Hands a consumed message back to its pool (heap messages are freed).
+  void recycle(QueueMessage* msg);
+  // Records how long msg's handler ran; called by the consumer task after dispatch.
+  void recordHandled(const QueueMessage* msg, uint32_t handlerUs);
   String id() const;
   void RECEIVE_RETURN_CALL_FUNC(QueueMessage* incoming);
+  MessagePool* pool() { return pool_; }
+  Mailbox* mailbox() { return mailbox_; }
+  const QueueConfig& config() const { return cfg_; }
+  void toJson(JsonObject out) const;
+  // Per-call queue-wait and handler-time percentiles.
+  void latencyToJson(JsonArray out) const;
 
  private:
+  struct CallLatency {
+    SymbolId callId;
+    LatencyHistogram wait;
+    LatencyHistogram handler;
+  };
+  // Producer-side counters are bumped by senders on both cores
+  struct LaneStats {
+    std::atomic<uint32_t> sent;
+    std::atomic<uint32_t> highWater;  // deepest the lane has been right after a send
+  };
+  CallLatency* latencyFor(SymbolId callId);
+  QueueLane laneFor(const QueueMessage* msg) const;
+  bool sendToLane(QueueHandle_t lane, QueueMessage* msg, TickType_t timeout);
+  void recordWait(const QueueMessage* msg, int64_t nowUs);
+
   Module* owner_;
   QueueConfig cfg_;
-  QueueHandle_t queue_;
+  QueueHandle_t queue_;   // bulk lane
+  QueueHandle_t urgent_;  // urgent lane
+  std::vector<SymbolId> urgentCalls_;
+  LaneStats lanes_[QUEUE_LANE_COUNT];
+  MessagePool* pool_;
+  Mailbox* mailbox_;
+  std::atomic<uint32_t> sendFailures_;  // new messages that were not queued
+  std::atomic<uint32_t> dropped_;       // messages discarded by the policy (new or, for drop_oldest, queued)
+  std::atomic<uint32_t> blocked_;       // sends that had to wait for space (block policy)
+  uint32_t batches_;
+  uint32_t batchedMessages_;
+  size_t largestBatch_;
+  // Allocated by create(); entries are filled by the consumer task only and
+  // published to readers on other tasks by the release store of latencyCount_
+  CallLatency* latency_;
+  std::atomic<size_t> latencyCount_;
 };
 
 #endif
@@ -0,0 +1,111 @@
+#ifndef READ_MOSTLY_H
+#define READ_MOSTLY_H
+
+#include <stdint.h>
+#include <atomic>
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+/**
+ * Copy-on-write container for tables that are read on every dispatch and
+ * written a handful of times (registration). Readers take no lock: a Reader
+ * announces itself in the reader count of the current epoch and loads the
+ * published snapshot, which stays valid until the Reader goes out of scope.
+ * Writers are serialized, edit a private copy and publish() it with one
+ * pointer swap; the old snapshot is freed once every reader that could still
+ * see it (those counted under the previous epoch) has left, so nothing is
+ * ever freed under a reader.
+ *
+ * A reader costs two atomic increments and two loads, on either core. A
+ * writer waits for the readers of the old snapshot, so it must never run
+ * inside a Reader of the same container (it would wait for itself).
+ */
+template <typename T>
+class ReadMostly {
+ public:
+  ReadMostly() : current_(new T()), epoch_(0) {
+    readers_[0].store(0);
+    readers_[1].store(0);
+    writer_.clear();
+  }
+  ~ReadMostly() { delete current_.load(); }
+
+  class Reader {
+   public:
+    explicit Reader(const ReadMostly& rm) : rm_(rm) {
+      for (;;) {
+        uint32_t e = rm_.epoch_.load();
+        rm_.readers_[e & 1].fetch_add(1);
+        // A writer flipped the epoch in between: its wait may not have seen
+        // us, so count again under the new one
+        if (rm_.epoch_.load() == e) {
+          parity_ = e & 1;
+          break;
+        }
+        rm_.readers_[e & 1].fetch_sub(1);
+      }
+      snap_ = rm_.current_.load();
+    }
+    ~Reader() { rm_.readers_[parity_].fetch_sub(1, std::memory_order_release); }
+
+    const T& operator*() const { return *snap_; }
+    const T* operator->() const { return snap_; }
+
+   private:
+    Reader(const Reader&);
+    Reader& operator=(const Reader&);
+
+    const ReadMostly& rm_;
+    uint32_t parity_;
+    const T* snap_;
+  };
+
+  // Takes the writer lock and returns a copy of the current snapshot to edit;
+  // finish with publish() or cancel().
+  T* edit() {
+    while (writer_.test_and_set(std::memory_order_acquire)) pause();
+    return new T(*current_.load());
+  }
+
+  // Makes next the snapshot new readers see, frees the old one once its
+  // readers are gone, and releases the writer lock.
+  void publish(T* next) {
+    T* old = current_.exchange(next);
+    uint32_t e = epoch_.fetch_add(1);
+    while (readers_[e & 1].load() != 0) pause();
+    delete old;
+    writer_.clear(std::memory_order_release);
+  }
+
+  void cancel(T* next) {
+    delete next;
+    writer_.clear(std::memory_order_release);
+  }
+
+  // Snapshots published so far.
+  uint32_t versions() const { return epoch_.load(std::memory_order_relaxed); }
+
+ private:
+  ReadMostly(const ReadMostly&);
+  ReadMostly& operator=(const ReadMostly&);
+
+  static void pause() {
+#if defined(ESP_PLATFORM)
+    vTaskDelay(1);  // let a preempted reader (possibly lower priority) finish
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  std::atomic<T*> current_;
+  std::atomic<uint32_t> epoch_;
+  mutable std::atomic<uint32_t> readers_[2];  // readers per epoch parity
+  std::atomic_flag writer_;
+};
+
+#endif
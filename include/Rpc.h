@@ -0,0 +1,92 @@
+#ifndef RPC_H
+#define RPC_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "FreeRTOSTypes.h"
+
+#define RPC_SLOT_BITS 4
+#define RPC_MAX_PENDING (1 << RPC_SLOT_BITS)  // the low bits of a correlation ID are its slot
+#define RPC_DEFAULT_TIMEOUT_MS 2000
+#define RPC_RESULT_HOLD_MS 5000     // finished calls nobody polled are freed this long after their deadline
+
+class Module;
+
+enum RpcStatus : uint8_t { RPC_FREE = 0, RPC_PENDING, RPC_OK, RPC_FAILED, RPC_TIMEOUT, RPC_CANCELLED, RPC_UNKNOWN };
+const char* rpcStatusName(RpcStatus s);
+
+struct RpcHandle {
+  uint64_t id;
+  bool valid() const { return id != 0; }
+};
+
+/**
+ * Request/response calls over module queues. call() queues the function on
+ * the target module's task and returns a handle at once; the target's runner
+ * executes it (Module::drainQueue) and completes the call in the correlation
+ * table, waking the caller. A 64-bit correlation ID is a sequence number with
+ * the table slot in its low bits, so resolving a reply is one index plus one
+ * compare, and a stale ID (cancelled, timed out, reused slot) never matches.
+ *
+ * Every slot is freed deterministically: by the poll() that returns its final
+ * status, by cancel(), or by expire() once RPC_RESULT_HOLD_MS has passed after
+ * its deadline. Replies that arrive after that are counted as late and dropped.
+ */
+class Rpc {
+ public:
+  Rpc();
+
+  // Queues fn on target's task. caller (may be nullptr) is woken via notifyWork()
+  // when the call finishes. Invalid handle if the table is full or the message
+  // could not be queued.
+  RpcHandle call(const String& target, const String& fn, DynamicJsonDocument* args,
+                 uint32_t timeoutMs = RPC_DEFAULT_TIMEOUT_MS, Module* caller = nullptr);
+  // Never blocks. A final status (anything but RPC_PENDING) frees the slot and
+  // moves the function's result into result.
+  RpcStatus poll(RpcHandle h, String* result = nullptr);
+  bool cancel(RpcHandle h);
+  // Target side, run on the target's task for messages carrying a correlation ID.
+  void serve(Module* target, QueueMessage* msg);
+  // Marks overdue calls as timed out and frees unpolled results; returns slots freed.
+  size_t expire();
+  void toJson(JsonObject out);
+
+ private:
+  // A call to a module without a queue, run as a WorkerPool job
+  struct PoolCall {
+    Rpc* rpc;
+    uint64_t id;
+    String target;
+    String fn;
+    DynamicJsonDocument* args;
+  };
+  struct Slot {
+    uint64_t id;
+    RpcStatus status;
+    Module* caller;
+    int64_t deadlineUs;
+    String result;
+  };
+
+  Slot* slotFor(uint64_t id);
+  void complete(uint64_t id, bool ok, const String& result);
+  void freeSlot(Slot& s);
+  static void poolCall(void* arg);
+
+  Slot slots_[RPC_MAX_PENDING];
+  uint64_t nextSeq_;
+  SemaphoreHandle_t lock_;
+  uint32_t calls_;
+  uint32_t ok_;
+  uint32_t failed_;
+  uint32_t timeouts_;
+  uint32_t cancelled_;
+  uint32_t late_;
+  uint32_t rejected_;
+  uint32_t inline_;
+  uint32_t pooled_;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * Sequence-locked value for one writer and any number of readers. The writer
+ * makes the sequence odd, copies the value in and makes it even again;
+ * a reader copies the value out between two loads of the sequence and
+ * retries if they differ or were odd. Readers never block the writer and
+ * take no lock themselves, on either core.
+ *
+ * Writers must be serialized by the caller. On the target they write inside a
+ * critical section, so a write cannot be preempted halfway and a reader's
+ * retry loop is bounded by the length of one copy.
+ */
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock values are copied bytewise");
+
+ public:
+  Seqlock() : seq_(0) { memset(&value_, 0, sizeof(value_)); }
+
+  void write(const T& v) {
+    uint32_t s = seq_.load(std::memory_order_relaxed);
+    seq_.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&value_, &v, sizeof(T));
+    seq_.store(s + 2, std::memory_order_release);
+  }
+
+  // Returns the version the copy belongs to.
+  uint32_t read(T& out) const {
+    for (;;) {
+      uint32_t s1 = seq_.load(std::memory_order_acquire);
+      if (s1 & 1) continue;
+      memcpy(&out, &value_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == s1) return s1 >> 1;
+    }
+  }
+
+  // Completed writes so far.
+  uint32_t version() const { return seq_.load(std::memory_order_acquire) >> 1; }
+
+ private:
+  std::atomic<uint32_t> seq_;
+  T value_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * Lock-free single-producer/single-consumer ring buffer for streaming from an
+ * ISR (or one task) into one consumer task. Unlike xQueueSendFromISR there is
+ * no critical section and no per-item call into the kernel: the producer
+ * writes the slot and publishes it with a release store of head_, the
+ * consumer reads up to head_ with an acquire load and frees slots by
+ * advancing tail_. Indices run freely and are masked, so Capacity must be a
+ * power of two.
+ *
+ * When the ring is full push() drops the new item and counts an overrun; the
+ * producer never touches tail_, which is what keeps it single-writer and safe
+ * to call from an ISR. push() is forced inline so that it ends up in the
+ * (IRAM) ISR that calls it.
+ */
+
+#if defined(ESP_PLATFORM)
+#define SPSC_RING_ALIGN 4  // single shared SRAM, no cache lines to keep apart
+#else
+#define SPSC_RING_ALIGN 64
+#endif
+
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied bytewise");
+
+ public:
+  SpscRing() : head_(0), tail_(0), overruns_(0) {}
+
+  static constexpr size_t capacity() { return Capacity; }
+
+  // Producer side (ISR or a single task). Returns false and counts an overrun
+  // if the consumer has fallen a full ring behind.
+  inline __attribute__((always_inline)) bool push(const T& item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= Capacity) {
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    items_[head & (Capacity - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Moves up to maxCount items into out, oldest first.
+  size_t pop(T* out, size_t maxCount) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t avail = head_.load(std::memory_order_acquire) - tail;
+    size_t n = avail < maxCount ? avail : maxCount;
+    for (size_t i = 0; i < n; i++) out[i] = items_[(tail + i) & (Capacity - 1)];
+    tail_.store(tail + (uint32_t)n, std::memory_order_release);
+    return n;
+  }
+
+  bool pop(T& out) { return pop(&out, 1) == 1; }
+
+  // Exact on the consumer side; a lower bound anywhere else.
+  size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+  bool empty() const { return size() == 0; }
+  uint32_t pushed() const { return head_.load(std::memory_order_relaxed); }
+  uint32_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+ private:
+  SpscRing(const SpscRing&);
+  SpscRing& operator=(const SpscRing&);
+
+  alignas(SPSC_RING_ALIGN) std::atomic<uint32_t> head_;  // written by the producer only
+  alignas(SPSC_RING_ALIGN) std::atomic<uint32_t> tail_;  // written by the consumer only
+  std::atomic<uint32_t> overruns_;                       // written by the producer only
+  alignas(SPSC_RING_ALIGN) T items_[Capacity];
+};
+
+#endif
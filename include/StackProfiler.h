@@ -0,0 +1,66 @@
+#ifndef STACK_PROFILER_H
+#define STACK_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+
+#define STACK_PROFILE_PATH "/stack_profile.json"
+#define STACK_PROFILE_POLL_MS 5000
+
+class Module;
+
+/**
+ * Stack right-sizing for module tasks from observed high-water marks.
+ * poll() samples every module task's peak stack use; with "record" enabled
+ * the peaks (the maximum over all recorded runs) are saved to
+ * STACK_PROFILE_PATH. On the next boot, with "apply" enabled, sizeFor()
+ * creates each profiled task with peak + margin (the larger of margin_pct
+ * and margin_bytes), never below "floor", and the difference to the
+ * configured size is reported as reclaimed RAM. A task whose use crosses
+ * warn_pct of its stack is logged once as a warning, profiled or not.
+ *
+ * Settings live under system.stack_profile in the global configuration.
+ */
+class StackProfiler {
+ public:
+  StackProfiler();
+
+  void configure(JsonVariantConst cfg);
+  // Reads the saved profile; false if there is none.
+  bool load();
+  // Stack (bytes, without TASK_STACK_OVERHEAD) to create taskName with.
+  uint32_t sizeFor(const String& taskName, uint32_t configured);
+  // Called from loop(); does nothing until STACK_PROFILE_POLL_MS have passed.
+  void poll(const std::vector<Module*>& modules);
+  bool save();
+  // Bytes saved against the configured sizes (negative if tasks had to grow).
+  int32_t reclaimed() const;
+  void toJson(JsonObject out) const;
+
+ private:
+  struct Entry {
+    String task;
+    uint32_t configured;  // 0 until the task is created
+    uint32_t sized;
+    uint32_t profilePeak;  // from the saved profile, incl. TASK_STACK_OVERHEAD
+    uint32_t peak;         // this run, incl. TASK_STACK_OVERHEAD
+    bool floored;          // profile asked for less than floor
+    bool warned;
+  };
+  Entry& entry(const String& task);
+
+  std::vector<Entry> entries_;
+  bool record_;
+  bool apply_;
+  uint32_t marginPct_;
+  uint32_t marginBytes_;
+  uint32_t floor_;
+  uint32_t warnPct_;
+  uint32_t saveIntervalMs_;
+  uint32_t lastPollMs_;
+  uint32_t lastSaveMs_;
+  bool dirty_;
+};
+
+#endif
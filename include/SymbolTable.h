@@ -0,0 +1,146 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#endif
+
+/**
+ * Interns module and function names to small integer IDs so that message
+ * routing and function dispatch can index arrays instead of comparing and
+ * concatenating strings. Names known at compile time are hashed by the
+ * compiler (SYMBOL_HASH / SYMBOL_ID); the runtime cost of resolving them is a
+ * single open-addressing probe. Lookups are lock-free; interning a new name
+ * takes a short critical section (the copy is allocated outside it) and never
+ * moves existing entries, so IDs and name pointers stay valid for the
+ * lifetime of the program.
+ */
+
+typedef uint16_t SymbolId;
+static const SymbolId SYMBOL_NONE = 0;
+
+// 32-bit FNV-1a in the single-return form C++11 allows in constant expressions.
+constexpr uint32_t symbolHash(const char* s, uint32_t h = 2166136261u) {
+  return *s ? symbolHash(s + 1, (h ^ (uint32_t)(uint8_t)*s) * 16777619u) : h;
+}
+
+#define SYMBOL_HASH(lit) (std::integral_constant<uint32_t, symbolHash(lit)>::value)
+#define SYMBOL_ID(lit) (SymbolTable::global().intern(lit, SYMBOL_HASH(lit)))
+
+class SymbolTable {
+ public:
+  static const size_t kMaxSymbols = 255;
+  static const size_t kSlots = 512;  // power of two, at least 2x kMaxSymbols
+
+  static SymbolTable& global() {
+    static SymbolTable table;
+    return table;
+  }
+
+  SymbolTable() : count_(0) {
+#if defined(ESP_PLATFORM)
+    portMUX_INITIALIZE(&lock_);
+#else
+    lock_.clear();
+#endif
+    for (size_t i = 0; i < kSlots; i++) slots_[i].store(SYMBOL_NONE, std::memory_order_relaxed);
+    for (size_t i = 0; i <= kMaxSymbols; i++) { hashes_[i] = 0; names_[i] = nullptr; }
+  }
+
+  ~SymbolTable() {
+    for (size_t i = 1; i <= count_; i++) free(names_[i]);
+  }
+
+  static uint32_t hashOf(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) { h = (h ^ (uint32_t)(uint8_t)*s++) * 16777619u; }
+    return h;
+  }
+
+  // Returns the ID for name, adding it if needed. SYMBOL_NONE if the table is
+  // full or name collides with a different name of the same hash.
+  SymbolId intern(const char* name) { return intern(name, hashOf(name)); }
+
+  SymbolId intern(const char* name, uint32_t hash) {
+    SymbolId id = find(hash);
+    if (id != SYMBOL_NONE) return strcmp(names_[id], name) == 0 ? id : SYMBOL_NONE;
+    size_t len = strlen(name);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return SYMBOL_NONE;
+    memcpy(copy, name, len + 1);
+    lock();
+    size_t i = hash & (kSlots - 1);
+    for (;;) {
+      id = slots_[i].load(std::memory_order_relaxed);
+      if (id == SYMBOL_NONE || hashes_[id] == hash) break;
+      i = (i + 1) & (kSlots - 1);
+    }
+    if (id != SYMBOL_NONE) {
+      // Another task interned the same hash while we were allocating.
+      unlock();
+      free(copy);
+      return strcmp(names_[id], name) == 0 ? id : SYMBOL_NONE;
+    }
+    if (count_ >= kMaxSymbols) {
+      unlock();
+      free(copy);
+      return SYMBOL_NONE;
+    }
+    id = (SymbolId)(count_ + 1);
+    hashes_[id] = hash;
+    names_[id] = copy;
+    count_ = id;
+    slots_[i].store(id, std::memory_order_release);
+    unlock();
+    return id;
+  }
+
+  SymbolId find(uint32_t hash) const {
+    size_t i = hash & (kSlots - 1);
+    for (;;) {
+      SymbolId id = slots_[i].load(std::memory_order_acquire);
+      if (id == SYMBOL_NONE || hashes_[id] == hash) return id;
+      i = (i + 1) & (kSlots - 1);
+    }
+  }
+
+  SymbolId find(const char* name) const {
+    SymbolId id = find(hashOf(name));
+    return (id != SYMBOL_NONE && strcmp(names_[id], name) == 0) ? id : SYMBOL_NONE;
+  }
+
+  const char* name(SymbolId id) const { return (id != SYMBOL_NONE && id <= count_) ? names_[id] : ""; }
+  size_t size() const { return count_; }
+
+ private:
+  SymbolTable(const SymbolTable&);
+  SymbolTable& operator=(const SymbolTable&);
+
+  // Interning runs from tasks of any priority on both cores: a spinning
+  // higher-priority task would starve a preempted holder on the same core.
+#if defined(ESP_PLATFORM)
+  void lock() { portENTER_CRITICAL(&lock_); }
+  void unlock() { portEXIT_CRITICAL(&lock_); }
+#else
+  void lock() { while (lock_.test_and_set(std::memory_order_acquire)) {} }
+  void unlock() { lock_.clear(std::memory_order_release); }
+#endif
+
+  std::atomic<SymbolId> slots_[kSlots];
+  uint32_t hashes_[kMaxSymbols + 1];
+  char* names_[kMaxSymbols + 1];
+  size_t count_;
+#if defined(ESP_PLATFORM)
+  portMUX_TYPE lock_;  // probe and insert
+#else
+  std::atomic_flag lock_;  // host tests
+#endif
+};
+
+#endif
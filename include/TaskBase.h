@@ -7,6 +7,9 @@
 #include "FreeRTOSTypes.h"
 #include "FreeRTOSWatchdog.h"
 
+// Bytes added to every task's configured stack for the watchdog wrapper
+#define TASK_STACK_OVERHEAD 1024
+
 class Module;
 
 /**
@@ -43,6 +46,7 @@ class TaskBase {
   // Stack usage monitoring
   uint32_t getStackHighWaterMark() const;
   uint32_t getStackSize() const { return cfg_.stackSize; }
+  // Peak bytes used of the whole allocation (stackSize + TASK_STACK_OVERHEAD)
   uint32_t getStackUsed() const;
   float getStackUsagePercent() const;
   
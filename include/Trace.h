@@ -0,0 +1,115 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Span tracer for boot and runtime timelines, exported as Chrome trace
+ * JSON (chrome://tracing, ui.perfetto.dev). Built only with -DSYSTEM_TRACE
+ * (env esp32dev-trace); otherwise every TRACE_* macro expands to nothing and
+ * its arguments are not evaluated.
+ *
+ *   TRACE_SCOPE("config", "load");                          // span until end of scope
+ *   TRACE_SCOPE_ARG("module", "init", moduleNameCStr);      // with an argument
+ *   TRACE_INSTANT("wifi", "connected", nullptr);
+ *
+ * Names, categories and arguments are stored as pointers, so they must
+ * outlive the trace: literals, or SymbolTable::name() for module and call
+ * names. An event is 32 bytes in a preallocated table. The first
+ * TRACE_BOOT_EVENTS are kept for good so the boot stays visible, and the
+ * rest is a ring that keeps the latest events. Recording is one atomic
+ * increment plus the slot write, from any task on either core (not ISRs).
+ */
+
+#ifdef SYSTEM_TRACE
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 512
+#endif
+#ifndef TRACE_BOOT_EVENTS
+#define TRACE_BOOT_EVENTS 192
+#endif
+#define TRACE_MAX_TASKS 24
+
+class Trace {
+ public:
+  static Trace& global();
+
+  // ph is a Chrome trace phase: 'B' begin, 'E' end, 'i' instant.
+  void record(char ph, const char* cat, const char* name, const char* arg);
+  // Writes the retained events as a Chrome trace ({"traceEvents": [...]}).
+  void writeChromeJson(Print& out);
+  // Forgets every event (events being recorded meanwhile may be lost).
+  void clear();
+  uint32_t recorded() const { return head_.load(std::memory_order_relaxed); }
+  // Events overwritten in the ring since the last clear().
+  uint32_t dropped() const;
+
+ private:
+  struct Event {
+    std::atomic<uint32_t> seq;  // event index + 1 once written, 0 while writing
+    uint8_t ph;
+    uint8_t tid;                // index into tasks_
+    uint8_t core;
+    int64_t tsUs;
+    const char* cat;
+    const char* name;
+    const char* arg;
+  };
+  struct TaskName {
+    TaskHandle_t handle;
+    char name[16];
+  };
+
+  Trace();
+  Trace(const Trace&);
+  Trace& operator=(const Trace&);
+
+  static size_t slotOf(uint32_t index);
+  uint8_t taskId();
+
+  Event events_[TRACE_CAPACITY];
+  std::atomic<uint32_t> head_;  // events recorded
+  TaskName tasks_[TRACE_MAX_TASKS];
+  std::atomic<uint8_t> taskCount_;
+  portMUX_TYPE lock_;           // adding to tasks_
+};
+
+// RAII span: begin on construction, end when the scope is left.
+class TraceSpan {
+ public:
+  TraceSpan(const char* cat, const char* name, const char* arg) : cat_(cat), name_(name) {
+    Trace::global().record('B', cat, name, arg);
+  }
+  ~TraceSpan() { Trace::global().record('E', cat_, name_, nullptr); }
+
+ private:
+  TraceSpan(const TraceSpan&);
+  TraceSpan& operator=(const TraceSpan&);
+
+  const char* cat_;
+  const char* name_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(cat, name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(cat, name, nullptr)
+#define TRACE_SCOPE_ARG(cat, name, arg) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(cat, name, arg)
+#define TRACE_BEGIN(cat, name, arg) Trace::global().record('B', cat, name, arg)
+#define TRACE_END(cat, name) Trace::global().record('E', cat, name, nullptr)
+#define TRACE_INSTANT(cat, name, arg) Trace::global().record('i', cat, name, arg)
+
+#else
+
+#define TRACE_SCOPE(cat, name)
+#define TRACE_SCOPE_ARG(cat, name, arg)
+#define TRACE_BEGIN(cat, name, arg)
+#define TRACE_END(cat, name)
+#define TRACE_INSTANT(cat, name, arg)
+
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TYPED_PAYLOAD_H
+#define TYPED_PAYLOAD_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <type_traits>
+#include "FreeRTOSTypes.h"
+
+#define TYPED_PAYLOAD_MAX_TYPES 16
+
+/**
+ * Typed message payloads: plain structs copied into QueueMessage::payload (or
+ * referenced through QueueMessage::shared when published on the EventBus)
+ * instead of being serialized into callVariables. A type is bound to a call
+ * ID once; JSON conversion (PayloadTraits<T>::toJson / fromJson) only runs at
+ * the edges, when a typed call meets a JSON handler or a JSON caller (serial,
+ * web, ModuleRegistry::callFunction with a DynamicJsonDocument*).
+ *
+ * Specialize PayloadTraits next to the struct:
+ *   template <> struct PayloadTraits<MySample> {
+ *     static void toJson(const MySample& s, JsonObject out);
+ *     static bool fromJson(JsonVariantConst in, MySample& s);
+ *   };
+ */
+template <typename T>
+struct PayloadTraits;
+
+struct TypedPayloadType {
+  SymbolId callId;
+  uint16_t size;
+  void (*toJson)(const void* payload, JsonObject out);
+  bool (*fromJson)(JsonVariantConst in, void* payload);
+};
+
+class TypedPayloads {
+ public:
+  static TypedPayloads& global() {
+    static TypedPayloads types;
+    return types;
+  }
+
+  template <typename T>
+  bool registerType(SymbolId callId) {
+    static_assert(std::is_trivially_copyable<T>::value, "typed payloads are copied bytewise");
+    static_assert(sizeof(T) <= SHARED_PAYLOAD_MAX, "typed payload exceeds SHARED_PAYLOAD_MAX");
+    return add(TypedPayloadType{callId, (uint16_t)sizeof(T), &toJsonOf<T>, &fromJsonOf<T>});
+  }
+
+  const TypedPayloadType* find(SymbolId callId) const;
+  // Serializes msg's typed payload into out; false if the message carries none.
+  bool toJson(const QueueMessage* msg, JsonObject out) const;
+  // Fills msg's typed payload for its callId from a JSON document.
+  bool fromJson(JsonVariantConst in, QueueMessage* msg) const;
+
+ private:
+  TypedPayloads();
+  bool add(const TypedPayloadType& t);
+
+  template <typename T>
+  static void toJsonOf(const void* p, JsonObject out) { PayloadTraits<T>::toJson(*(const T*)p, out); }
+  template <typename T>
+  static bool fromJsonOf(JsonVariantConst in, void* p) { return PayloadTraits<T>::fromJson(in, *(T*)p); }
+
+  TypedPayloadType types_[TYPED_PAYLOAD_MAX_TYPES];
+  size_t count_;
+  portMUX_TYPE lock_;
+};
+
+// Marks msg as carrying a T and returns the inline storage to fill in.
+template <typename T>
+static inline T* queueMessagePayload(QueueMessage* msg) {
+  static_assert(std::is_trivially_copyable<T>::value, "typed payloads are copied bytewise");
+  static_assert(sizeof(T) <= QUEUE_PAYLOAD_INLINE, "typed payload exceeds QUEUE_PAYLOAD_INLINE");
+  msg->payloadSize = sizeof(T);
+  return reinterpret_cast<T*>(msg->payload);
+}
+
+// Typed payload of msg (inline or shared), or nullptr if it carries none of this size.
+template <typename T>
+static inline const T* queueMessagePayloadAs(const QueueMessage* msg) {
+  uint16_t size = 0;
+  const uint8_t* data = queueMessagePayloadData(msg, size);
+  return (data && size == sizeof(T)) ? reinterpret_cast<const T*>(data) : nullptr;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef VAR_STORE_H
+#define VAR_STORE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "SymbolTable.h"
+#include "Seqlock.h"
+
+#define VAR_STORE_MAX_VARS 32
+#define VAR_STORE_MAX_WATCHERS 16
+#define VAR_STORE_STRING_MAX 24  // including the terminator
+
+typedef int16_t VarId;  // slot in the store; -1: none
+
+enum VarType : uint8_t { VAR_NONE = 0, VAR_INT, VAR_FLOAT, VAR_BOOL, VAR_STRING };
+const char* varTypeName(VarType t);
+
+struct VarValue {
+  VarType type;
+  union {
+    int32_t i;
+    float f;
+    bool b;
+    char s[VAR_STORE_STRING_MAX];
+  };
+};
+
+// Runs on the writer's task right after a change; keep it short (queue work
+// for your own task instead of doing it here).
+typedef void (*VarCallback)(VarId id, const VarValue& value, void* ctx);
+
+/**
+ * Cross-module variables ("CONTROL_RADAR.distance_cm", "CONTROL_WIFI.rssi",
+ * "<module>.state") in a flat table of typed slots. A producer defines its
+ * variables once and sets them by VarId; consumers resolve the VarId once
+ * (find()) and read it instead of building a getStatus() document.
+ *
+ * Each slot is a Seqlock: reads never block and take no lock on either core,
+ * writes are serialized and copy a few bytes inside a critical section. A set
+ * that does not change the value is a no-op; a change bumps the slot's
+ * version (for pollers) and runs the callbacks subscribed to it.
+ */
+class VarStore {
+ public:
+  VarStore();
+
+  // Finds or adds owner.name. -1 if the table is full or the variable exists
+  // with another type.
+  VarId define(const String& owner, const String& name, VarType type);
+  VarId find(const String& owner, const String& name) const;
+
+  bool setInt(VarId id, int32_t v);
+  bool setFloat(VarId id, float v);
+  bool setBool(VarId id, bool v);
+  bool setString(VarId id, const char* v);
+
+  // False for an unknown id or a variable never set.
+  bool get(VarId id, VarValue& out) const;
+  int32_t getInt(VarId id, int32_t fallback = 0) const;
+  float getFloat(VarId id, float fallback = 0.0f) const;
+  bool getBool(VarId id, bool fallback = false) const;
+  // Changes so far; compare with a remembered value to detect updates.
+  uint32_t version(VarId id) const;
+
+  bool subscribe(VarId id, VarCallback cb, void* ctx);
+  void unsubscribe(VarId id, VarCallback cb, void* ctx);
+
+  void toJson(JsonArray out) const;
+
+ private:
+  struct Slot {
+    SymbolId owner;
+    SymbolId name;
+    VarType type;
+    Seqlock<VarValue> value;
+  };
+  struct Watcher {
+    VarId id;
+    VarCallback cb;
+    void* ctx;
+  };
+
+  bool set(VarId id, const VarValue& v);
+  static void valueToJson(const VarValue& v, JsonObject out);
+
+  Slot slots_[VAR_STORE_MAX_VARS];
+  std::atomic<uint16_t> count_;  // slots below it are fully defined
+  Watcher watchers_[VAR_STORE_MAX_WATCHERS];
+  size_t watcherCount_;
+  mutable portMUX_TYPE lock_;  // writers: definitions, values, watchers
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define WORKER_POOL_PER_CORE 1
+#define WORKER_POOL_MAX_WORKERS (WORKER_POOL_PER_CORE * portNUM_PROCESSORS)
+#define WORKER_POOL_DEQUE_SIZE 16
+#define WORKER_POOL_MAX_MODULES 8
+#define WORKER_POOL_STACK 4096
+#define WORKER_POOL_PRIORITY 3
+
+class Module;
+
+typedef void (*WorkFn)(void* arg);
+
+/**
+ * Shared worker tasks (WORKER_POOL_PER_CORE pinned to each core) for short
+ * jobs and for modules that opt out of a task of their own
+ * (freertos.task.pool). Each worker owns a bounded deque: jobs are pushed to
+ * a worker on the requested core and taken oldest-first by their owner,
+ * while an idle worker steals the newest job from the busiest other deque,
+ * so a backlog on one core drains on the other as well.
+ *
+ * A pool module is run as a job (drainQueue() then update()) when it is
+ * due, when a message is queued for it (Module::notifyWork) or when its
+ * input stream has data. At most one job per module is in flight, so its
+ * handlers never run concurrently, just as on a dedicated task. The pool
+ * is only started when the first module attaches or job is submitted.
+ */
+class WorkerPool {
+ public:
+  static WorkerPool& global();
+
+  // Queues fn(arg) on a worker of core (-1: the calling core); starts the
+  // workers on first use. False if they cannot start or every deque is full.
+  bool submit(WorkFn fn, void* arg, int8_t core = -1);
+  // Runs m on the pool from now on; starts the workers on first use.
+  bool attach(Module* m);
+  // Stops running m on the pool and frees its slot; returns once no job of m
+  // is queued or running, so m may then be deleted. Not from m's own job.
+  void detach(Module* m);
+  // m has work (a queued message): schedule a job for it unless one is in flight.
+  void wake(Module* m);
+  // A worker task for ISR wake-ups (Module::notifyWorkFromISR).
+  TaskHandle_t workerFor(int8_t core) const;
+  bool isRunning() const { return workerCount_ > 0; }
+  void toJson(JsonObject out);
+
+ private:
+  struct WorkItem {
+    WorkFn fn;
+    void* arg;
+  };
+  struct Worker {
+    TaskHandle_t handle;
+    uint8_t core;
+    WorkItem items[WORKER_POOL_DEQUE_SIZE];
+    uint16_t head;   // oldest job
+    uint16_t count;
+    portMUX_TYPE lock;
+    uint32_t executed;
+    uint32_t stolen;  // jobs this worker took from other deques
+    uint64_t busyUs;
+  };
+  struct PoolModule {
+    std::atomic<Module*> module;  // nullptr once detached
+    int64_t dueUs;                // set by attach() before module, then only by whoever set scheduled
+    std::atomic<bool> scheduled;  // a job for it is queued or running, or a worker is checking it
+  };
+
+  WorkerPool();
+  bool start();
+  static void workerMain(void* arg);
+  static void moduleJob(void* arg);
+  bool push(Worker& w, const WorkItem& item);
+  bool popOldest(Worker& w, WorkItem& out);
+  bool steal(Worker& self, WorkItem& out);
+  // Queues a job for pm if it has work or is due at now; otherwise lowers
+  // *next to its due time.
+  void schedule(PoolModule& pm, int64_t now, int64_t* next);
+  // Schedules due modules; returns ms until the next one is due.
+  uint32_t scheduleDue();
+  PoolModule* find(Module* m);
+
+  Worker workers_[WORKER_POOL_MAX_WORKERS];
+  size_t workerCount_;
+  PoolModule modules_[WORKER_POOL_MAX_MODULES];
+  size_t moduleCount_;
+  std::atomic<uint32_t> nextWorker_;
+  std::atomic<uint8_t> startState_;  // 0 stopped, 1 starting, 2 started
+  uint32_t submitted_;
+  uint32_t rejected_;
+  portMUX_TYPE lock_;  // moduleCount_ and counters
+};
+
+#endif
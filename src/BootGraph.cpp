@@ -0,0 +1,244 @@
+#include "BootGraph.h"
+#include <algorithm>
+#include "ModuleManager.h"
+#include "esp_timer.h"
+
+static const uint16_t BOOT_STOP = 0xFFFF;  // tells a worker to exit
+
+BootGraph::BootGraph()
+    : ready_(nullptr), done_(nullptr), exited_(nullptr), remaining_(0), failed_(false), cycle_(false),
+      phaseCount_(0) {
+  portMUX_INITIALIZE(&lock_);
+}
+
+void BootGraph::build(const std::vector<Module*>& modules) {
+  nodes_.assign(modules.size(), Node());
+  cycle_ = false;
+  for (size_t i = 0; i < modules.size(); i++) {
+    Node& n = nodes_[i];
+    n.module = modules[i];
+    n.pending = 0;
+    n.startUs = n.endUs = 0;
+    n.core = -1;
+    n.ok = n.skipped = false;
+  }
+  for (size_t i = 0; i < modules.size(); i++) {
+    std::vector<String> names = modules[i]->getDependencies();
+    const std::vector<String>& after = modules[i]->getStartsAfter();
+    names.insert(names.end(), after.begin(), after.end());
+    for (const String& name : names) {
+      size_t j = 0;
+      while (j < modules.size() && modules[j]->getName() != name) j++;
+      if (j == modules.size()) {
+        Serial.println("[BOOT] " + modules[i]->getName() + " depends on unknown module " + name + ", ignored");
+        continue;
+      }
+      if (j == i || std::find(nodes_[i].deps.begin(), nodes_[i].deps.end(), j) != nodes_[i].deps.end()) continue;
+      nodes_[i].deps.push_back((uint16_t)j);
+      nodes_[j].dependents.push_back((uint16_t)i);
+    }
+  }
+  // Kahn's algorithm; whatever it cannot order is in or behind a cycle
+  std::vector<uint16_t> indegree(nodes_.size());
+  std::vector<uint16_t> order;
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    indegree[i] = nodes_[i].deps.size();
+    if (indegree[i] == 0) order.push_back((uint16_t)i);
+  }
+  for (size_t k = 0; k < order.size(); k++) {
+    for (uint16_t d : nodes_[order[k]].dependents) {
+      if (--indegree[d] == 0) order.push_back(d);
+    }
+  }
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    if (indegree[i] == 0) continue;
+    cycle_ = true;
+    Serial.println("[BOOT] " + modules[i]->getName() + " is in a dependency cycle, its dependencies are ignored");
+    for (uint16_t d : nodes_[i].deps) {
+      std::vector<uint16_t>& dep = nodes_[d].dependents;
+      dep.erase(std::remove(dep.begin(), dep.end(), (uint16_t)i), dep.end());
+    }
+    nodes_[i].deps.clear();
+  }
+  for (Node& n : nodes_) n.pending = n.deps.size();
+}
+
+bool BootGraph::run(const char* phase, const std::vector<Module*>& modules, Step step) {
+  build(modules);
+  step_ = step;
+  failed_ = false;
+  remaining_ = nodes_.size();
+  int64_t t0 = esp_timer_get_time();
+  uint8_t workers = 0;
+  if (!nodes_.empty()) {
+    ready_ = xQueueCreate(nodes_.size() + BOOT_WORKERS, sizeof(uint16_t));
+    done_ = xSemaphoreCreateBinary();
+    exited_ = xSemaphoreCreateCounting(BOOT_WORKERS, 0);
+    if (ready_ && done_ && exited_) {
+      // Same priority as the caller, which only waits
+      UBaseType_t priority = uxTaskPriorityGet(nullptr);
+      for (uint8_t core = 0; core < BOOT_WORKERS; core++) {
+        char name[12];
+        snprintf(name, sizeof(name), "BOOT_%u", (unsigned)core);
+        if (xTaskCreatePinnedToCore(workerMain, name, BOOT_WORKER_STACK, this, priority, nullptr, core) != pdPASS) break;
+        workers++;
+      }
+    }
+    if (workers) {
+      for (size_t i = 0; i < nodes_.size(); i++) {
+        uint16_t idx = (uint16_t)i;
+        if (nodes_[i].pending == 0) xQueueSend(ready_, &idx, 0);
+      }
+      xSemaphoreTake(done_, portMAX_DELAY);
+      for (uint8_t w = 0; w < workers; w++) xQueueSend(ready_, &BOOT_STOP, portMAX_DELAY);
+      for (uint8_t w = 0; w < workers; w++) xSemaphoreTake(exited_, portMAX_DELAY);
+    } else {
+      Serial.println("[BOOT] No boot workers, running " + String(phase) + " sequentially");
+      if (ready_) vQueueDelete(ready_);
+      ready_ = nullptr;
+      runSequential();
+    }
+    if (ready_) vQueueDelete(ready_);
+    if (done_) vSemaphoreDelete(done_);
+    if (exited_) vSemaphoreDelete(exited_);
+    ready_ = nullptr;
+    done_ = exited_ = nullptr;
+  }
+  record(phase, t0, esp_timer_get_time(), workers);
+  step_ = nullptr;
+  return !failed_;
+}
+
+void BootGraph::runSequential() {
+  for (;;) {
+    size_t i = 0;
+    while (i < nodes_.size() && (nodes_[i].core >= 0 || nodes_[i].pending > 0)) i++;
+    if (i == nodes_.size()) break;
+    execute((uint16_t)i);
+  }
+}
+
+void BootGraph::workerMain(void* arg) {
+  BootGraph* g = static_cast<BootGraph*>(arg);
+  uint16_t idx;
+  while (xQueueReceive(g->ready_, &idx, portMAX_DELAY) == pdTRUE && idx != BOOT_STOP) g->execute(idx);
+  xSemaphoreGive(g->exited_);
+  vTaskDelete(nullptr);
+}
+
+void BootGraph::execute(uint16_t idx) {
+  Node& n = nodes_[idx];
+  n.core = (int8_t)xPortGetCoreID();
+  n.startUs = esp_timer_get_time();
+  portENTER_CRITICAL(&lock_);
+  n.skipped = failed_;
+  portEXIT_CRITICAL(&lock_);
+  n.ok = !n.skipped && step_(n.module);
+  n.endUs = esp_timer_get_time();
+
+  // Record a critical failure before any dependent can be picked up
+  portENTER_CRITICAL(&lock_);
+  if (!n.ok && !n.skipped && n.module->isCritical()) failed_ = true;
+  portEXIT_CRITICAL(&lock_);
+  for (uint16_t d : n.dependents) {
+    portENTER_CRITICAL(&lock_);
+    bool ready = --nodes_[d].pending == 0;
+    portEXIT_CRITICAL(&lock_);
+    if (ready && ready_) xQueueSend(ready_, &d, 0);
+  }
+  portENTER_CRITICAL(&lock_);
+  bool last = --remaining_ == 0;
+  portEXIT_CRITICAL(&lock_);
+  if (last && done_) xSemaphoreGive(done_);
+}
+
+void BootGraph::record(const char* phase, int64_t t0, int64_t t1, uint8_t workers) {
+  Phase* p = nullptr;
+  for (uint8_t i = 0; i < phaseCount_; i++) {
+    if (phases_[i].name == phase) p = &phases_[i];
+  }
+  if (!p) p = &phases_[phaseCount_ < BOOT_MAX_PHASES ? phaseCount_++ : BOOT_MAX_PHASES - 1];
+  p->name = phase;
+  p->totalMs = (uint32_t)((t1 - t0 + 500) / 1000);
+  p->workers = workers;
+  p->cycle = cycle_;
+  p->sequentialMs = 0;
+  p->modules.clear();
+  p->criticalPath.clear();
+
+  // Longest dependency chain by step duration. A dependency always ends
+  // before its dependent starts, so visiting by end time is a topological order.
+  std::vector<uint16_t> byEnd(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); i++) byEnd[i] = (uint16_t)i;
+  std::sort(byEnd.begin(), byEnd.end(), [this](uint16_t a, uint16_t b) { return nodes_[a].endUs < nodes_[b].endUs; });
+  std::vector<int64_t> chainUs(nodes_.size(), 0);
+  std::vector<int> via(nodes_.size(), -1);
+  int tail = -1;
+  for (uint16_t i : byEnd) {
+    const Node& n = nodes_[i];
+    int64_t best = 0;
+    for (uint16_t d : n.deps) {
+      if (chainUs[d] > best || via[i] < 0) {
+        best = chainUs[d];
+        via[i] = d;
+      }
+    }
+    chainUs[i] = best + (n.endUs - n.startUs);
+    if (tail < 0 || chainUs[i] > chainUs[tail]) tail = i;
+  }
+  p->criticalMs = tail >= 0 ? (uint32_t)((chainUs[tail] + 500) / 1000) : 0;
+  for (int i = tail; i >= 0; i = via[i]) p->criticalPath.insert(p->criticalPath.begin(), nodes_[i].module->getName());
+
+  for (const Node& n : nodes_) {
+    Timing t;
+    t.name = n.module->getName();
+    t.startMs = n.startUs ? (uint32_t)((n.startUs - t0 + 500) / 1000) : 0;
+    t.durMs = (uint32_t)((n.endUs - n.startUs + 500) / 1000);
+    t.core = n.core;
+    t.ok = n.ok;
+    t.skipped = n.skipped;
+    p->sequentialMs += t.durMs;
+    p->modules.push_back(t);
+  }
+}
+
+String BootGraph::summary(const char* phase) const {
+  for (uint8_t i = 0; i < phaseCount_; i++) {
+    const Phase& p = phases_[i];
+    if (p.name != phase) continue;
+    String path;
+    for (size_t k = 0; k < p.criticalPath.size(); k++) path += (k ? " > " : "") + p.criticalPath[k];
+    return p.name + ": " + String(p.totalMs) + " ms (sequential " + String(p.sequentialMs) + " ms, " +
+           String(p.workers) + " workers), critical path " + String(p.criticalMs) + " ms: " + path;
+  }
+  return String(phase) + ": not run";
+}
+
+void BootGraph::toJson(JsonObject out) const {
+  uint32_t bootMs = 0;
+  JsonArray phases = out.createNestedArray("phases");
+  for (uint8_t i = 0; i < phaseCount_; i++) {
+    const Phase& p = phases_[i];
+    bootMs += p.totalMs;
+    JsonObject o = phases.createNestedObject();
+    o["name"] = p.name;
+    o["total_ms"] = p.totalMs;
+    o["sequential_ms"] = p.sequentialMs;
+    o["critical_ms"] = p.criticalMs;
+    o["workers"] = p.workers;
+    o["cycle"] = p.cycle;
+    JsonArray path = o.createNestedArray("critical_path");
+    for (const String& name : p.criticalPath) path.add(name);
+    JsonArray mods = o.createNestedArray("modules");
+    for (const Timing& t : p.modules) {
+      JsonObject m = mods.createNestedObject();
+      m["name"] = t.name;
+      m["start_ms"] = t.startMs;
+      m["dur_ms"] = t.durMs;
+      m["core"] = t.core;
+      m["ok"] = t.ok;
+      if (t.skipped) m["skipped"] = true;
+    }
+  }
+  out["boot_ms"] = bootMs;
+}
@@ -8,6 +8,7 @@
  */
 #include "ConfigManager.h"
 #include "FSDefaults.h"
+#include "Trace.h"
 #include <SPIFFS.h>
 #include <MD5Builder.h>
 
@@ -65,6 +66,7 @@ bool ConfigManager::loadConfiguration(const String& path) {
     if (!isInitialized()) {
         return false;
     }
+    TRACE_SCOPE("config", "load");
     
     DynamicJsonDocument tempDoc(16384);
     if (!loadConfigFromFile(path, tempDoc)) {
@@ -100,6 +102,7 @@ bool ConfigManager::saveConfiguration(const String& path) {
     if (!isInitialized() || !currentConfig) {
         return false;
     }
+    TRACE_SCOPE("config", "save");
     
     // Validate before saving
     ConfigValidationResult result = validateConfiguration(*currentConfig);
@@ -120,6 +123,7 @@ bool ConfigManager::saveConfiguration(const String& path) {
 }
 
 bool ConfigManager::loadConfigFromFile(const String& path, DynamicJsonDocument& doc) {
+    TRACE_SCOPE("config", "read file");
     if (!filesystem->exists(path)) {
         Serial.printf("[CONFIG] Configuration file not found: %s\n", path.c_str());
         return false;
@@ -144,6 +148,7 @@ bool ConfigManager::loadConfigFromFile(const String& path, DynamicJsonDocument&
 }
 
 bool ConfigManager::saveConfigToFile(const String& path, const DynamicJsonDocument& doc) {
+    TRACE_SCOPE("config", "write file");
     File file = filesystem->open(path, "w");
     if (!file) {
         Serial.printf("[CONFIG] Failed to create configuration file: %s\n", path.c_str());
@@ -172,6 +177,7 @@ ConfigValidationResult ConfigManager::validateConfiguration() {
 }
 
 ConfigValidationResult ConfigManager::validateConfiguration(const DynamicJsonDocument& doc) {
+    TRACE_SCOPE("config", "validate");
     // Check version compatibility
     String version = getConfigVersion(doc);
     if (!isVersionCompatible(version)) {
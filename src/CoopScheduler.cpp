@@ -0,0 +1,121 @@
+#include "CoopScheduler.h"
+#include <algorithm>
+#include "esp_timer.h"
+#include "ModuleManager.h"
+
+CoopScheduler::CoopScheduler() {}
+
+void CoopScheduler::sync(const std::vector<Module*>& modules, TaskHandle_t runner) {
+  bool changed = false;
+  for (size_t i = 0; i < heap_.size();) {
+    Module* m = heap_[i].module;
+    bool listed = std::find(modules.begin(), modules.end(), m) != modules.end();
+    if (listed && m->isRunnable() && !m->getUseTask()) {
+      i++;
+      continue;
+    }
+    heap_[i] = heap_.back();
+    heap_.pop_back();
+    changed = true;
+  }
+  int64_t now = esp_timer_get_time();
+  for (Module* m : modules) {
+    if (!m->isRunnable() || m->getUseTask()) continue;
+    bool known = false;
+    for (const Entry& e : heap_) {
+      if (e.module == m) {
+        known = true;
+        break;
+      }
+    }
+    if (known) continue;
+    m->setRunnerTask(runner);
+    Entry e;
+    e.module = m;
+    e.dueUs = now;
+    e.periodMs = m->nextDeadlineMs();
+    e.woken = true;  // the first run has no deadline to be late for
+    e.runs = 0;
+    e.overruns = 0;
+    e.maxRunUs = 0;
+    e.lateness.reset();
+    heap_.push_back(e);
+    changed = true;
+  }
+  if (changed) std::make_heap(heap_.begin(), heap_.end(), Later());
+}
+
+void CoopScheduler::wakePending(int64_t now) {
+  bool changed = false;
+  for (Entry& e : heap_) {
+    if (e.dueUs > now && e.module->hasWork()) {
+      e.dueUs = now;
+      e.woken = true;
+      changed = true;
+    }
+  }
+  if (changed) std::make_heap(heap_.begin(), heap_.end(), Later());
+}
+
+void CoopScheduler::run(Entry& e, int64_t now) {
+  bool periodic = e.periodMs != MODULE_WAIT_FOREVER && e.periodMs > 0;
+  int64_t periodUs = (int64_t)e.periodMs * 1000;
+  bool overrun = false;
+  if (!e.woken) {
+    int64_t late = now - e.dueUs;
+    e.lateness.record(late > 0 ? (uint32_t)late : 0);
+    overrun = periodic && late > periodUs;
+  }
+  e.module->drainQueue();
+  int64_t t0 = esp_timer_get_time();
+  e.module->update();
+  int64_t end = esp_timer_get_time();
+  e.module->recordCpu(CPU_WORK_UPDATE, (uint32_t)(end - t0));
+  uint32_t ran = (uint32_t)(end - now);
+  if (ran > e.maxRunUs) e.maxRunUs = ran;
+  if (overrun || (periodic && ran > periodUs)) e.overruns++;
+  e.runs++;
+  e.woken = false;
+  e.periodMs = e.module->nextDeadlineMs();
+  e.dueUs = e.periodMs == MODULE_WAIT_FOREVER ? INT64_MAX : now + (int64_t)e.periodMs * 1000;
+}
+
+size_t CoopScheduler::runDue() {
+  int64_t now = esp_timer_get_time();
+  wakePending(now);
+  // Each module runs at most once per call, so a 0 ms period cannot starve the others
+  size_t ran = 0;
+  while (ran < heap_.size() && heap_.front().dueUs <= now) {
+    std::pop_heap(heap_.begin(), heap_.end(), Later());
+    run(heap_.back(), esp_timer_get_time());
+    std::push_heap(heap_.begin(), heap_.end(), Later());
+    ran++;
+  }
+  return ran;
+}
+
+uint32_t CoopScheduler::waitMs(uint32_t maxMs) {
+  if (heap_.empty()) return maxMs;
+  for (const Entry& e : heap_) {
+    if (e.module->hasWork()) return 0;
+  }
+  int64_t left = heap_.front().dueUs - esp_timer_get_time();
+  if (left <= 0) return 0;
+  int64_t ms = (left + 999) / 1000;
+  return ms < maxMs ? (uint32_t)ms : maxMs;
+}
+
+void CoopScheduler::toJson(JsonArray out) const {
+  int64_t now = esp_timer_get_time();
+  for (const Entry& e : heap_) {
+    JsonObject o = out.createNestedObject();
+    o["module"] = e.module->getName();
+    if (e.periodMs == MODULE_WAIT_FOREVER) o["period_ms"] = nullptr;
+    else o["period_ms"] = e.periodMs;
+    if (e.dueUs != INT64_MAX) o["due_in_ms"] = e.dueUs > now ? (int32_t)((e.dueUs - now) / 1000) : 0;
+    o["runs"] = e.runs;
+    o["overruns"] = e.overruns;
+    o["max_run_us"] = e.maxRunUs;
+    e.lateness.toJson(o.createNestedObject("late_us"));
+  }
+}
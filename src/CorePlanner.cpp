@@ -0,0 +1,167 @@
+#include "CorePlanner.h"
+#include <algorithm>
+#include "CpuMonitor.h"
+#include "ModuleManager.h"
+#include "esp_timer.h"
+#include "modules/CONTROL_FS.h"
+
+CorePlanner::CorePlanner() : apply_(true) {}
+
+void CorePlanner::configure(JsonVariantConst cfg) {
+  if (cfg.containsKey("apply")) apply_ = cfg["apply"];
+}
+
+bool CorePlanner::load() {
+  CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+  if (!fs || !fs->fileExists(CORE_PLAN_PATH)) return false;
+  DynamicJsonDocument doc(1024);
+  if (deserializeJson(doc, fs->readFile(CORE_PLAN_PATH))) return false;
+  saved_.clear();
+  for (JsonPair kv : doc["tasks"].as<JsonObject>()) {
+    Saved s;
+    s.task = kv.key().c_str();
+    s.core = kv.value().as<int8_t>();
+    saved_.push_back(s);
+  }
+  return true;
+}
+
+int8_t CorePlanner::coreFor(const String& taskName, int8_t configured) const {
+  if (!apply_) return configured;
+  for (const Saved& s : saved_) {
+    if (s.task == taskName && s.core >= 0 && s.core < portNUM_PROCESSORS) return s.core;
+  }
+  return configured;
+}
+
+// Share of one core the module's own task spent in update() and message handlers since boot
+static float taskLoadPct(Module* m) {
+  int64_t uptime = esp_timer_get_time();
+  if (uptime <= 0) return 0.0f;
+  uint64_t busy = m->cpuCounter(CPU_WORK_UPDATE).totalUs + m->cpuCounter(CPU_WORK_MESSAGE).totalUs;
+  return (float)(busy * 100.0 / uptime);
+}
+
+bool CorePlanner::compute(const std::vector<Module*>& modules, std::vector<Item>& items, float* before, float* after) {
+  for (Module* m : modules) {
+    TaskBase* task = m->getTask();
+    if (!task || !task->handle()) continue;
+    Item it;
+    it.module = m;
+    it.task = task->config().name;
+    it.load = taskLoadPct(m);
+    it.core = task->config().core;
+    it.proposed = it.core;
+    it.pinned = m->getTaskConfig().pinned;
+    items.push_back(it);
+  }
+
+  // Base load: whatever else runs on each core, from the run-time counters since boot
+  float base[portNUM_PROCESSORS] = {0};
+  bool measured = false;
+  CpuMonitor monitor;
+  DynamicJsonDocument cpu(4096);
+  monitor.sample(cpu.to<JsonObject>());
+  for (JsonObject c : cpu["cores"].as<JsonArray>()) {
+    int core = c["core"];
+    if (!c.containsKey("load_pct") || core < 0 || core >= portNUM_PROCESSORS) continue;
+    measured = true;
+    base[core] = c["load_pct"];
+    for (const Item& it : items) {
+      if (it.core == core) base[core] -= it.load;
+    }
+    if (base[core] < 0) base[core] = 0;
+  }
+
+  for (int c = 0; c < portNUM_PROCESSORS; c++) before[c] = after[c] = base[c];
+  for (const Item& it : items) {
+    if (it.core >= 0) before[it.core] += it.load;
+    else for (int c = 0; c < portNUM_PROCESSORS; c++) before[c] += it.load / portNUM_PROCESSORS;  // scheduler's choice
+    if (it.pinned && it.core >= 0) after[it.core] += it.load;
+  }
+
+  // Heaviest movable task first onto the lighter core
+  std::vector<Item*> movable;
+  for (Item& it : items) {
+    if (!(it.pinned && it.core >= 0)) movable.push_back(&it);
+  }
+  std::sort(movable.begin(), movable.end(), [](const Item* a, const Item* b) { return a->load > b->load; });
+  for (Item* it : movable) {
+    int best = it->core >= 0 ? it->core : 0;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+      if (after[c] < after[best]) best = c;
+    }
+    it->proposed = (int8_t)best;
+    after[best] += it->load;
+  }
+  return measured;
+}
+
+static float imbalance(const float* load) {
+  float lo = load[0], hi = load[0];
+  for (int c = 1; c < portNUM_PROCESSORS; c++) {
+    if (load[c] < lo) lo = load[c];
+    if (load[c] > hi) hi = load[c];
+  }
+  return hi - lo;
+}
+
+void CorePlanner::plan(const std::vector<Module*>& modules, JsonObject out) {
+  std::vector<Item> items;
+  float before[portNUM_PROCESSORS], after[portNUM_PROCESSORS];
+  bool measured = compute(modules, items, before, after);
+  out["base_measured"] = measured;
+  out["apply_on_boot"] = apply_;
+  JsonArray b = out.createNestedArray("before_pct");
+  JsonArray a = out.createNestedArray("after_pct");
+  for (int c = 0; c < portNUM_PROCESSORS; c++) {
+    b.add(before[c]);
+    a.add(after[c]);
+  }
+  out["imbalance_before_pct"] = imbalance(before);
+  out["imbalance_after_pct"] = imbalance(after);
+  size_t moves = 0;
+  JsonArray tasks = out.createNestedArray("tasks");
+  for (const Item& it : items) {
+    JsonObject t = tasks.createNestedObject();
+    t["module"] = it.module->getName();
+    t["task"] = it.task;
+    t["load_pct"] = it.load;
+    t["core"] = it.core;
+    t["proposed"] = it.proposed;
+    if (it.pinned) t["pinned"] = true;
+    if (it.proposed != it.core) moves++;
+  }
+  out["moves"] = moves;
+}
+
+bool CorePlanner::save(const std::vector<Module*>& modules, String* error) {
+  CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+  if (!fs) {
+    if (error) *error = "filesystem not available";
+    return false;
+  }
+  std::vector<Item> items;
+  float before[portNUM_PROCESSORS], after[portNUM_PROCESSORS];
+  if (!compute(modules, items, before, after)) {
+    if (error) *error = "base load not measured (FreeRTOS run-time stats unavailable)";
+    return false;
+  }
+  DynamicJsonDocument doc(1024);
+  JsonObject tasks = doc.createNestedObject("tasks");
+  saved_.clear();
+  for (const Item& it : items) {
+    tasks[it.task] = it.proposed;
+    Saved s;
+    s.task = it.task;
+    s.core = it.proposed;
+    saved_.push_back(s);
+  }
+  String out;
+  serializeJson(doc, out);
+  if (!fs->writeFile(CORE_PLAN_PATH, out)) {
+    if (error) *error = "write failed";
+    return false;
+  }
+  return true;
+}
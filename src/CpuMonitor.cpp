@@ -0,0 +1,70 @@
+#include "CpuMonitor.h"
+
+CpuMonitor::CpuMonitor() : prevCount_(0), prevTotal_(0) {}
+
+uint32_t CpuMonitor::previousRunTime(TaskHandle_t h) const {
+  for (size_t i = 0; i < prevCount_; i++) {
+    if (prev_[i].handle == h) return prev_[i].runTime;
+  }
+  return 0;  // started since the last sample
+}
+
+void CpuMonitor::sample(JsonObject out) {
+#if (configUSE_TRACE_FACILITY == 1)
+  UBaseType_t capacity = uxTaskGetNumberOfTasks() + 4;  // room for tasks created meanwhile
+  if (capacity > CPU_MONITOR_MAX_TASKS) capacity = CPU_MONITOR_MAX_TASKS;
+  TaskStatus_t* tasks = new TaskStatus_t[capacity];
+  uint32_t total = 0;
+  UBaseType_t n = uxTaskGetSystemState(tasks, capacity, &total);
+  out["supported"] = true;
+#if (configGENERATE_RUN_TIME_STATS == 1)
+  bool timed = true;
+#else
+  bool timed = false;
+#endif
+  out["run_time_stats"] = timed;
+  // Run-time counters are per core, so a task pinned to one core peaks at 100 %
+  uint32_t interval = total - prevTotal_;
+  if (timed) out["interval_us"] = interval;
+
+  JsonArray cores = out.createNestedArray("cores");
+  for (UBaseType_t c = 0; c < portNUM_PROCESSORS; c++) {
+    TaskHandle_t idle = xTaskGetIdleTaskHandleForCPU(c);
+    JsonObject core = cores.createNestedObject();
+    core["core"] = c;
+    for (UBaseType_t i = 0; i < n; i++) {
+      if (tasks[i].xHandle != idle || !timed || interval == 0) continue;
+      uint32_t idleDelta = tasks[i].ulRunTimeCounter - previousRunTime(idle);
+      float idlePct = 100.0f * idleDelta / interval;
+      if (idlePct > 100.0f) idlePct = 100.0f;
+      core["load_pct"] = 100.0f - idlePct;
+    }
+  }
+
+  JsonArray list = out.createNestedArray("tasks");
+  for (UBaseType_t i = 0; i < n; i++) {
+    const TaskStatus_t& t = tasks[i];
+    JsonObject o = list.createNestedObject();
+    o["name"] = t.pcTaskName;
+#if (configTASKLIST_INCLUDE_COREID == 1)
+    o["core"] = t.xCoreID == tskNO_AFFINITY ? -1 : (int)t.xCoreID;
+#endif
+    o["priority"] = (uint32_t)t.uxCurrentPriority;
+    o["stack_free"] = (uint32_t)t.usStackHighWaterMark;
+    if (timed) {
+      o["run_time_us"] = t.ulRunTimeCounter;
+      if (interval) o["load_pct"] = 100.0f * (t.ulRunTimeCounter - previousRunTime(t.xHandle)) / interval;
+    }
+  }
+
+  prevCount_ = n < CPU_MONITOR_MAX_TASKS ? n : CPU_MONITOR_MAX_TASKS;
+  for (size_t i = 0; i < prevCount_; i++) {
+    prev_[i].handle = tasks[i].xHandle;
+    prev_[i].runTime = tasks[i].ulRunTimeCounter;
+  }
+  prevTotal_ = total;
+  delete[] tasks;
+#else
+  out["supported"] = false;
+#endif
+}
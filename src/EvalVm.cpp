@@ -0,0 +1,632 @@
+#include "EvalVm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum EvalOp : uint8_t {
+  OP_END = 0,  // implicit return without a value
+  OP_LOADK,    // a = consts[bc]
+  OP_LOADP,    // a = $strings[bc]
+  OP_STOREP,   // $strings[bc] = a
+  OP_MOV,      // a = b
+  OP_ADD,      // a = b + c, likewise down to OP_MAX
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+  OP_LT,
+  OP_LE,
+  OP_GT,
+  OP_GE,
+  OP_EQ,
+  OP_NE,
+  OP_AND,
+  OP_OR,
+  OP_MIN,
+  OP_MAX,
+  OP_NEG,      // a = -b, likewise down to OP_SQRT
+  OP_NOT,
+  OP_ABS,
+  OP_ROUND,
+  OP_FLOOR,
+  OP_CEIL,
+  OP_SQRT,
+  OP_CLAMP,    // a = clamp(b, c, c + 1)
+  OP_JMP,      // pc = bc
+  OP_JZ,       // if (a == 0) pc = bc
+  OP_RET,      // return a
+  OP_RETS,     // return strings[bc]
+  OP_RETF,     // return fmt(strings[c], a .. a + b - 1)
+  OP_FAIL,
+};
+
+// ---- compiler ---------------------------------------------------------------
+
+class EvalCompiler {
+ public:
+  explicit EvalCompiler(EvalProgram& p) : p_(p), pos_(0), fixed_(0), top_(0) {}
+
+  bool compile(const char* source) {
+    if (!tokenize(source) || !declare()) return false;
+    // Parameters are read once up front, into their own registers
+    for (size_t i = 0; i < params_.size(); i++) {
+      int s = addString(params_[i].name);
+      if (s < 0) return false;
+      emit(OP_LOADP, params_[i].reg, (uint8_t)(s >> 8), (uint8_t)s);
+    }
+    while (peek().type != T_EOF) {
+      if (!statement()) return false;
+    }
+    emit(OP_END, 0, 0, 0);
+    if (p_.code_.size() > EVAL_MAX_STEPS) return fail("program too long");
+    return true;
+  }
+
+ private:
+  enum TokType { T_EOF, T_NUM, T_IDENT, T_PARAM, T_STRING, T_PUNCT };
+  struct Token {
+    TokType type;
+    std::string text;
+    float num;
+    bool nl;  // a line break precedes it
+    int line;
+  };
+  struct Name {
+    std::string name;
+    uint8_t reg;
+  };
+
+  bool fail(const std::string& msg) {
+    char where[24];
+    snprintf(where, sizeof(where), "line %d: ", peek().line);
+    p_.error_ = std::string(where) + msg;
+    return false;
+  }
+
+  bool tokenize(const char* s) {
+    int line = 1;
+    bool nl = false;
+    while (*s) {
+      if (*s == '\n') { line++; nl = true; s++; continue; }
+      if (*s == ' ' || *s == '\t' || *s == '\r') { s++; continue; }
+      if (s[0] == '/' && s[1] == '/') { while (*s && *s != '\n') s++; continue; }
+      Token t;
+      t.nl = nl;
+      t.line = line;
+      t.num = 0;
+      nl = false;
+      if ((*s >= '0' && *s <= '9') || (*s == '.' && s[1] >= '0' && s[1] <= '9')) {
+        char* end;
+        t.type = T_NUM;
+        t.num = strtof(s, &end);
+        s = end;
+      } else if (*s == '$' || *s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z')) {
+        t.type = *s == '$' ? T_PARAM : T_IDENT;
+        if (*s == '$') s++;
+        const char* b = s;
+        while (*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9')) s++;
+        t.text.assign(b, s - b);
+        if (t.text.empty()) { p_.error_ = "empty parameter name"; return false; }
+      } else if (*s == '"') {
+        t.type = T_STRING;
+        s++;
+        while (*s && *s != '"') {
+          if (*s == '\\' && s[1]) s++;
+          t.text += *s++;
+        }
+        if (*s != '"') { p_.error_ = "unterminated string"; return false; }
+        s++;
+      } else {
+        static const char* two[] = {"==", "!=", "<=", ">=", "&&", "||"};
+        t.type = T_PUNCT;
+        for (size_t i = 0; i < sizeof(two) / sizeof(two[0]); i++) {
+          if (s[0] == two[i][0] && s[1] == two[i][1]) t.text = two[i];
+        }
+        if (t.text.empty()) {
+          if (!strchr("+-*/%<>!=?:(),;{}", *s)) { p_.error_ = std::string("unexpected '") + *s + "'"; return false; }
+          t.text = std::string(1, *s);
+        }
+        s += t.text.size();
+      }
+      toks_.push_back(t);
+    }
+    Token e;
+    e.type = T_EOF;
+    e.num = 0;
+    e.nl = true;
+    e.line = line;
+    toks_.push_back(e);
+    return true;
+  }
+
+  // Gives every $param and every assigned local a fixed register; the rest are temporaries.
+  bool declare() {
+    for (size_t i = 0; i < toks_.size(); i++) {
+      const Token& t = toks_[i];
+      if (t.type == T_PARAM && !find(params_, t.text)) {
+        if (!addFixed(params_, t.text)) return false;
+      } else if (t.type == T_IDENT && toks_[i + 1].type == T_PUNCT && toks_[i + 1].text == "=" && !find(locals_, t.text)) {
+        if (isKeyword(t.text)) return fail("cannot assign to '" + t.text + "'");
+        if (!addFixed(locals_, t.text)) return false;
+      }
+    }
+    top_ = fixed_;
+    return true;
+  }
+
+  static bool isKeyword(const std::string& s) {
+    return s == "if" || s == "else" || s == "return" || s == "fail" || s == "true" || s == "false" || s == "fmt";
+  }
+
+  bool addFixed(std::vector<Name>& list, const std::string& name) {
+    if (fixed_ >= EVAL_REGISTERS) return fail("too many variables");
+    Name n;
+    n.name = name;
+    n.reg = (uint8_t)fixed_++;
+    list.push_back(n);
+    if (fixed_ > p_.registers_) p_.registers_ = (uint8_t)fixed_;
+    return true;
+  }
+
+  static const Name* find(const std::vector<Name>& list, const std::string& name) {
+    for (size_t i = 0; i < list.size(); i++) {
+      if (list[i].name == name) return &list[i];
+    }
+    return nullptr;
+  }
+
+  const Token& peek(size_t ahead = 0) const {
+    size_t i = pos_ + ahead;
+    return i < toks_.size() ? toks_[i] : toks_.back();
+  }
+  bool isPunct(const char* p, size_t ahead = 0) const {
+    const Token& t = peek(ahead);
+    return t.type == T_PUNCT && t.text == p;
+  }
+  // Binary operators do not continue an expression onto a new line.
+  bool isOperator(const char* p) const { return isPunct(p) && !peek().nl; }
+  bool accept(const char* p) {
+    if (!isPunct(p)) return false;
+    pos_++;
+    return true;
+  }
+  bool expect(const char* p) {
+    if (accept(p)) return true;
+    return fail(std::string("expected '") + p + "'");
+  }
+
+  void emit(uint8_t op, uint8_t a, uint8_t b, uint8_t c) {
+    EvalProgram::Instr i = {op, a, b, c};
+    p_.code_.push_back(i);
+  }
+  size_t emitJump(uint8_t op, uint8_t a) {
+    emit(op, a, 0, 0);
+    return p_.code_.size() - 1;
+  }
+  void patch(size_t at) {
+    size_t to = p_.code_.size();
+    p_.code_[at].b = (uint8_t)(to >> 8);
+    p_.code_[at].c = (uint8_t)to;
+  }
+  int addString(const std::string& s) {
+    if (p_.pool_.size() + s.size() + 1 > 0xFFFF || p_.strings_.size() >= 0xFFFF) {
+      fail("program too large");
+      return -1;
+    }
+    p_.strings_.push_back((uint16_t)p_.pool_.size());
+    p_.pool_ += s;
+    p_.pool_ += '\0';
+    return (int)p_.strings_.size() - 1;
+  }
+  int temp() {
+    if (top_ >= EVAL_REGISTERS) {
+      fail("expression too complex");
+      return -1;
+    }
+    if (top_ + 1 > p_.registers_) p_.registers_ = (uint8_t)(top_ + 1);
+    return top_++;
+  }
+  int constant(float v) {
+    if (p_.consts_.size() >= 0xFFFF) {
+      fail("program too large");
+      return -1;
+    }
+    int r = temp();
+    if (r < 0) return -1;
+    size_t k = p_.consts_.size();
+    p_.consts_.push_back(v);
+    emit(OP_LOADK, (uint8_t)r, (uint8_t)(k >> 8), (uint8_t)k);
+    return r;
+  }
+
+  // ---- statements ----
+
+  bool statement() {
+    const Token& t = peek();
+    bool ok;
+    if (t.type == T_PUNCT && t.text == ";") {
+      pos_++;
+      return true;
+    } else if (t.type == T_IDENT && t.text == "if") {
+      ok = ifStatement();
+    } else if (t.type == T_IDENT && t.text == "return") {
+      pos_++;
+      ok = returnStatement();
+    } else if (t.type == T_IDENT && t.text == "fail") {
+      pos_++;
+      emit(OP_FAIL, 0, 0, 0);
+      ok = true;
+    } else if ((t.type == T_IDENT || t.type == T_PARAM) && isPunct("=", 1)) {
+      ok = assignment();
+    } else {
+      return fail("expected a statement");
+    }
+    top_ = fixed_;
+    if (!ok) return false;
+    accept(";");
+    return true;
+  }
+
+  bool block() {
+    if (!accept("{")) return statement();
+    while (!isPunct("}")) {
+      if (peek().type == T_EOF) return fail("missing '}'");
+      if (!statement()) return false;
+    }
+    pos_++;
+    return true;
+  }
+
+  bool ifStatement() {
+    pos_++;
+    if (!expect("(")) return false;
+    int c = expr();
+    if (c < 0 || !expect(")")) return false;
+    size_t jz = emitJump(OP_JZ, (uint8_t)c);
+    top_ = fixed_;
+    if (!block()) return false;
+    if (peek().type == T_IDENT && peek().text == "else") {
+      pos_++;
+      size_t jmp = emitJump(OP_JMP, 0);
+      patch(jz);
+      if (!block()) return false;
+      patch(jmp);
+    } else {
+      patch(jz);
+    }
+    return true;
+  }
+
+  bool returnStatement() {
+    const Token& t = peek();
+    if (t.type == T_STRING) {
+      int s = addString(t.text);
+      if (s < 0) return false;
+      pos_++;
+      emit(OP_RETS, 0, (uint8_t)(s >> 8), (uint8_t)s);
+      return true;
+    }
+    if (t.type == T_IDENT && t.text == "fmt" && isPunct("(", 1)) return formatReturn();
+    int r = expr();
+    if (r < 0) return false;
+    emit(OP_RET, (uint8_t)r, 0, 0);
+    return true;
+  }
+
+  // Only float conversions: every argument is passed as a double.
+  static int countConversions(const std::string& f) {
+    int n = 0;
+    for (size_t i = 0; i < f.size(); i++) {
+      if (f[i] != '%') continue;
+      i++;
+      if (i < f.size() && f[i] == '%') continue;
+      while (i < f.size() && strchr("-+ #0", f[i])) i++;
+      while (i < f.size() && f[i] >= '0' && f[i] <= '9') i++;
+      if (i < f.size() && f[i] == '.') {
+        i++;
+        while (i < f.size() && f[i] >= '0' && f[i] <= '9') i++;
+      }
+      if (i >= f.size() || !strchr("feEgG", f[i])) return -1;
+      n++;
+    }
+    return n;
+  }
+
+  bool formatReturn() {
+    pos_ += 2;
+    if (peek().type != T_STRING) return fail("fmt() needs a format string");
+    std::string f = peek().text;
+    pos_++;
+    int conversions = countConversions(f);
+    if (conversions < 0) return fail("fmt() supports %f, %e and %g only");
+    int first = top_;
+    int argc = 0;
+    while (accept(",")) {
+      if (argc == EVAL_MAX_FMT_ARGS) return fail("too many fmt() arguments");
+      // Arguments go to consecutive registers
+      int slot = temp();
+      if (slot < 0) return false;
+      int r = expr();
+      if (r < 0) return false;
+      if (r != slot) emit(OP_MOV, (uint8_t)slot, (uint8_t)r, 0);
+      top_ = slot + 1;
+      argc++;
+    }
+    if (!expect(")")) return false;
+    if (argc != conversions) return fail("fmt() argument count does not match the format");
+    int s = addString(f);
+    if (s < 0) return false;
+    if (s > 0xFF) return fail("too many strings");
+    emit(OP_RETF, (uint8_t)first, (uint8_t)argc, (uint8_t)s);
+    return true;
+  }
+
+  bool assignment() {
+    const Token& target = peek();
+    pos_ += 2;
+    int r = expr();
+    if (r < 0) return false;
+    if (target.type == T_PARAM) {
+      const Name* n = find(params_, target.text);
+      int s = addString(target.text);
+      if (s < 0) return false;
+      if (r != n->reg) emit(OP_MOV, n->reg, (uint8_t)r, 0);
+      emit(OP_STOREP, n->reg, (uint8_t)(s >> 8), (uint8_t)s);
+    } else {
+      const Name* n = find(locals_, target.text);
+      if (r != n->reg) emit(OP_MOV, n->reg, (uint8_t)r, 0);
+    }
+    return true;
+  }
+
+  // ---- expressions: each returns the register holding its value, -1 on error ----
+
+  int expr() { return ternary(); }
+
+  int ternary() {
+    int base = top_;
+    int c = orExpr();
+    if (c < 0 || !isOperator("?")) return c;
+    pos_++;
+    top_ = base;
+    int dst = temp();
+    if (dst < 0) return -1;
+    // The condition may sit in the register just taken: test it first
+    size_t jz = emitJump(OP_JZ, (uint8_t)c);
+    int a = expr();
+    if (a < 0) return -1;
+    emit(OP_MOV, (uint8_t)dst, (uint8_t)a, 0);
+    if (!expect(":")) return -1;
+    size_t jmp = emitJump(OP_JMP, 0);
+    patch(jz);
+    top_ = dst + 1;
+    int b = expr();
+    if (b < 0) return -1;
+    emit(OP_MOV, (uint8_t)dst, (uint8_t)b, 0);
+    patch(jmp);
+    top_ = dst + 1;
+    return dst;
+  }
+
+  struct BinOp {
+    const char* text;
+    uint8_t op;
+  };
+
+  template <size_t N, typename Next>
+  int binary(const BinOp (&ops)[N], Next next) {
+    int base = top_;
+    int l = (this->*next)();
+    while (l >= 0) {
+      size_t i = 0;
+      while (i < N && !isOperator(ops[i].text)) i++;
+      if (i == N) break;
+      pos_++;
+      int r = (this->*next)();
+      if (r < 0) return -1;
+      top_ = base;
+      int dst = temp();
+      if (dst < 0) return -1;
+      emit(ops[i].op, (uint8_t)dst, (uint8_t)l, (uint8_t)r);
+      l = dst;
+    }
+    return l;
+  }
+
+  int orExpr() { static const BinOp ops[] = {{"||", OP_OR}}; return binary(ops, &EvalCompiler::andExpr); }
+  int andExpr() { static const BinOp ops[] = {{"&&", OP_AND}}; return binary(ops, &EvalCompiler::equality); }
+  int equality() { static const BinOp ops[] = {{"==", OP_EQ}, {"!=", OP_NE}}; return binary(ops, &EvalCompiler::relational); }
+  int relational() {
+    static const BinOp ops[] = {{"<=", OP_LE}, {">=", OP_GE}, {"<", OP_LT}, {">", OP_GT}};
+    return binary(ops, &EvalCompiler::additive);
+  }
+  int additive() { static const BinOp ops[] = {{"+", OP_ADD}, {"-", OP_SUB}}; return binary(ops, &EvalCompiler::multiplicative); }
+  int multiplicative() {
+    static const BinOp ops[] = {{"*", OP_MUL}, {"/", OP_DIV}, {"%", OP_MOD}};
+    return binary(ops, &EvalCompiler::unary);
+  }
+
+  int unary() {
+    if (isPunct("-") || isPunct("!")) {
+      uint8_t op = isPunct("-") ? OP_NEG : OP_NOT;
+      pos_++;
+      int base = top_;
+      int r = unary();
+      if (r < 0) return -1;
+      top_ = base;
+      int dst = temp();
+      if (dst < 0) return -1;
+      emit(op, (uint8_t)dst, (uint8_t)r, 0);
+      return dst;
+    }
+    return primary();
+  }
+
+  int call(const std::string& fn) {
+    static const struct { const char* name; uint8_t op; int argc; } builtins[] = {
+        {"min", OP_MIN, 2}, {"max", OP_MAX, 2}, {"abs", OP_ABS, 1}, {"round", OP_ROUND, 1},
+        {"floor", OP_FLOOR, 1}, {"ceil", OP_CEIL, 1}, {"sqrt", OP_SQRT, 1}, {"clamp", OP_CLAMP, 3}};
+    size_t i = 0;
+    while (i < sizeof(builtins) / sizeof(builtins[0]) && fn != builtins[i].name) i++;
+    if (i == sizeof(builtins) / sizeof(builtins[0])) {
+      fail("unknown function '" + fn + "'");
+      return -1;
+    }
+    pos_ += 2;  // name and '('
+    int base = top_;
+    int args[3];
+    for (int a = 0; a < builtins[i].argc; a++) {
+      if (a > 0 && !expect(",")) return -1;
+      if (builtins[i].op == OP_CLAMP && a > 0) {
+        // lo and hi go to consecutive registers
+        int slot = temp();
+        if (slot < 0) return -1;
+        int r = expr();
+        if (r < 0) return -1;
+        if (r != slot) emit(OP_MOV, (uint8_t)slot, (uint8_t)r, 0);
+        top_ = slot + 1;
+        args[a] = slot;
+      } else {
+        args[a] = expr();
+        if (args[a] < 0) return -1;
+      }
+    }
+    if (!expect(")")) return -1;
+    int dst;
+    if (builtins[i].op == OP_CLAMP) {
+      dst = temp();  // above lo/hi, which must survive until the instruction runs
+    } else {
+      top_ = base;
+      dst = temp();
+    }
+    if (dst < 0) return -1;
+    emit(builtins[i].op, (uint8_t)dst, (uint8_t)args[0], (uint8_t)(builtins[i].argc > 1 ? args[1] : 0));
+    return dst;
+  }
+
+  int primary() {
+    const Token& t = peek();
+    if (t.type == T_NUM) {
+      pos_++;
+      return constant(t.num);
+    }
+    if (t.type == T_PARAM) {
+      pos_++;
+      return find(params_, t.text)->reg;
+    }
+    if (t.type == T_IDENT) {
+      if (t.text == "true" || t.text == "false") {
+        pos_++;
+        return constant(t.text == "true" ? 1.0f : 0.0f);
+      }
+      if (isPunct("(", 1)) return call(t.text);
+      const Name* n = find(locals_, t.text);
+      if (!n) {
+        fail("unknown name '" + t.text + "'");
+        return -1;
+      }
+      pos_++;
+      return n->reg;
+    }
+    if (accept("(")) {
+      int r = expr();
+      if (r < 0 || !expect(")")) return -1;
+      return r;
+    }
+    fail(t.type == T_EOF ? "unexpected end" : "unexpected '" + t.text + "'");
+    return -1;
+  }
+
+  EvalProgram& p_;
+  std::vector<Token> toks_;
+  size_t pos_;
+  std::vector<Name> params_;
+  std::vector<Name> locals_;
+  int fixed_;  // registers of params and locals
+  int top_;    // next free temporary
+};
+
+bool EvalProgram::compile(const char* source) {
+  code_.clear();
+  consts_.clear();
+  strings_.clear();
+  pool_.clear();
+  registers_ = 0;
+  error_.clear();
+  EvalCompiler c(*this);
+  if (!source || !c.compile(source)) {
+    if (error_.empty()) error_ = "no source";
+    code_.clear();
+    return false;
+  }
+  return true;
+}
+
+// ---- interpreter ------------------------------------------------------------
+
+static void formatNumber(float v, char* out, size_t outSize) {
+  if (isfinite(v) && fabsf(v) < 1e9f && v == (float)(long)v) snprintf(out, outSize, "%ld", (long)v);
+  else snprintf(out, outSize, "%g", (double)v);
+}
+
+EvalStatus EvalProgram::run(EvalEnv& env, char* out, size_t outSize) const {
+  if (outSize) out[0] = '\0';
+  if (code_.empty()) return EVAL_FAILED;
+  float r[EVAL_REGISTERS];
+  memset(r, 0, sizeof(float) * registers_);
+  const Instr* code = code_.data();
+  const char* pool = pool_.c_str();
+  size_t pc = 0;
+  for (uint32_t steps = 0; steps < EVAL_MAX_STEPS; steps++) {
+    const Instr& i = code[pc++];
+    uint16_t bc = (uint16_t)((i.b << 8) | i.c);
+    switch (i.op) {
+      case OP_END: return EVAL_OK;
+      case OP_LOADK: r[i.a] = consts_[bc]; break;
+      case OP_LOADP: if (!env.get(pool + strings_[bc], r[i.a])) r[i.a] = 0.0f; break;
+      case OP_STOREP: env.set(pool + strings_[bc], r[i.a]); break;
+      case OP_MOV: r[i.a] = r[i.b]; break;
+      case OP_ADD: r[i.a] = r[i.b] + r[i.c]; break;
+      case OP_SUB: r[i.a] = r[i.b] - r[i.c]; break;
+      case OP_MUL: r[i.a] = r[i.b] * r[i.c]; break;
+      case OP_DIV: r[i.a] = r[i.b] / r[i.c]; break;
+      case OP_MOD: r[i.a] = fmodf(r[i.b], r[i.c]); break;
+      case OP_LT: r[i.a] = r[i.b] < r[i.c]; break;
+      case OP_LE: r[i.a] = r[i.b] <= r[i.c]; break;
+      case OP_GT: r[i.a] = r[i.b] > r[i.c]; break;
+      case OP_GE: r[i.a] = r[i.b] >= r[i.c]; break;
+      case OP_EQ: r[i.a] = r[i.b] == r[i.c]; break;
+      case OP_NE: r[i.a] = r[i.b] != r[i.c]; break;
+      case OP_AND: r[i.a] = r[i.b] != 0.0f && r[i.c] != 0.0f; break;
+      case OP_OR: r[i.a] = r[i.b] != 0.0f || r[i.c] != 0.0f; break;
+      case OP_MIN: r[i.a] = r[i.b] < r[i.c] ? r[i.b] : r[i.c]; break;
+      case OP_MAX: r[i.a] = r[i.b] > r[i.c] ? r[i.b] : r[i.c]; break;
+      case OP_NEG: r[i.a] = -r[i.b]; break;
+      case OP_NOT: r[i.a] = r[i.b] == 0.0f; break;
+      case OP_ABS: r[i.a] = fabsf(r[i.b]); break;
+      case OP_ROUND: r[i.a] = roundf(r[i.b]); break;
+      case OP_FLOOR: r[i.a] = floorf(r[i.b]); break;
+      case OP_CEIL: r[i.a] = ceilf(r[i.b]); break;
+      case OP_SQRT: r[i.a] = sqrtf(r[i.b]); break;
+      case OP_CLAMP: {
+        float v = r[i.b], lo = r[i.c], hi = r[i.c + 1];
+        r[i.a] = v < lo ? lo : (v > hi ? hi : v);
+        break;
+      }
+      case OP_JMP: pc = bc; break;
+      case OP_JZ: if (r[i.a] == 0.0f) pc = bc; break;
+      case OP_RET: formatNumber(r[i.a], out, outSize); return EVAL_OK;
+      case OP_RETS: snprintf(out, outSize, "%s", pool + strings_[bc]); return EVAL_OK;
+      case OP_RETF: {
+        double v[EVAL_MAX_FMT_ARGS] = {0, 0, 0, 0};
+        for (uint8_t k = 0; k < i.b; k++) v[k] = r[i.a + k];
+        snprintf(out, outSize, pool + strings_[i.c], v[0], v[1], v[2], v[3]);
+        return EVAL_OK;
+      }
+      case OP_FAIL: return EVAL_FAILED;
+      default: return EVAL_FAILED;
+    }
+  }
+  return EVAL_STEP_LIMIT;
+}
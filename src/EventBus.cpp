@@ -0,0 +1,146 @@
+#include "EventBus.h"
+#include "ModuleManager.h"
+#include "ModuleRegistry.h"
+
+EventBus::EventBus() : topicCount_(0), freeTop_(EVENT_BUS_PAYLOAD_SLOTS), payloadExhausted_(0) {
+  portMUX_INITIALIZE(&lock_);
+  for (size_t i = 0; i < EVENT_BUS_PAYLOAD_SLOTS; i++) {
+    payloads_[i].refs.store(0);
+    payloads_[i].size = 0;
+    freePayloads_[i] = (uint8_t)i;
+  }
+}
+
+EventBus::Topic* EventBus::findTopic(SymbolId id) {
+  for (size_t i = 0; i < topicCount_; i++) {
+    if (topics_[i].id == id) return &topics_[i];
+  }
+  return nullptr;
+}
+
+bool EventBus::subscribe(const String& topic, Module* subscriber, const String& callName) {
+  SymbolId tid = SymbolTable::global().intern(topic.c_str());
+  SymbolId cid = SymbolTable::global().intern(callName.c_str());
+  if (!subscriber || tid == SYMBOL_NONE || cid == SYMBOL_NONE) return false;
+  bool ok = false;
+  portENTER_CRITICAL(&lock_);
+  Topic* t = findTopic(tid);
+  if (!t && topicCount_ < EVENT_BUS_MAX_TOPICS) {
+    t = &topics_[topicCount_++];
+    t->id = tid;
+    t->subscriberCount = 0;
+    t->published = t->delivered = t->dropped = 0;
+  }
+  if (t) {
+    size_t i = 0;
+    for (; i < t->subscriberCount; i++) {
+      if (t->subscribers[i].module == subscriber) break;
+    }
+    if (i < t->subscriberCount) {
+      t->subscribers[i].callId = cid;
+      ok = true;
+    } else if (t->subscriberCount < EVENT_BUS_MAX_SUBSCRIBERS) {
+      t->subscribers[t->subscriberCount++] = Subscriber{subscriber, cid};
+      ok = true;
+    }
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+bool EventBus::unsubscribe(const String& topic, Module* subscriber) {
+  SymbolId tid = SymbolTable::global().find(topic.c_str());
+  bool ok = false;
+  portENTER_CRITICAL(&lock_);
+  Topic* t = findTopic(tid);
+  if (t) {
+    for (size_t i = 0; i < t->subscriberCount; i++) {
+      if (t->subscribers[i].module != subscriber) continue;
+      t->subscribers[i] = t->subscribers[--t->subscriberCount];
+      ok = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+SharedPayload* EventBus::allocPayload() {
+  SharedPayload* p = nullptr;
+  portENTER_CRITICAL(&lock_);
+  if (freeTop_ > 0) p = &payloads_[freePayloads_[--freeTop_]];
+  else payloadExhausted_++;
+  portEXIT_CRITICAL(&lock_);
+  return p;
+}
+
+void EventBus::releasePayload(SharedPayload* p) {
+  if (p->refs.fetch_sub(1) != 1) return;
+  portENTER_CRITICAL(&lock_);
+  freePayloads_[freeTop_++] = (uint8_t)(p - payloads_);
+  portEXIT_CRITICAL(&lock_);
+}
+
+size_t EventBus::publish(SymbolId topicId, const void* data, uint16_t size, const String& from) {
+  if (size > SHARED_PAYLOAD_MAX) return 0;
+  Subscriber subs[EVENT_BUS_MAX_SUBSCRIBERS];
+  size_t count = 0;
+  portENTER_CRITICAL(&lock_);
+  Topic* t = findTopic(topicId);
+  if (t) {
+    t->published++;
+    count = t->subscriberCount;
+    for (size_t i = 0; i < count; i++) subs[i] = t->subscribers[i];
+  }
+  portEXIT_CRITICAL(&lock_);
+  if (count == 0) return 0;
+
+  size_t delivered = 0;
+  SharedPayload* p = allocPayload();
+  if (p) {
+    memcpy(p->data, data, size);
+    p->size = size;
+    p->refs.store(1);  // held by this publish until fan-out is done
+    for (size_t i = 0; i < count; i++) {
+      Module* m = subs[i].module;
+      QueueBase* q = m->getState() == MODULE_ENABLED ? m->getQueue() : nullptr;
+      QueueMessage* msg = q ? q->acquire() : nullptr;
+      if (!msg) continue;
+      msg->fromQueue = from;
+      msg->callName = SymbolTable::global().name(subs[i].callId);
+      msg->callId = subs[i].callId;
+      p->refs.fetch_add(1);
+      msg->shared = p;
+      if (q->send(msg)) delivered++;
+    }
+    releasePayload(p);
+  }
+  portENTER_CRITICAL(&lock_);
+  t = findTopic(topicId);
+  if (t) {
+    t->delivered += delivered;
+    t->dropped += count - delivered;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return delivered;
+}
+
+void EventBus::toJson(JsonObject out) const {
+  out["payload_slots"] = EVENT_BUS_PAYLOAD_SLOTS;
+  out["payload_free"] = freeTop_;
+  out["payload_exhausted"] = payloadExhausted_;
+  JsonArray arr = out.createNestedArray("topics");
+  for (size_t i = 0; i < topicCount_; i++) {
+    const Topic& t = topics_[i];
+    JsonObject o = arr.createNestedObject();
+    o["topic"] = SymbolTable::global().name(t.id);
+    o["subscribers"] = t.subscriberCount;
+    o["published"] = t.published;
+    o["delivered"] = t.delivered;
+    o["dropped"] = t.dropped;
+  }
+}
+
+void sharedPayloadRelease(SharedPayload* p) {
+  if (p) ModuleRegistry::getInstance()->bus().releasePayload(p);
+}
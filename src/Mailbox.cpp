@@ -0,0 +1,84 @@
+#include "Mailbox.h"
+
+Mailbox::Mailbox() : count_(0) {
+  portMUX_INITIALIZE(&lock_);
+  for (size_t i = 0; i < MAILBOX_MAX_KEYS; i++) slots_[i] = Slot{SYMBOL_NONE, nullptr, 0, 0, 0};
+}
+
+bool Mailbox::addKey(SymbolId callId) {
+  if (callId == SYMBOL_NONE) return false;
+  if (accepts(callId)) return true;
+  // Coalescing queues add keys from producer tasks, so this can race with itself
+  portENTER_CRITICAL(&lock_);
+  bool ok = accepts(callId);
+  if (!ok && count_ < MAILBOX_MAX_KEYS) {
+    slots_[count_].callId = callId;
+    count_++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+bool Mailbox::accepts(SymbolId callId) const {
+  for (size_t i = 0; i < count_; i++) {
+    if (slots_[i].callId == callId) return true;
+  }
+  return false;
+}
+
+QueueMessage* Mailbox::post(QueueMessage* msg) {
+  QueueMessage* displaced = nullptr;
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < count_; i++) {
+    Slot& s = slots_[i];
+    if (s.callId != msg->callId) continue;
+    displaced = s.pending;
+    s.pending = msg;
+    s.posted++;
+    if (displaced) s.coalesced++;
+    break;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return displaced;
+}
+
+size_t Mailbox::take(QueueMessage** out, size_t maxCount) {
+  size_t n = 0;
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < count_ && n < maxCount; i++) {
+    Slot& s = slots_[i];
+    if (!s.pending) continue;
+    out[n++] = s.pending;
+    s.pending = nullptr;
+    s.delivered++;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return n;
+}
+
+size_t Mailbox::pending() const {
+  size_t n = 0;
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < count_; i++) {
+    if (slots_[i].pending) n++;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return n;
+}
+
+void Mailbox::toJson(JsonObject out) const {
+  uint32_t coalesced = 0;
+  JsonArray keys = out.createNestedArray("keys");
+  for (size_t i = 0; i < count_; i++) {
+    const Slot& s = slots_[i];
+    JsonObject k = keys.createNestedObject();
+    k["call"] = SymbolTable::global().name(s.callId);
+    k["posted"] = s.posted;
+    k["coalesced"] = s.coalesced;
+    k["delivered"] = s.delivered;
+    k["pending"] = s.pending != nullptr;
+    coalesced += s.coalesced;
+  }
+  out["coalesced"] = coalesced;
+}
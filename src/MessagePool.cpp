@@ -0,0 +1,110 @@
+#include "MessagePool.h"
+
+MessagePool::MessagePool(size_t count, size_t payloadSize)
+    : count_(count), payloadSize_(payloadSize), slab_(nullptr), docs_(nullptr), freeList_(nullptr),
+      freeTop_(0), inUse_(0), highWater_(0), acquired_(0), exhausted_(0) {
+  portMUX_INITIALIZE(&lock_);
+}
+
+MessagePool::~MessagePool() { destroy(); }
+
+bool MessagePool::create(const String& toQueue) {
+  if (slab_) return true;
+  if (count_ == 0 || count_ > 0xFFFF) return false;
+  slab_ = new QueueMessage[count_];
+  docs_ = new DynamicJsonDocument*[count_];
+  freeList_ = new uint16_t[count_];
+  SymbolId toId = SymbolTable::global().intern(toQueue.c_str());
+  for (size_t i = 0; i < count_; i++) {
+    QueueMessage& m = slab_[i];
+    m.eventId = 0;
+    m.toQueue = toQueue;
+    m.fromQueue.reserve(24);
+    m.callName.reserve(24);
+    m.eventType = EVENT_NONE;
+    m.callType = CALL_NONE;
+    m.callVariables = nullptr;
+    m.pool = this;
+    m.toId = toId;
+    m.callId = SYMBOL_NONE;
+    m.payloadSize = 0;
+    m.lane = QUEUE_LANE_BULK;
+    m.shared = nullptr;
+    docs_[i] = nullptr;
+    freeList_[i] = (uint16_t)(count_ - 1 - i);
+  }
+  freeTop_ = count_;
+  inUse_ = 0;
+  return true;
+}
+
+void MessagePool::destroy() {
+  if (!slab_) return;
+  for (size_t i = 0; i < count_; i++) {
+    if (docs_[i]) delete docs_[i];
+  }
+  delete[] docs_;
+  delete[] freeList_;
+  delete[] slab_;
+  docs_ = nullptr;
+  freeList_ = nullptr;
+  slab_ = nullptr;
+  freeTop_ = 0;
+  inUse_ = 0;
+}
+
+QueueMessage* MessagePool::acquire() {
+  if (!slab_) return nullptr;
+  int idx = -1;
+  portENTER_CRITICAL(&lock_);
+  if (freeTop_ > 0) {
+    idx = freeList_[--freeTop_];
+    inUse_++;
+    if (inUse_ > highWater_) highWater_ = inUse_;
+    acquired_++;
+  } else {
+    exhausted_++;
+  }
+  portEXIT_CRITICAL(&lock_);
+  if (idx < 0) return nullptr;
+  // First use of a slot allocates its payload document; it is reused afterwards.
+  if (!docs_[idx]) docs_[idx] = new DynamicJsonDocument(payloadSize_);
+  QueueMessage* m = &slab_[idx];
+  m->eventType = EVENT_DATA_READY;
+  m->callType = CALL_FUNCTION_ASYNC;
+  m->callId = SYMBOL_NONE;
+  m->payloadSize = 0;
+  m->correlationId = 0;
+  m->eventId = 0;
+  m->lane = QUEUE_LANE_BULK;
+  m->callVariables = docs_[idx];
+  m->callVariables->clear();
+  return m;
+}
+
+void MessagePool::release(QueueMessage* msg) {
+  if (!owns(msg)) return;
+  size_t idx = (size_t)(msg - slab_);
+  msg->callVariables = docs_[idx];
+  if (msg->shared) {
+    sharedPayloadRelease(msg->shared);
+    msg->shared = nullptr;
+  }
+  portENTER_CRITICAL(&lock_);
+  freeList_[freeTop_++] = (uint16_t)idx;
+  inUse_--;
+  portEXIT_CRITICAL(&lock_);
+}
+
+bool MessagePool::owns(const QueueMessage* msg) const {
+  return slab_ && msg >= slab_ && msg < slab_ + count_;
+}
+
+void MessagePool::toJson(JsonObject out) const {
+  out["capacity"] = count_;
+  out["payload_size"] = payloadSize_;
+  out["in_use"] = inUse_;
+  out["high_water"] = highWater_;
+  out["acquired"] = acquired_;
+  out["exhausted"] = exhausted_;
+}
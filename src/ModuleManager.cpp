@@ -6,6 +6,9 @@
 #include <algorithm>
 #include "ModuleRegistry.h"
 #include "FreeRTOSTypes.h"
+#include "esp_timer.h"
+#include "WorkerPool.h"
+#include "Trace.h"
 
 ModuleManager* ModuleManager::instance = nullptr;
 
@@ -19,14 +22,117 @@ Module::Module(const char* name) : moduleName(name), state(MODULE_DISABLED),
     queueBase = nullptr;
     useTask = true;
     useQueue = false;
-    taskCfg = {String(name) + String("_TASK"), 4096, 3, nullptr, -1};
-    queueCfg = {8, sizeof(QueueMessage*), portMAX_DELAY, pdMS_TO_TICKS(100), false};
+    usePool = false;
+    runnerTask = nullptr;
+    periodMs = 10;
+    held.store(false);
+    memset(cpuUsage, 0, sizeof(cpuUsage));
+    portMUX_INITIALIZE(&cpuLock);
+    moduleId = SymbolTable::global().intern(name);
+    stateVar = ModuleRegistry::getInstance()->vars().define(name, "state", VAR_INT);
+    taskCfg = {String(name) + String("_TASK"), 4096, 3, nullptr, -1, false};
+    queueCfg = {8, sizeof(QueueMessage*), portMAX_DELAY, pdMS_TO_TICKS(100), false, 256, 8, 0, {}, QUEUE_POLICY_DROP_NEWEST, {}, 4};
 }
 
 Module::~Module() {
     if (config) delete config;
 }
 
+void Module::setState(ModuleState s) {
+    state = s;
+    ModuleRegistry::getInstance()->vars().setInt(stateVar, (int32_t)s);
+}
+
+size_t Module::drainQueue(TickType_t firstWait) {
+    if (!queueBase) return 0;
+    const QueueConfig& qc = queueBase->config();
+    QueueMessage* batch[QUEUE_BATCH_MAX];
+    size_t maxCount = qc.batchSize < 1 ? 1 : (qc.batchSize < QUEUE_BATCH_MAX ? qc.batchSize : QUEUE_BATCH_MAX);
+    int64_t deadline = qc.batchBudgetUs ? esp_timer_get_time() + qc.batchBudgetUs : 0;
+    size_t total = 0;
+    for (;;) {
+        int64_t left = deadline ? deadline - esp_timer_get_time() : 0;
+        size_t n = queueBase->receiveBatch(batch, maxCount, left > 0 ? (uint32_t)left : 0, total ? 0 : firstWait);
+        for (size_t i = 0; i < n; i++) {
+            TRACE_SCOPE_ARG("queue", SymbolTable::global().name(moduleId), SymbolTable::global().name(batch[i]->callId));
+            int64_t t0 = esp_timer_get_time();
+            // Rpc requests are executed here so modules need no code of their own for them
+            if (batch[i]->correlationId) ModuleRegistry::getInstance()->rpc().serve(this, batch[i]);
+            else handleMessage(batch[i]);
+            uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+            // Served Rpc calls are accounted by the registry as CPU_WORK_CALL
+            if (!batch[i]->correlationId) recordCpu(CPU_WORK_MESSAGE, us);
+            queueBase->recordHandled(batch[i], us);
+            queueBase->recycle(batch[i]);
+        }
+        total += n;
+        // Without a budget one batch per wake; with one, keep going while the queue has work.
+        if (n < maxCount || !deadline || esp_timer_get_time() >= deadline) break;
+    }
+    return total;
+}
+
+void Module::handleMessage(QueueMessage* msg) {
+    if (!msg) return;
+    String result;
+    if (!ModuleRegistry::getInstance()->callFunction(moduleId, msg, result) && debugEnabled) {
+        log("Unhandled message " + msg->callName + " from " + msg->fromQueue, "DEBUG");
+    }
+}
+
+void Module::recordCpu(ModuleCpuWork work, uint32_t us) {
+    ModuleCpuCounter& c = cpuUsage[work];
+    portENTER_CRITICAL(&cpuLock);
+    c.calls++;
+    c.totalUs += us;
+    if (us > c.maxUs) c.maxUs = us;
+    portEXIT_CRITICAL(&cpuLock);
+}
+
+ModuleCpuCounter Module::cpuCounter(ModuleCpuWork work) {
+    portENTER_CRITICAL(&cpuLock);
+    ModuleCpuCounter c = cpuUsage[work];
+    portEXIT_CRITICAL(&cpuLock);
+    return c;
+}
+
+void Module::cpuToJson(JsonObject out) {
+    static const char* const names[CPU_WORK_COUNT] = {"update", "message", "call"};
+    ModuleCpuCounter snap[CPU_WORK_COUNT];
+    portENTER_CRITICAL(&cpuLock);
+    memcpy(snap, cpuUsage, sizeof(snap));
+    portEXIT_CRITICAL(&cpuLock);
+    uint64_t busy = 0;
+    for (int i = 0; i < CPU_WORK_COUNT; i++) {
+        JsonObject o = out.createNestedObject(names[i]);
+        o["calls"] = snap[i].calls;
+        o["total_us"] = snap[i].totalUs;
+        o["avg_us"] = snap[i].calls ? (uint32_t)(snap[i].totalUs / snap[i].calls) : 0;
+        o["max_us"] = snap[i].maxUs;
+        busy += snap[i].totalUs;
+    }
+    int64_t uptime = esp_timer_get_time();
+    out["busy_us"] = busy;
+    out["busy_pct"] = uptime > 0 ? (float)(busy * 100.0 / uptime) : 0.0f;
+}
+
+void Module::notifyWork() {
+    if (usePool) {
+        WorkerPool::global().wake(this);
+        return;
+    }
+    TaskHandle_t h = taskBase ? taskBase->handle() : ModuleManager::getInstance()->getLoopTask();
+    if (h) xTaskNotifyGive(h);
+}
+
+void IRAM_ATTR Module::notifyWorkFromISR() {
+    TaskHandle_t h = runnerTask;
+    if (!h) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(h, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
 bool Module::loadConfig(DynamicJsonDocument& doc) {
     JsonObject modConfig;
     if (doc.containsKey(moduleName)) modConfig = doc[moduleName];
@@ -50,7 +156,10 @@ bool Module::loadConfig(DynamicJsonDocument& doc) {
                 if (tk.containsKey("stack")) taskCfg.stackSize = tk["stack"];
                 if (tk.containsKey("priority")) taskCfg.priority = tk["priority"];
                 if (tk.containsKey("core")) taskCfg.core = tk["core"];
+                if (tk.containsKey("pinned")) taskCfg.pinned = tk["pinned"];
                 if (tk.containsKey("enabled")) useTask = tk["enabled"];
+                if (tk.containsKey("period_ms")) periodMs = tk["period_ms"];
+                if (tk.containsKey("pool")) usePool = tk["pool"];
             }
             if (fr.containsKey("queue")) {
                 JsonObject qj = fr["queue"];
@@ -58,9 +167,34 @@ bool Module::loadConfig(DynamicJsonDocument& doc) {
                 queueCfg.itemSize = sizeof(QueueMessage*);
                 if (qj.containsKey("send_timeout_ms")) queueCfg.sendTimeoutTicks = pdMS_TO_TICKS((int)qj["send_timeout_ms"]);
                 if (qj.containsKey("recv_timeout_ms")) queueCfg.recvTimeoutTicks = pdMS_TO_TICKS((int)qj["recv_timeout_ms"]);
+                if (qj.containsKey("payload_size")) queueCfg.payloadSize = qj["payload_size"];
+                // The runner is the only consumer of a module queue, so it always drains
+                if (qj.containsKey("batch_size")) queueCfg.batchSize = std::max(1, qj["batch_size"].as<int>());
+                if (qj.containsKey("batch_budget_us")) queueCfg.batchBudgetUs = qj["batch_budget_us"];
+                if (qj.containsKey("allow_isr")) queueCfg.allowISR = qj["allow_isr"];
+                if (qj.containsKey("policy")) queueCfg.policy = queuePolicyFromName(qj["policy"].as<String>());
+                if (qj.containsKey("mailbox")) {
+                    queueCfg.mailbox.clear();
+                    for (JsonVariant v : qj["mailbox"].as<JsonArray>()) queueCfg.mailbox.push_back(v.as<String>());
+                }
+                if (qj.containsKey("urgent")) {
+                    queueCfg.urgent.clear();
+                    for (JsonVariant v : qj["urgent"].as<JsonArray>()) queueCfg.urgent.push_back(v.as<String>());
+                }
+                if (qj.containsKey("urgent_length")) queueCfg.urgentLength = qj["urgent_length"];
                 if (qj.containsKey("enabled")) useQueue = qj["enabled"];
             }
         }
+        if (modConfig.containsKey("eval")) {
+            // Compiled once here; each call then runs the bytecode
+            for (JsonPair kv : modConfig["eval"].as<JsonObject>()) {
+                String fn = kv.key().c_str();
+                String err;
+                if (!ModuleRegistry::getInstance()->registerFunctionEval(moduleName, fn, kv.value().as<String>(), &err).valid()) {
+                    log("eval " + fn + ": " + (err.length() ? err : String("register failed")), "ERROR");
+                }
+            }
+        }
         return true;
     }
     return false;
@@ -76,17 +210,27 @@ void Module::log(const String& message, const char* level) {
     Serial.println(logMsg);
     
     // Also log to file system if CONTROL_FS is available
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (fsModule && fsModule->getState() == MODULE_ENABLED) {
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (fs && fs->getState() == MODULE_ENABLED) {
         fs->writeLog(logMsg, level);
     }
     ModuleManager::getInstance()->appendLCDLog(logMsg);
 }
 
+void Module::dependsOn(const String& name) {
+    if (std::find(dependencies.begin(), dependencies.end(), name) == dependencies.end()) dependencies.push_back(name);
+}
+
+void Module::startAfter(const String& name) {
+    if (std::find(startsAfter.begin(), startsAfter.end(), name) == startsAfter.end()) startsAfter.push_back(name);
+}
+
 // ModuleManager implementation
-ModuleManager::ModuleManager() {
-    wifiConnectedLast = false;
+ModuleManager::ModuleManager() : generation(1) {
+    loopTask = nullptr;
+    handleLock = portMUX_INITIALIZER_UNLOCKED;
+    lcdLogLock = xSemaphoreCreateMutex();
+    bootLock = xSemaphoreCreateMutex();
 }
 
 ModuleManager* ModuleManager::getInstance() {
@@ -108,6 +252,7 @@ bool ModuleManager::registerModule(Module* module) {
     }
     
     modules.push_back(module);
+    generation.fetch_add(1, std::memory_order_release);
     Serial.println("Module " + module->getName() + " registered successfully");
     return true;
 }
@@ -116,23 +261,64 @@ bool ModuleManager::unregisterModule(const String& name) {
     for (size_t i = 0; i < modules.size(); i++) {
         if (modules[i]->getName() == name) {
             modules[i]->stop();
-            delete modules[i];
+            Module* gone = modules[i];
+            // Registry entries and the worker pool cache the module pointer
+            ModuleRegistry::getInstance()->unregisterModuleFunctions(gone->getId());
+            if (gone->getUsePool()) WorkerPool::global().detach(gone);
             modules.erase(modules.begin() + i);
+            for (size_t g = 0; g < gates.size(); g++) {
+                if (gates[g].module == gone) { gates.erase(gates.begin() + g); break; }
+            }
+            // Invalidate handles before the module is freed
+            generation.fetch_add(1, std::memory_order_release);
+            delete gone;
             return true;
         }
     }
     return false;
 }
 
+CONTROL_FS* ModuleManager::getFS() {
+    return fsHandle.get();
+}
+
 Module* ModuleManager::getModule(const String& name) {
+    SymbolId id = SymbolTable::global().find(name.c_str());
+    if (id != SYMBOL_NONE) return getModule(id);
+    // Not interned (symbol table full when the module was created): compare names
     for (auto* mod : modules) {
-        if (mod->getName() == name) {
+        if (mod->getId() == SYMBOL_NONE && mod->getName() == name) {
             return mod;
         }
     }
     return nullptr;
 }
 
+Module* ModuleManager::getModule(SymbolId id) {
+    if (id == SYMBOL_NONE) return nullptr;
+    for (auto* mod : modules) {
+        if (mod->getId() == id) {
+            return mod;
+        }
+    }
+    return nullptr;
+}
+
+Module* ModuleManager::resolveHandle(const char* name, std::atomic<Module*>& module, std::atomic<uint32_t>& cachedGeneration) {
+    uint32_t g = getGeneration();
+    SymbolId id = SymbolTable::global().find(name);
+    Module* m = id != SYMBOL_NONE ? getModule(id) : getModule(String(name));
+    // Refreshes are serialized, so the cache always holds a pointer/generation pair
+    // from one lookup. If a module was (un)registered meanwhile, g is already stale
+    // and the next get() looks up again.
+    portENTER_CRITICAL(&handleLock);
+    cachedGeneration.store(0, std::memory_order_release);
+    module.store(m, std::memory_order_release);
+    cachedGeneration.store(g, std::memory_order_release);
+    portEXIT_CRITICAL(&handleLock);
+    return m;
+}
+
 void ModuleManager::sortModulesByPriority() {
     std::sort(modules.begin(), modules.end(), 
               [](Module* a, Module* b) { 
@@ -142,59 +328,123 @@ void ModuleManager::sortModulesByPriority() {
 
 bool ModuleManager::initModules() {
     sortModulesByPriority();
+    // Every module logs through the filesystem, so it boots first
+    for (auto* mod : modules) {
+        if (mod->getName() != fsHandle.getName()) mod->startAfter(fsHandle.getName());
+    }
     
     Serial.println("Initializing modules...");
-    int idx = 0;
-    for (auto* mod : modules) {
+    TRACE_SCOPE("boot", "init");
+    std::atomic<int> done(0);
+    int total = modules.size();
+    // Independent modules init in parallel, one boot worker per core
+    bool ok = bootGraph.run("init", modules, [&](Module* mod) {
+        TRACE_SCOPE_ARG("module", "init", SymbolTable::global().name(mod->getId()));
         Serial.println("Init: " + mod->getName());
-        int percent = (int)((idx * 100.0) / modules.size());
-        renderLoadingStep(String("Init ")+mod->getName(), percent);
-        if (!mod->init()) {
+        renderLoadingStep(String("Init ")+mod->getName(), (int)((done.load() * 100.0) / total));
+        bool inited = mod->init();
+        if (!inited) {
             mod->setState(MODULE_ERROR);
             Serial.println("Failed to init: " + mod->getName());
-            if (mod->isCritical()) return false;
         }
-        renderLoadingStep(String("Initialized ")+mod->getName(), percent);
-        idx++;
-    }
+        renderLoadingStep(String("Initialized ")+mod->getName(), (int)((++done * 100.0) / total));
+        return inited;
+    });
+    Serial.println("Boot " + bootGraph.summary("init"));
+    if (!ok) return false;
     renderLoadingStep("Init completed", 100);
     return true;
 }
 
+void ModuleManager::applyDependencyConfig() {
+    CONTROL_FS* fs = fsHandle.get();
+    if (!fs || !fs->getConfigManager()) return;
+    for (auto* mod : modules) {
+        JsonVariant deps;
+        if (fs->getConfigManager()->getConfigValue("modules." + mod->getName() + ".depends_on", deps)) {
+            for (JsonVariant d : deps.as<JsonArray>()) mod->dependsOn(d.as<String>());
+        }
+        JsonVariant after;
+        if (fs->getConfigManager()->getConfigValue("modules." + mod->getName() + ".after", after)) {
+            for (JsonVariant d : after.as<JsonArray>()) mod->startAfter(d.as<String>());
+        }
+    }
+}
+
+bool ModuleManager::dependenciesReady(Module* mod) {
+    for (const String& name : mod->getDependencies()) {
+        Module* dep = getModule(name);
+        // An unknown name was already reported by the boot graph and is ignored
+        if (dep && !dep->isReady()) return false;
+    }
+    return true;
+}
+
 bool ModuleManager::startModules() {
     Serial.println("Starting modules...");
-    int total = modules.size();
-    int done = 0;
+    TRACE_SCOPE("boot", "start");
+    CONTROL_FS* fs = fsHandle.get();
+    if (fs && fs->getConfigManager()) {
+        JsonVariant sp;
+        if (fs->getConfigManager()->getConfigValue("system.stack_profile", sp)) stackProfiler.configure(sp);
+        JsonVariant cp;
+        if (fs->getConfigManager()->getConfigValue("system.core_planner", cp)) corePlanner.configure(cp);
+    }
+    bool profiled = stackProfiler.load();
+    corePlanner.load();
+    // The filesystem is up by now, so config dependencies apply from this phase on
+    applyDependencyConfig();
+    gates.clear();
     for (auto* mod : modules) {
-        if (mod->isAutoStart() && mod->getState() == MODULE_ENABLED) {
-            Serial.println("Starting: " + mod->getName());
-            done++;
-            int percent = (int)((done * 100.0) / total);
-            renderLoadingStep(String("Start ")+mod->getName(), percent);
-            bool allowStart = true;
-            if (mod->getName() == "CONTROL_WEB") {
-                Module* wifiMod = getModule("CONTROL_WIFI");
-                CONTROL_WIFI* wf = wifiMod ? static_cast<CONTROL_WIFI*>(wifiMod) : nullptr;
-                if (wf && !wf->isWiFiConnected()) allowStart = false;
-            }
-            if (allowStart && !mod->start()) {
-                mod->setState(MODULE_ERROR);
-                Serial.println("Failed to start: " + mod->getName());
-                if (mod->isCritical()) return false;
-            }
-            ensureModuleQueue(mod);
-            startModuleTask(mod);
-            renderLoadingStep(String("Started ")+mod->getName(), percent);
+        if (!mod->getDependencies().empty() && mod->isAutoStart() && mod->getState() == MODULE_ENABLED) {
+            gates.push_back(DependencyGate{mod, false, false});
         }
     }
+    int total = modules.size();
+    std::atomic<int> done(0);
+    bool ok = bootGraph.run("start", modules, [&](Module* mod) {
+        if (!mod->isAutoStart() || mod->getState() != MODULE_ENABLED) return true;
+        TRACE_SCOPE_ARG("module", "start", SymbolTable::global().name(mod->getId()));
+        Serial.println("Starting: " + mod->getName());
+        int percent = (int)((++done * 100.0) / total);
+        renderLoadingStep(String("Start ")+mod->getName(), percent);
+        DependencyGate* gate = nullptr;
+        for (auto& g : gates) if (g.module == mod) gate = &g;
+        // Held until its dependencies are ready; updateModules starts it then
+        bool ready = !gate || dependenciesReady(mod);
+        bool started = ready && mod->start();
+        if (ready && !started) {
+            mod->setState(MODULE_ERROR);
+            Serial.println("Failed to start: " + mod->getName());
+            if (mod->isCritical()) return false;
+        }
+        if (gate) {
+            gate->ready = ready;
+            gate->started = started;
+            // Its task, pool slot or scheduler entry is set up below but stays idle
+            mod->setHeld(!ready);
+        }
+        // The stack profiler, core planner and worker pool are not shared-safe
+        xSemaphoreTake(bootLock, portMAX_DELAY);
+        ensureModuleQueue(mod);
+        startModuleTask(mod);
+        xSemaphoreGive(bootLock);
+        renderLoadingStep(String("Started ")+mod->getName(), percent);
+        return started || !ready;
+    });
+    Serial.println("Boot " + bootGraph.summary("start"));
+    if (!ok) return false;
     renderLoadingStep("Start completed", 100);
+    if (profiled) Serial.println("Stack profile loaded, reclaimed " + String(stackProfiler.reclaimed()) + " bytes");
     return true;
 }
 
 bool ModuleManager::stopModules() {
     Serial.println("Stopping modules...");
+    TRACE_SCOPE("boot", "stop");
     for (auto* mod : modules) {
         if (mod->getState() == MODULE_ENABLED) {
+            TRACE_SCOPE_ARG("module", "stop", SymbolTable::global().name(mod->getId()));
             Serial.println("Stopping: " + mod->getName());
             mod->stop();
         }
@@ -203,43 +453,58 @@ bool ModuleManager::stopModules() {
 }
 
 bool ModuleManager::updateModules() {
-    Module* wifiModule = getModule("CONTROL_WIFI");
-    Module* webModule = getModule("CONTROL_WEB");
-    if (wifiModule) {
-        bool connected = false;
-        CONTROL_WIFI* wf = static_cast<CONTROL_WIFI*>(wifiModule);
-        connected = wf->isWiFiConnected();
-        if (connected != wifiConnectedLast) {
-            wifiConnectedLast = connected;
-            if (webModule) {
-                CONTROL_WEB* web = static_cast<CONTROL_WEB*>(webModule);
-                if (connected) {
-                    if (!web->isRunning()) web->start();
-                    if (web->getTask()) web->getTask()->resume();
-                } else {
-                    if (web->isRunning()) web->stop();
-                    if (web->getTask()) web->getTask()->suspend();
-                }
-            }
-        }
-    }
-    for (auto* mod : modules) {
-        if (mod->getState() == MODULE_ENABLED && !mod->getUseTask()) {
-            mod->update();
+    if (!loopTask) loopTask = xTaskGetCurrentTaskHandle();
+    for (auto& g : gates) {
+        bool ready = dependenciesReady(g.module);
+        if (ready == g.ready) continue;
+        g.ready = ready;
+        TRACE_INSTANT("module", ready ? "dependencies ready" : "dependencies lost", SymbolTable::global().name(g.module->getId()));
+        if (ready) {
+            if (!g.started) g.started = g.module->start();
+            g.module->setHeld(false);
+            g.module->notifyWork();
+        } else {
+            g.module->setHeld(true);
+            if (g.started) g.module->stop();
+            g.started = false;
         }
     }
+    scheduler.sync(modules, loopTask);
+    scheduler.runDue();
+    stackProfiler.poll(modules);
     return true;
 }
 
+uint32_t ModuleManager::loopWaitMs() {
+    return scheduler.waitMs(MODULE_LOOP_MAX_MS);
+}
+
 bool ModuleManager::startModuleTask(Module* mod) {
     if (!mod->getUseTask()) return true;
+    if (mod->getUsePool()) return WorkerPool::global().attach(mod);
     if (mod->getTask()) return true;
-    TaskBase* tb = new TaskBase(mod, mod->getTaskConfig());
+    TaskConfig tc = mod->getTaskConfig();
+    tc.stackSize = stackProfiler.sizeFor(tc.name, tc.stackSize);
+    if (!tc.pinned) tc.core = corePlanner.coreFor(tc.name, tc.core);
+    TaskBase* tb = new TaskBase(mod, tc);
     auto runner = [](void* pv) {
       Module* m = static_cast<Module*>(pv);
+      m->setRunnerTask(xTaskGetCurrentTaskHandle());
       for (;;) {
-        if (m->getState() == MODULE_ENABLED) m->update();
-        vTaskDelay(pdMS_TO_TICKS(10));
+        uint32_t waitMs = MODULE_IDLE_MAX_MS;
+        if (m->isRunnable()) {
+          m->drainQueue();
+          int64_t t0 = esp_timer_get_time();
+          m->update();
+          m->recordCpu(CPU_WORK_UPDATE, (uint32_t)(esp_timer_get_time() - t0));
+          uint32_t d = m->nextDeadlineMs();
+          if (d < waitMs) waitMs = d;
+          if (m->hasWork()) waitMs = 0;
+        }
+        if (m->getTask()) m->getTask()->feedWatchdog();
+        // Sleep until a message is queued for this module or its next deadline
+        if (waitMs == 0) taskYIELD();
+        else ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
       }
     };
     bool ok = tb->start(runner);
@@ -260,18 +525,16 @@ bool ModuleManager::ensureModuleQueue(Module* mod) {
 }
 
 bool ModuleManager::loadGlobalConfig() {
-    Module* fsMod = getModule("CONTROL_FS");
-    if (!fsMod) return false;
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsMod);
+    CONTROL_FS* fs = fsHandle.get();
+    if (!fs) return false;
     DynamicJsonDocument doc(8192);
     if (!fs->loadGlobalConfig(doc)) return false;
     return applyConfig(doc);
 }
 
 bool ModuleManager::saveGlobalConfig() {
-    Module* fsMod = getModule("CONTROL_FS");
-    if (!fsMod) return false;
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsMod);
+    CONTROL_FS* fs = fsHandle.get();
+    if (!fs) return false;
     DynamicJsonDocument doc(8192);
     for (Module* mod : modules) {
         DynamicJsonDocument status = mod->getStatus();
@@ -288,28 +551,35 @@ bool ModuleManager::applyConfig(DynamicJsonDocument& doc) {
 }
 
 void ModuleManager::appendLCDLog(const String& line) {
+    xSemaphoreTake(lcdLogLock, portMAX_DELAY);
     lcdLogs.push_back(line);
     while (lcdLogs.size() > 5) lcdLogs.erase(lcdLogs.begin());
-    Module* lcdMod = getModule("CONTROL_LCD");
+    xSemaphoreGive(lcdLogLock);
+    Module* lcdMod = lcdHandle.get();
     if (!lcdMod) return;
     QueueBase* qb = lcdMod->getQueue();
     if (!qb) return;
-    DynamicJsonDocument* vars = new DynamicJsonDocument(256);
-    JsonArray arr = vars->createNestedArray("v");
+    QueueMessage* msg = qb->acquire();
+    if (!msg) return;
+    msg->fromQueue = "ModuleManager";
+    QUEUE_MESSAGE_CALL(msg, "lcd_log_append");
+    JsonArray arr = msg->callVariables->createNestedArray("v");
     arr.add(line);
-    QueueMessage* msg = new QueueMessage{genUUID4(), lcdMod->getName(), String("ModuleManager"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_log_append"), vars};
     qb->send(msg);
 }
 
 void ModuleManager::renderLoadingStep(const String& op, int percent) {
-    Module* lcdMod = getModule("CONTROL_LCD");
+    Module* lcdMod = lcdHandle.get();
     if (!lcdMod) return;
     QueueBase* qb = lcdMod->getQueue();
     if (!qb) return;
-    DynamicJsonDocument* vars = new DynamicJsonDocument(256);
-    (*vars)["op"] = op;
-    (*vars)["percent"] = percent;
-    QueueMessage* msg = new QueueMessage{genUUID4(), lcdMod->getName(), String("ModuleManager"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_boot_step"), vars};
-    qb->send(msg);
+    QueueMessage* msg = qb->acquire();
+    if (msg) {
+        msg->fromQueue = "ModuleManager";
+        QUEUE_MESSAGE_CALL(msg, "lcd_boot_step");
+        (*msg->callVariables)["op"] = op;
+        (*msg->callVariables)["percent"] = percent;
+        qb->send(msg);
+    }
     appendLCDLog(String("[") + "INFO" + "][BOOT] " + op);
 }
@@ -5,9 +5,22 @@
 #include <ArduinoJson.h>
 #include <vector>
 #include <functional>
+#include <atomic>
 #include "FreeRTOSTypes.h"
 #include "TaskBase.h"
 #include "QueueBase.h"
+#include "CoopScheduler.h"
+#include "StackProfiler.h"
+#include "CorePlanner.h"
+#include "BootGraph.h"
+#include "VarStore.h"
+
+// Wait value for modules that only need to run when a message arrives
+#define MODULE_WAIT_FOREVER 0xFFFFFFFFUL
+// Upper bound on how long a module task sleeps, so health/watchdog state stays fresh
+#define MODULE_IDLE_MAX_MS 1000
+// Upper bound for loop(), which also starts/stops modules as their dependencies come and go
+#define MODULE_LOOP_MAX_MS 100
 
 // Module states
 enum ModuleState {
@@ -17,10 +30,25 @@ enum ModuleState {
     MODULE_TESTING = 3
 };
 
+// Kinds of work whose busy time is accounted per module
+enum ModuleCpuWork {
+    CPU_WORK_UPDATE = 0,  // update(), from the module's task or loop()
+    CPU_WORK_MESSAGE,     // handleMessage() for queued messages
+    CPU_WORK_CALL,        // registry functions, on whichever task called them
+    CPU_WORK_COUNT
+};
+
+struct ModuleCpuCounter {
+    uint32_t calls;
+    uint64_t totalUs;
+    uint32_t maxUs;
+};
+
 // Module base class
 class Module {
 protected:
     String moduleName;
+    SymbolId moduleId;
     ModuleState state;
     int priority;
     bool autoStart;
@@ -34,6 +62,17 @@ protected:
     QueueConfig queueCfg;
     bool useTask;
     bool useQueue;
+    bool usePool;       // run on the shared WorkerPool instead of a task of its own
+    uint32_t periodMs;  // update() cadence unless nextDeadlineMs() is overridden
+    // Task currently running update() for this module; read from ISRs
+    volatile TaskHandle_t runnerTask;
+    // Busy time per kind of work; registry calls arrive from any task
+    ModuleCpuCounter cpuUsage[CPU_WORK_COUNT];
+    portMUX_TYPE cpuLock;
+    VarId stateVar;  // <module>.state in the registry's VarStore
+    std::vector<String> dependencies;  // boot after these, run only while they are ready
+    std::vector<String> startsAfter;   // boot after these
+    std::atomic<bool> held;            // waiting for its dependencies, see setHeld()
     
 public:
     Module(const char* name);
@@ -47,6 +86,47 @@ public:
     virtual bool test() = 0;
     virtual DynamicJsonDocument getStatus() = 0;
     virtual bool callFunctionByName(const String& name, DynamicJsonDocument* params, String& result) { return false; }
+    // Called by the runner for each queued message when queue batching is enabled;
+    // the message is recycled afterwards. Rpc requests never reach it. The default
+    // dispatches the message's call to this module's registered function.
+    virtual void handleMessage(QueueMessage* msg);
+    size_t drainQueue(TickType_t firstWait = 0);
+    // Milliseconds until update() has to run again. Queue arrivals wake the module
+    // earlier; return MODULE_WAIT_FOREVER if it is purely message driven.
+    virtual uint32_t nextDeadlineMs() { return periodMs; }
+    // Wakes whichever task runs this module (its own task, a pool worker or loop()).
+    void notifyWork();
+    // ISR-safe wake for modules fed by an input stream (e.g. an SpscRing filled
+    // from an interrupt). No-op until the runner has started.
+    void notifyWorkFromISR();
+    void setRunnerTask(TaskHandle_t h) { runnerTask = h; }
+    // True while an input stream still holds data for update(); keeps the runner
+    // from sleeping, like a pending queue message does.
+    virtual bool hasPendingInput() { return false; }
+    // A queued message or pending input: the runner must not sleep.
+    bool hasWork() { return (queueBase && queueBase->hasPending()) || hasPendingInput(); }
+    // Adds us of busy time of the given kind; update() is timed by its runner.
+    void recordCpu(ModuleCpuWork work, uint32_t us);
+    // calls / total_us / avg_us / max_us per kind, plus busy_us and busy_pct of uptime.
+    void cpuToJson(JsonObject out);
+    ModuleCpuCounter cpuCounter(ModuleCpuWork work);
+    
+    // Dependencies, declared in the constructor or under modules.<name>.depends_on /
+    // .after in the config. init() and start() run once those modules finished
+    // theirs; a dependency must also be ready for this module to be started, and
+    // the module is stopped while it is not (see ModuleManager::updateModules).
+    void dependsOn(const String& name);
+    void startAfter(const String& name);
+    const std::vector<String>& getDependencies() const { return dependencies; }
+    const std::vector<String>& getStartsAfter() const { return startsAfter; }
+    // Whether dependents may run; CONTROL_WIFI is ready once connected.
+    virtual bool isReady() { return state == MODULE_ENABLED; }
+    // Set by the manager while a dependency is not ready: its runner, the worker
+    // pool and the cooperative scheduler then leave the module alone.
+    void setHeld(bool h) { held.store(h); }
+    bool isHeld() const { return held.load(); }
+    // Enabled and not held: drainQueue() and update() may run.
+    bool isRunnable() const { return state == MODULE_ENABLED && !held.load(); }
     
     // Configuration
     virtual bool loadConfig(DynamicJsonDocument& doc);
@@ -54,6 +134,7 @@ public:
     
     // Getters
     String getName() const { return moduleName; }
+    SymbolId getId() const { return moduleId; }
     ModuleState getState() const { return state; }
     int getPriority() const { return priority; }
     bool isAutoStart() const { return autoStart; }
@@ -66,9 +147,11 @@ public:
     QueueConfig getQueueConfig() const { return queueCfg; }
     bool getUseTask() const { return useTask; }
     bool getUseQueue() const { return useQueue; }
+    bool getUsePool() const { return usePool; }
     
     // Setters
-    void setState(ModuleState s) { state = s; }
+    // Also published as the <module>.state variable
+    void setState(ModuleState s);
     void setPriority(int p) { priority = p; }
     void setAutoStart(bool a) { autoStart = a; }
     void setDebugEnabled(bool d) { debugEnabled = d; }
@@ -79,18 +162,63 @@ public:
     void setQueueConfig(const QueueConfig& c) { queueCfg = c; }
     void setUseTask(bool u) { useTask = u; }
     void setUseQueue(bool u) { useQueue = u; }
+    void setUsePool(bool p) { usePool = p; }
     
     // Logging
   void log(const String& message, const char* level = "INFO");
 };
 
+class CONTROL_FS;
+class CONTROL_LCD;
+
+// Resolve-once reference to a module by name, for call sites that would
+// otherwise run getModule() on every use. The pointer is cached together
+// with the manager's generation; registering or unregistering any module
+// bumps the generation, so the next get() resolves again and never returns
+// a module that has been removed. T must be the module's class (there is no
+// RTTI to check it). Safe to share between tasks.
+template <typename T>
+class ModuleHandle {
+public:
+    explicit ModuleHandle(const char* name) : name(name), module(nullptr), generation(0) {}
+    T* get() const;
+    T* operator->() const { return get(); }
+    explicit operator bool() const { return get() != nullptr; }
+    const char* getName() const { return name; }
+
+private:
+    ModuleHandle(const ModuleHandle&);
+    ModuleHandle& operator=(const ModuleHandle&);
+
+    const char* name;
+    mutable std::atomic<Module*> module;
+    mutable std::atomic<uint32_t> generation;  // manager generation module was resolved at; 0 while refreshing
+};
+
 // Module Manager
 class ModuleManager {
 private:
     std::vector<Module*> modules;
+    std::atomic<uint32_t> generation;  // bumped by (un)registerModule, starts at 1
+    portMUX_TYPE handleLock;           // serializes ModuleHandle refreshes
+    ModuleHandle<CONTROL_FS> fsHandle{"CONTROL_FS"};
+    ModuleHandle<CONTROL_LCD> lcdHandle{"CONTROL_LCD"};
     static ModuleManager* instance;
     std::vector<String> lcdLogs;
-    bool wifiConnectedLast;
+    SemaphoreHandle_t lcdLogLock;  // modules log from the boot workers in parallel
+    SemaphoreHandle_t bootLock;    // task/queue creation during the parallel start
+    // Modules with dependencies, started/stopped by updateModules as those come and go
+    struct DependencyGate {
+        Module* module;
+        bool ready;    // dependencies were ready at the last check
+        bool started;  // started by the manager and not stopped since
+    };
+    std::vector<DependencyGate> gates;
+    BootGraph bootGraph;
+    TaskHandle_t loopTask;
+    CoopScheduler scheduler;  // runs the modules without a task of their own on loop()
+    StackProfiler stackProfiler;
+    CorePlanner corePlanner;
     
     ModuleManager();
     
@@ -99,12 +227,27 @@ public:
     
     bool registerModule(Module* module);
     bool unregisterModule(const String& name);
+    // By name, for names that arrive at runtime (serial, web, queue senders);
+    // code that knows the module up front keeps a ModuleHandle instead.
     Module* getModule(const String& name);
+    Module* getModule(SymbolId id);
+    uint32_t getGeneration() const { return generation.load(std::memory_order_acquire); }
+    // Slow path of ModuleHandle::get(): looks name up and caches the result.
+    Module* resolveHandle(const char* name, std::atomic<Module*>& module, std::atomic<uint32_t>& cachedGeneration);
     
     bool initModules();
     bool startModules();
     bool stopModules();
     bool updateModules();
+    uint32_t loopWaitMs();
+    TaskHandle_t getLoopTask() const { return loopTask; }
+    const CoopScheduler& getScheduler() const { return scheduler; }
+    // The one resolve-once reference to CONTROL_FS, shared by the modules,
+    // the stack profiler and the core planner; nullptr until registered.
+    CONTROL_FS* getFS();
+    StackProfiler& getStackProfiler() { return stackProfiler; }
+    CorePlanner& getCorePlanner() { return corePlanner; }
+    const BootGraph& getBootGraph() const { return bootGraph; }
     bool startModuleTask(Module* mod);
     bool ensureModuleQueue(Module* mod);
     
@@ -112,11 +255,27 @@ public:
     bool saveGlobalConfig();
     bool applyConfig(DynamicJsonDocument& doc);
     
-    std::vector<Module*> getModules() { return modules; }
+    // Registered modules in priority order; do not hold across (un)registerModule.
+    const std::vector<Module*>& getModules() const { return modules; }
     
     void sortModulesByPriority();
+    // Adds modules.<name>.depends_on / .after from the FS configuration.
+    void applyDependencyConfig();
+    bool dependenciesReady(Module* mod);
     void appendLCDLog(const String& line);
     void renderLoadingStep(const String& op, int percent);
 };
 
+template <typename T>
+T* ModuleHandle<T>::get() const {
+    ModuleManager* mm = ModuleManager::getInstance();
+    uint32_t g = mm->getGeneration();
+    if (generation.load(std::memory_order_acquire) == g) {
+        Module* m = module.load(std::memory_order_acquire);
+        // Re-check: a refresh zeroes the generation before swapping the pointer
+        if (generation.load(std::memory_order_acquire) == g) return static_cast<T*>(m);
+    }
+    return static_cast<T*>(mm->resolveHandle(name, module, generation));
+}
+
 #endif
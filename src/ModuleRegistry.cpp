@@ -1,6 +1,7 @@
 #include "ModuleRegistry.h"
 #include "ModuleManager.h"
-
+#include "JsonEvalEnv.h"
+#include "esp_timer.h"
 
 ModuleRegistry* ModuleRegistry::getInstance() {
   static ModuleRegistry inst;
@@ -9,107 +10,295 @@ ModuleRegistry* ModuleRegistry::getInstance() {
 
 ModuleRegistry::ModuleRegistry() {}
 
-void ModuleRegistry::registerTask(const String& moduleName, TaskHandle_t handle) { tasks_[moduleName] = handle; }
-void ModuleRegistry::registerQueue(const String& moduleName, QueueHandle_t handle) { queues_[moduleName] = handle; }
-TaskHandle_t ModuleRegistry::findTask(const String& moduleName) { return tasks_.count(moduleName) ? tasks_[moduleName] : nullptr; }
-QueueHandle_t ModuleRegistry::findQueue(const String& moduleName) { return queues_.count(moduleName) ? queues_[moduleName] : nullptr; }
-void ModuleRegistry::setVar(const String& cls, const String& var, const JsonVarTemplate& tmpl) { vars_[cls][var] = tmpl; }
-bool ModuleRegistry::getVar(const String& cls, const String& var, JsonVarTemplate& out) {
-  auto itc = vars_.find(cls);
-  if (itc == vars_.end()) return false;
-  auto itv = itc->second.find(var);
-  if (itv == itc->second.end()) return false;
-  out = itv->second;
-  return true;
+void ModuleRegistry::registerTask(const String& moduleName, TaskHandle_t handle) {
+  Directory* d = dir_.edit();
+  d->tasks[moduleName] = handle;
+  dir_.publish(d);
+}
+void ModuleRegistry::registerQueue(const String& moduleName, QueueHandle_t handle) {
+  Directory* d = dir_.edit();
+  d->queues[moduleName] = handle;
+  dir_.publish(d);
+}
+TaskHandle_t ModuleRegistry::findTask(const String& moduleName) {
+  ReadMostly<Directory>::Reader d(dir_);
+  auto it = d->tasks.find(moduleName);
+  return it != d->tasks.end() ? it->second : nullptr;
+}
+QueueHandle_t ModuleRegistry::findQueue(const String& moduleName) {
+  ReadMostly<Directory>::Reader d(dir_);
+  auto it = d->queues.find(moduleName);
+  return it != d->queues.end() ? it->second : nullptr;
 }
 void ModuleRegistry::toJson(DynamicJsonDocument& doc) {
-  for (auto& kv : tasks_) doc["tasks"][kv.first] = (uint32_t)kv.second;
-  for (auto& kv : queues_) doc["queues"][kv.first] = (uint32_t)kv.second;
+  ReadMostly<Directory>::Reader d(dir_);
+  for (auto& kv : d->tasks) doc["tasks"][kv.first] = (uint32_t)kv.second;
+  for (auto& kv : d->queues) doc["queues"][kv.first] = (uint32_t)kv.second;
 }
 String ModuleRegistry::exportJson() { DynamicJsonDocument d(4096); toJson(d); String s; serializeJson(d, s); return s; }
 bool ModuleRegistry::importJson(const String& json) { DynamicJsonDocument d(4096); auto e = deserializeJson(d, json); return e == DeserializationError::Ok; }
 
-String ModuleRegistry::Functions::keyOf(const String& moduleName, const String& functionName) { return moduleName + String(":") + functionName; }
+ModuleRegistry::Functions::Functions() : count_(0) {
+  for (size_t i = 0; i < REGISTRY_MAX_CHUNKS; i++) chunks_[i].store(nullptr, std::memory_order_relaxed);
+}
 
-bool ModuleRegistry::Functions::has(const String& key) const { return entries_.count(key) > 0; }
-ModuleRegistry::FunctionEntry ModuleRegistry::Functions::get(const String& key) const { auto it = entries_.find(key); return it != entries_.end() ? it->second : FunctionEntry{}; }
+int16_t ModuleRegistry::Functions::Table::find(SymbolId moduleId, SymbolId functionId) const {
+  if (moduleId >= index.size() || functionId >= index[moduleId].size()) return -1;
+  return index[moduleId][functionId];
+}
+ModuleRegistry::FunctionEntry* ModuleRegistry::Functions::slot(int16_t s) const {
+  if (s < 0 || (uint16_t)s >= count_.load(std::memory_order_acquire)) return nullptr;
+  return &chunks_[s / REGISTRY_SLOT_CHUNK].load(std::memory_order_acquire)[s % REGISTRY_SLOT_CHUNK];
+}
+int16_t ModuleRegistry::Functions::lookup(SymbolId moduleId, SymbolId functionId) const {
+  ReadMostly<Table>::Reader t(table_);
+  return t->find(moduleId, functionId);
+}
+ModuleRegistry::FunctionEntry* ModuleRegistry::Functions::pin(int16_t s) const {
+  FunctionEntry* fe = slot(s);
+  if (!fe) return nullptr;
+  // Counted before checking active: a writer clears active first, then waits for calls
+  fe->calls.fetch_add(1);
+  if (fe->active.load()) return fe;
+  unpin(fe);
+  return nullptr;
+}
+void ModuleRegistry::Functions::waitForCalls(const FunctionEntry* fe) {
+  while (fe->calls.load() != 0) vTaskDelay(1);
+}
 std::vector<String> ModuleRegistry::Functions::listModuleFunctions(const String& moduleName) const {
   std::vector<String> names;
-  String prefix = moduleName + String(":");
-  for (auto& kv : entries_) {
-    if (kv.first.startsWith(prefix)) names.push_back(kv.second.functionName);
+  SymbolId mid = SymbolTable::global().find(moduleName.c_str());
+  if (mid == SYMBOL_NONE) return names;
+  uint16_t n = count_.load(std::memory_order_acquire);
+  for (uint16_t s = 0; s < n; s++) {
+    FunctionEntry* fe = pin((int16_t)s);
+    if (!fe) continue;
+    if (fe->moduleId == mid) names.push_back(fe->functionName);
+    unpin(fe);
   }
   return names;
 }
 bool ModuleRegistry::Functions::remove(const String& moduleName, const String& functionName) {
-  String k = keyOf(moduleName, functionName);
-  auto it = entries_.find(k);
-  if (it == entries_.end()) return false;
-  entries_.erase(it);
+  Table* t = table_.edit();
+  FunctionEntry* fe = slot(t->find(SymbolTable::global().find(moduleName.c_str()), SymbolTable::global().find(functionName.c_str())));
+  // Calls already running finish; the handler is kept until the slot is reused
+  bool removed = fe && fe->active.exchange(false);
+  table_.cancel(t);
+  if (!removed) return false;
   #if (MODULE_REGISTRY_NO_DEBUG!=1)
   Serial.println(String("[ModuleRegistry][UNREGISTER] ") + moduleName + ":" + functionName);
   #endif
 
   return true;
 }
+void ModuleRegistry::Functions::removeModule(SymbolId moduleId) {
+  Table* t = table_.edit();
+  uint16_t n = count_.load(std::memory_order_acquire);
+  for (uint16_t s = 0; s < n; s++) {
+    FunctionEntry* fe = slot((int16_t)s);
+    if (fe->moduleId != moduleId) continue;
+    fe->active.store(false);
+    // The module is deleted next: let calls still running in it return
+    waitForCalls(fe);
+    fe->ctx = nullptr;
+  }
+  table_.cancel(t);
+}
 bool ModuleRegistry::Functions::contains(const String& moduleName, const String& functionName) const {
-  return entries_.count(keyOf(moduleName, functionName)) > 0;
+  FunctionEntry* fe = slot(lookup(SymbolTable::global().find(moduleName.c_str()), SymbolTable::global().find(functionName.c_str())));
+  return fe && fe->active.load();
 }
 
-bool ModuleRegistry::Functions::moduleNameFunctionRegister(const String& moduleName, const String& functionName, const String& handleName, FunctionsCallType type, std::function<bool(void*, DynamicJsonDocument*, String&)> fn, const String& evalCode) {
-  FunctionEntry fe; fe.moduleName = moduleName; fe.functionName = functionName; fe.handleName = handleName; fe.callType = type; fe.func = fn; fe.evalCode = evalCode;
-  String k = keyOf(moduleName, functionName);
-  entries_[k] = fe;
+FunctionHandle ModuleRegistry::Functions::moduleNameFunctionRegister(const String& moduleName, const String& functionName, const String& handleName, FunctionsCallType type, std::function<bool(void*, DynamicJsonDocument*, String&)> fn, const String& evalCode, TypedFunction typedFn, const EvalProgram* program) {
+  SymbolId mid = SymbolTable::global().intern(moduleName.c_str());
+  SymbolId fid = SymbolTable::global().intern(functionName.c_str());
+  if (mid == SYMBOL_NONE || fid == SYMBOL_NONE) return FunctionHandle{-1};
+  // Resolved before taking the writer lock; calls resolve it themselves if the
+  // module is not known yet.
+  void* ctx = (void*)ModuleManager::getInstance()->getModule(moduleName);
+  Table* t = table_.edit();
+  int16_t s = t->find(mid, fid);
+  FunctionEntry* fe = slot(s);
+  bool added = !fe;
+  if (added) {
+    uint16_t n = count_.load(std::memory_order_relaxed);
+    if (n >= REGISTRY_SLOT_CHUNK * REGISTRY_MAX_CHUNKS) {
+      table_.cancel(t);
+      return FunctionHandle{-1};
+    }
+    FunctionEntry* chunk = chunks_[n / REGISTRY_SLOT_CHUNK].load(std::memory_order_relaxed);
+    if (!chunk) {
+      chunk = new FunctionEntry[REGISTRY_SLOT_CHUNK];
+      chunks_[n / REGISTRY_SLOT_CHUNK].store(chunk, std::memory_order_release);
+    }
+    s = (int16_t)n;
+    fe = &chunk[n % REGISTRY_SLOT_CHUNK];
+    if (t->index.size() <= mid) t->index.resize(mid + 1);
+    if (t->index[mid].size() <= fid) t->index[mid].resize(fid + 1, -1);
+    t->index[mid][fid] = s;
+  } else {
+    // Replacing a live function: wait until none of its calls is running
+    fe->active.store(false);
+    waitForCalls(fe);
+  }
+  fe->moduleName = moduleName; fe->functionName = functionName; fe->handleName = handleName; fe->callType = type; fe->func = fn; fe->evalCode = evalCode; fe->program = program ? *program : EvalProgram(); fe->typedFunc = typedFn;
+  fe->moduleId = mid; fe->functionId = fid; fe->ctx = ctx;
+  fe->active.store(true);
+  if (added) {
+    count_.store((uint16_t)(s + 1), std::memory_order_release);
+    table_.publish(t);
+  } else {
+    table_.cancel(t);
+  }
   #if (MODULE_REGISTRY_NO_DEBUG!=1)
   Serial.println(String("[ModuleRegistry][REGISTER] ") + moduleName + ":" + functionName + String(" handle ") + handleName + String(" type ") + String((int)type));
   #endif
-  return true;
+  return FunctionHandle{s};
+}
+
+FunctionHandle ModuleRegistry::Functions::handleOf(SymbolId moduleId, SymbolId functionId) const {
+  return FunctionHandle{lookup(moduleId, functionId)};
+}
+
+bool ModuleRegistry::Functions::handleCall(FunctionHandle h, DynamicJsonDocument* params, String& result) {
+  FunctionEntry* fe = pin(h.slot);
+  if (!fe) return false;
+  bool ok = invoke(*fe, params, result);
+  unpin(fe);
+  return ok;
+}
+
+bool ModuleRegistry::Functions::handleMessageCall(FunctionHandle h, QueueMessage* msg, String& result) {
+  FunctionEntry* fe = pin(h.slot);
+  if (!fe) return false;
+  bool ok = invokeMessage(*fe, msg, result);
+  unpin(fe);
+  return ok;
 }
 
 bool ModuleRegistry::Functions::moduleNameFunctionCall(const String& moduleName, const String& functionName, DynamicJsonDocument* params, String& result) {
-  String k = keyOf(moduleName, functionName);
-  #if (MODULE_REGISTRY_NO_DEBUG!=1)
-  if (!has(k)) { Serial.println(String("[ModuleRegistry][CALL][MISS] ") + moduleName + ":" + functionName); return false; }
-  #endif
-  FunctionEntry fe = get(k);
+  return moduleIdFunctionCall(SymbolTable::global().find(moduleName.c_str()), SymbolTable::global().find(functionName.c_str()), params, result);
+}
+
+bool ModuleRegistry::Functions::moduleIdFunctionCall(SymbolId moduleId, SymbolId functionId, DynamicJsonDocument* params, String& result) {
+  FunctionEntry* fe = pin(lookup(moduleId, functionId));
+  if (!fe) {
+    #if (MODULE_REGISTRY_NO_DEBUG!=1)
+    Serial.println(String("[ModuleRegistry][CALL][MISS] ") + SymbolTable::global().name(moduleId) + ":" + SymbolTable::global().name(functionId));
+    #endif
+    return false;
+  }
+  bool ok = invoke(*fe, params, result);
+  unpin(fe);
+  return ok;
+}
+
+bool ModuleRegistry::Functions::moduleIdMessageCall(SymbolId moduleId, QueueMessage* msg, String& result) {
+  FunctionEntry* fe = pin(lookup(moduleId, msg->callId));
+  if (!fe) return false;
+  bool ok = invokeMessage(*fe, msg, result);
+  unpin(fe);
+  return ok;
+}
+
+bool ModuleRegistry::Functions::invokeMessage(const FunctionEntry& fe, QueueMessage* msg, String& result) {
+  uint16_t size = 0;
+  const uint8_t* data = queueMessagePayloadData(msg, size);
+  if (fe.callType == TYPED && data) {
+    void* ctx = fe.ctx ? fe.ctx : (void*)ModuleManager::getInstance()->getModule(fe.moduleName);
+    if (!fe.typedFunc) return false;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = fe.typedFunc(ctx, data, result);
+    if (ctx) ((Module*)ctx)->recordCpu(CPU_WORK_CALL, (uint32_t)(esp_timer_get_time() - t0));
+    return ok;
+  }
+  // JSON handler fed by a typed producer: convert at the edge.
+  if (fe.callType != TYPED && data && msg->callVariables) {
+    msg->callVariables->clear();
+    TypedPayloads::global().toJson(msg, msg->callVariables->to<JsonObject>());
+  }
+  return invoke(fe, msg->callVariables, result);
+}
+
+bool ModuleRegistry::Functions::invoke(const FunctionEntry& fe, DynamicJsonDocument* params, String& result) {
   #if (MODULE_REGISTRY_NO_DEBUG!=1)
-  Serial.println(String("[ModuleRegistry][CALL] ") + moduleName + ":" + functionName + String(" type ") + String((int)fe.callType));
+  Serial.println(String("[ModuleRegistry][CALL] ") + fe.moduleName + ":" + fe.functionName + String(" type ") + String((int)fe.callType));
   #endif
-  void* ctx = nullptr;
-  Module* mod = ModuleManager::getInstance()->getModule(moduleName);
-  ctx = (void*)mod;
+  // The owning module is normally cached at registration; one registered
+  // after its functions is looked up per call instead.
+  void* ctx = fe.ctx ? fe.ctx : (void*)ModuleManager::getInstance()->getModule(fe.moduleName);
+  Module* mod = (Module*)ctx;
   bool ok = false;
+  int64_t t0 = esp_timer_get_time();
   if (fe.callType == NAME) {
-    if (mod) ok = mod->callFunctionByName(fe.handleName.length() ? fe.handleName : functionName, params, result);
+    if (mod) ok = mod->callFunctionByName(fe.handleName.length() ? fe.handleName : fe.functionName, params, result);
   } else if (fe.callType == POINTER || fe.callType == DYNAMIC) {
     if (fe.func) ok = fe.func(ctx, params, result);
+  } else if (fe.callType == TYPED) {
+    // JSON caller reaching a typed handler (serial, web): convert at the edge.
+    const TypedPayloadType* t = TypedPayloads::global().find(fe.functionId);
+    alignas(8) uint8_t payload[SHARED_PAYLOAD_MAX];
+    if (t && params && fe.typedFunc) {
+      memset(payload, 0, t->size);
+      if (t->fromJson(params->as<JsonVariantConst>(), payload)) ok = fe.typedFunc(ctx, payload, result);
+    }
   } else if (fe.callType == EVAL) {
+    // Bytecode compiled at registration; the run itself does not allocate.
+    JsonEvalEnv env(params);
+    char out[EVAL_OUTPUT_MAX];
+    EvalStatus st = fe.program.run(env, out, sizeof(out));
     #if (MODULE_REGISTRY_NO_DEBUG!=1)
-    Serial.println(String("[ModuleRegistry][EVAL][UNSUPPORTED] ") + moduleName + ":" + functionName);
+    if (st == EVAL_STEP_LIMIT) Serial.println(String("[ModuleRegistry][EVAL][STEP_LIMIT] ") + fe.moduleName + ":" + fe.functionName);
     #endif
-    ok = false;
+    ok = st == EVAL_OK;
+    result = out;
   }
+  if (mod) mod->recordCpu(CPU_WORK_CALL, (uint32_t)(esp_timer_get_time() - t0));
   #if (MODULE_REGISTRY_NO_DEBUG!=1)
   Serial.println(String("[ModuleRegistry][CALL][RESULT] ") + (ok ? String("OK") : String("FAIL")));
   #endif
   return ok;
 }
 
-bool ModuleRegistry::registerFunctionName(const String& moduleName, const String& functionName, const String& handleName) {
+FunctionHandle ModuleRegistry::registerFunctionName(const String& moduleName, const String& functionName, const String& handleName) {
   return functions_.moduleNameFunctionRegister(moduleName, functionName, handleName, NAME, nullptr, String());
 }
-bool ModuleRegistry::registerFunctionPointer(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn) {
+FunctionHandle ModuleRegistry::registerFunctionPointer(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn) {
   return functions_.moduleNameFunctionRegister(moduleName, functionName, String(), POINTER, fn, String());
 }
-bool ModuleRegistry::registerFunctionDynamic(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn) {
+FunctionHandle ModuleRegistry::registerFunctionDynamic(const String& moduleName, const String& functionName, std::function<bool(void*, DynamicJsonDocument*, String&)> fn) {
   return functions_.moduleNameFunctionRegister(moduleName, functionName, String(), DYNAMIC, fn, String());
 }
-bool ModuleRegistry::registerFunctionEval(const String& moduleName, const String& functionName, const String& code) {
-  return functions_.moduleNameFunctionRegister(moduleName, functionName, String(), EVAL, nullptr, code);
+FunctionHandle ModuleRegistry::registerFunctionEval(const String& moduleName, const String& functionName, const String& code, String* error) {
+  EvalProgram program;
+  if (!program.compile(code.c_str())) {
+    if (error) *error = program.error().c_str();
+    return FunctionHandle{-1};
+  }
+  return functions_.moduleNameFunctionRegister(moduleName, functionName, String(), EVAL, nullptr, code, nullptr, &program);
+}
+FunctionHandle ModuleRegistry::findFunction(const String& moduleName, const String& functionName) const {
+  return functions_.handleOf(SymbolTable::global().find(moduleName.c_str()), SymbolTable::global().find(functionName.c_str()));
+}
+bool ModuleRegistry::call(FunctionHandle h, DynamicJsonDocument* params, String& result) {
+  return functions_.handleCall(h, params, result);
+}
+bool ModuleRegistry::call(FunctionHandle h, QueueMessage* msg, String& result) {
+  if (!msg) return false;
+  return functions_.handleMessageCall(h, msg, result);
 }
 bool ModuleRegistry::callFunction(const String& moduleName, const String& functionName, DynamicJsonDocument* params, String& result) {
   return functions_.moduleNameFunctionCall(moduleName, functionName, params, result);
 }
+bool ModuleRegistry::callFunction(SymbolId moduleId, SymbolId functionId, DynamicJsonDocument* params, String& result) {
+  return functions_.moduleIdFunctionCall(moduleId, functionId, params, result);
+}
+bool ModuleRegistry::callFunction(SymbolId moduleId, QueueMessage* msg, String& result) {
+  if (!msg) return false;
+  queueMessageCallId(msg);
+  return functions_.moduleIdMessageCall(moduleId, msg, result);
+}
 
 std::vector<String> ModuleRegistry::getFunctionsForModule(const String& moduleName) {
   std::vector<String> out;
@@ -121,6 +310,10 @@ bool ModuleRegistry::unregisterFunction(const String& moduleName, const String&
   return functions_.remove(moduleName, functionName);
 }
 
+void ModuleRegistry::unregisterModuleFunctions(SymbolId moduleId) {
+  functions_.removeModule(moduleId);
+}
+
 bool ModuleRegistry::isFunctionRegistered(const String& moduleName, const String& functionName) {
   return functions_.contains(moduleName, functionName);
 }
\ No newline at end of file
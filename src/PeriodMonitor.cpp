@@ -0,0 +1,105 @@
+#include "PeriodMonitor.h"
+#include "esp_timer.h"
+
+PeriodicActivity::PeriodicActivity(const char* name, uint32_t periodUs, uint32_t toleranceUs)
+    : name_(name), periodUs_(periodUs), toleranceUs_(toleranceUs), lastUs_(0) {
+  reset();
+}
+
+void PeriodicActivity::reset() {
+  ticks_ = 0;
+  misses_ = 0;
+  maxIntervalUs_ = 0;
+  late_.reset();
+  early_.reset();
+}
+
+void PeriodicActivity::setPeriodUs(uint32_t periodUs) {
+  if (periodUs == periodUs_) return;
+  periodUs_ = periodUs;
+  lastUs_ = 0;  // the running interval was meant for the old period
+}
+
+void PeriodicActivity::tick() {
+  int64_t now = esp_timer_get_time();
+  int64_t last = lastUs_;
+  lastUs_ = now;
+  if (last == 0) return;
+  int64_t interval = now - last;
+  if (interval > UINT32_MAX) interval = UINT32_MAX;
+  uint32_t iv = (uint32_t)interval;
+  ticks_++;
+  if (iv > maxIntervalUs_) maxIntervalUs_ = iv;
+  if (iv >= periodUs_) {
+    uint32_t late = iv - periodUs_;
+    late_.record(late);
+    uint32_t tolerance = toleranceUs_ ? toleranceUs_ : periodUs_ / 4;
+    if (late > tolerance) misses_++;
+  } else {
+    early_.record(periodUs_ - iv);
+  }
+}
+
+void PeriodicActivity::toJson(JsonObject out) const {
+  out["name"] = name_;
+  out["period_us"] = periodUs_;
+  out["tolerance_us"] = toleranceUs_ ? toleranceUs_ : periodUs_ / 4;
+  out["ticks"] = ticks_;
+  out["misses"] = misses_;
+  out["miss_pct"] = ticks_ ? (float)misses_ * 100.0f / (float)ticks_ : 0.0f;
+  out["max_interval_us"] = maxIntervalUs_;
+  late_.toJson(out.createNestedObject("late_us"));
+  early_.toJson(out.createNestedObject("early_us"));
+}
+
+PeriodMonitor& PeriodMonitor::global() {
+  static PeriodMonitor monitor;
+  return monitor;
+}
+
+PeriodMonitor::PeriodMonitor() : count_(0) {
+  portMUX_INITIALIZE(&lock_);
+}
+
+bool PeriodMonitor::add(PeriodicActivity* activity, const char* owner) {
+  bool ok = false;
+  portENTER_CRITICAL(&lock_);
+  if (count_ < PERIOD_MONITOR_MAX_ACTIVITIES) {
+    entries_[count_].activity = activity;
+    entries_[count_].owner = owner;
+    count_++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+void PeriodMonitor::remove(PeriodicActivity* activity) {
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < count_; i++) {
+    if (entries_[i].activity != activity) continue;
+    entries_[i] = entries_[count_ - 1];
+    count_--;
+    break;
+  }
+  portEXIT_CRITICAL(&lock_);
+}
+
+void PeriodMonitor::resetAll() {
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < count_; i++) entries_[i].activity->reset();
+  portEXIT_CRITICAL(&lock_);
+}
+
+void PeriodMonitor::toJson(JsonArray out) {
+  Registered copy[PERIOD_MONITOR_MAX_ACTIVITIES];
+  portENTER_CRITICAL(&lock_);
+  size_t n = count_;
+  memcpy(copy, entries_, n * sizeof(Registered));
+  portEXIT_CRITICAL(&lock_);
+  for (size_t i = 0; i < n; i++) {
+    JsonObject o = out.createNestedObject();
+    o["module"] = copy[i].owner;
+    copy[i].activity->toJson(o);
+  }
+}
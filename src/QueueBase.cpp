@@ -1,51 +1,316 @@
 #include "QueueBase.h"
+#include "esp_timer.h"
 #include "FreeRTOSTypes.h"
 #include "ModuleManager.h"
 #include "ModuleRegistry.h"
 
-QueueBase::QueueBase(Module* owner, const QueueConfig& cfg) : owner_(owner), cfg_(cfg), queue_(nullptr) {}
+QueueBase::QueueBase(Module* owner, const QueueConfig& cfg) : owner_(owner), cfg_(cfg), queue_(nullptr), urgent_(nullptr), pool_(nullptr), mailbox_(nullptr), sendFailures_(0),
+      dropped_(0), blocked_(0), batches_(0), batchedMessages_(0), largestBatch_(0), latency_(nullptr), latencyCount_(0) {
+  for (LaneStats& l : lanes_) {
+    l.sent.store(0, std::memory_order_relaxed);
+    l.highWater.store(0, std::memory_order_relaxed);
+  }
+}
 
-QueueBase::~QueueBase() { destroy(); }
+QueueBase::~QueueBase() {
+  destroy();
+  delete[] latency_;
+}
 
 bool QueueBase::create() {
   if (queue_) return true;
   queue_ = xQueueCreate(cfg_.length, sizeof(QueueMessage*));
-  if (queue_) ModuleRegistry::getInstance()->registerQueue(owner_->getName(), queue_);
-  return queue_ != nullptr;
+  if (!queue_) return false;
+  urgent_ = cfg_.urgentLength ? xQueueCreate(cfg_.urgentLength, sizeof(QueueMessage*)) : nullptr;
+  if (cfg_.urgentLength && !urgent_) {
+    vQueueDelete(queue_);
+    queue_ = nullptr;
+    return false;
+  }
+  urgentCalls_.clear();
+  for (const String& call : cfg_.urgent) urgentCalls_.push_back(SymbolTable::global().intern(call.c_str()));
+  bool coalesce = cfg_.policy == QUEUE_POLICY_COALESCE;
+  if (!cfg_.mailbox.empty() || coalesce) {
+    mailbox_ = new Mailbox();
+    for (const String& call : cfg_.mailbox) mailbox_->addKey(SymbolTable::global().intern(call.c_str()));
+  }
+  // One slot per entry of either lane and per mailbox key, plus two in flight (being filled /
+  // being handled). Coalescing queues learn their keys at runtime, so they reserve the whole mailbox.
+  size_t slots = cfg_.length + cfg_.urgentLength + 2 + (coalesce ? MAILBOX_MAX_KEYS : (mailbox_ ? mailbox_->keyCount() : 0));
+  pool_ = new MessagePool(slots, cfg_.payloadSize ? cfg_.payloadSize : 256);
+  if (!pool_->create(owner_->getName())) {
+    delete pool_;
+    pool_ = nullptr;
+    delete mailbox_;
+    mailbox_ = nullptr;
+    if (urgent_) vQueueDelete(urgent_);
+    urgent_ = nullptr;
+    vQueueDelete(queue_);
+    queue_ = nullptr;
+    return false;
+  }
+  if (!latency_) {
+    latency_ = new CallLatency[QUEUE_LATENCY_CALLS];
+    latency_[QUEUE_LATENCY_CALLS - 1].callId = SYMBOL_NONE;
+    latency_[QUEUE_LATENCY_CALLS - 1].wait.reset();
+    latency_[QUEUE_LATENCY_CALLS - 1].handler.reset();
+  }
+  ModuleRegistry::getInstance()->registerQueue(owner_->getName(), queue_);
+  return true;
 }
 
 bool QueueBase::destroy() {
   if (!queue_) return true;
+  QueueMessage* pending = nullptr;
+  if (urgent_) {
+    while (xQueueReceive(urgent_, &pending, 0) == pdPASS) recycle(pending);
+    vQueueDelete(urgent_);
+    urgent_ = nullptr;
+  }
+  while (xQueueReceive(queue_, &pending, 0) == pdPASS) recycle(pending);
   vQueueDelete(queue_);
   queue_ = nullptr;
+  if (mailbox_) {
+    while (mailbox_->take(&pending, 1)) recycle(pending);
+    delete mailbox_;
+    mailbox_ = nullptr;
+  }
+  if (pool_) {
+    delete pool_;
+    pool_ = nullptr;
+  }
   return true;
 }
 
+QueueMessage* QueueBase::acquire() {
+  if (!pool_) return nullptr;
+  return pool_->acquire();
+}
+
+const char* queuePolicyName(QueuePolicy p) {
+  switch (p) {
+    case QUEUE_POLICY_DROP_NEWEST: return "drop_newest";
+    case QUEUE_POLICY_DROP_OLDEST: return "drop_oldest";
+    case QUEUE_POLICY_COALESCE: return "coalesce";
+    default: return "block";
+  }
+}
+
+QueuePolicy queuePolicyFromName(const String& name) {
+  if (name == "drop_newest") return QUEUE_POLICY_DROP_NEWEST;
+  if (name == "drop_oldest") return QUEUE_POLICY_DROP_OLDEST;
+  if (name == "coalesce") return QUEUE_POLICY_COALESCE;
+  return QUEUE_POLICY_BLOCK;
+}
+
 bool QueueBase::send(QueueMessage* msg) {
-  if (!queue_) return false;
+  return send(msg, cfg_.policy == QUEUE_POLICY_BLOCK ? cfg_.sendTimeoutTicks : 0);
+}
+
+bool QueueBase::send(QueueMessage* msg, TickType_t timeout) {
+  if (!msg) return false;
+  if (!queue_) {
+    recycle(msg);
+    return false;
+  }
+  if (msg->eventId == 0) msg->eventId = queueNextEventId();
+  msg->enqueuedUs = esp_timer_get_time();
+  queueMessageCallId(msg);  // latency is tracked per call
+  // Rpc requests carry their own arguments and reply, so they are never coalesced
+  if (cfg_.policy == QUEUE_POLICY_COALESCE && mailbox_ && !msg->correlationId) mailbox_->addKey(msg->callId);
+  if (mailbox_ && mailbox_->accepts(msg->callId)) {
+    recycle(mailbox_->post(msg));
+    owner_->notifyWork();
+    return true;
+  }
+  msg->lane = laneFor(msg);
+  QueueHandle_t lane = msg->lane == QUEUE_LANE_URGENT ? urgent_ : queue_;
+  if (sendToLane(lane, msg, timeout)) {
+    LaneStats& stats = lanes_[msg->lane];
+    stats.sent.fetch_add(1, std::memory_order_relaxed);
+    uint32_t depth = (uint32_t)uxQueueMessagesWaiting(lane);
+    uint32_t high = stats.highWater.load(std::memory_order_relaxed);
+    while (depth > high && !stats.highWater.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+    }
+    owner_->notifyWork();
+    return true;
+  }
+  // Ownership stays with the queue: the rejected message goes back to its pool
+  sendFailures_.fetch_add(1, std::memory_order_relaxed);
+  dropped_.fetch_add(1, std::memory_order_relaxed);
+  recycle(msg);
+  return false;
+}
+
+QueueLane QueueBase::laneFor(const QueueMessage* msg) const {
+  if (!urgent_) return QUEUE_LANE_BULK;
+  if (msg->lane == QUEUE_LANE_URGENT) return QUEUE_LANE_URGENT;
+  for (SymbolId call : urgentCalls_) {
+    if (call == msg->callId) return QUEUE_LANE_URGENT;
+  }
+  return QUEUE_LANE_BULK;
+}
+
+bool QueueBase::sendToLane(QueueHandle_t lane, QueueMessage* msg, TickType_t timeout) {
   QueueMessage* tmp = msg;
-  TickType_t to = cfg_.sendTimeoutTicks;
-  return xQueueSend(queue_, &tmp, to) == pdPASS;
+  bool sent = xQueueSend(lane, &tmp, 0) == pdPASS;
+  if (!sent && cfg_.policy == QUEUE_POLICY_DROP_OLDEST) {
+    // Another producer may refill the freed slot first; give it one more try
+    for (int attempt = 0; attempt < 2 && !sent; attempt++) {
+      QueueMessage* oldest = nullptr;
+      if (xQueueReceive(lane, &oldest, 0) == pdPASS) {
+        recycle(oldest);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+      sent = xQueueSend(lane, &tmp, 0) == pdPASS;
+    }
+  } else if (!sent && cfg_.policy == QUEUE_POLICY_BLOCK && timeout > 0) {
+    blocked_.fetch_add(1, std::memory_order_relaxed);
+    sent = xQueueSend(lane, &tmp, timeout) == pdPASS;
+  }
+  return sent;
 }
 
 bool QueueBase::receive(QueueMessage*& out) {
   if (!queue_) return false;
-  TickType_t to = cfg_.recvTimeoutTicks;
-  return xQueueReceive(queue_, &out, to) == pdPASS;
+  bool ok = (urgent_ && xQueueReceive(urgent_, &out, 0) == pdPASS) || (mailbox_ && mailbox_->take(&out, 1)) ||
+            xQueueReceive(queue_, &out, cfg_.recvTimeoutTicks) == pdPASS;
+  if (ok) recordWait(out, esp_timer_get_time());
+  return ok;
+}
+
+size_t QueueBase::receiveBatch(QueueMessage** out, size_t maxCount, uint32_t budgetUs, TickType_t firstWait) {
+  if (!queue_ || !out || maxCount == 0) return 0;
+  size_t n = 0;
+  while (urgent_ && n < maxCount && xQueueReceive(urgent_, &out[n], 0) == pdPASS) n++;
+  bool ready = n > 0 || (mailbox_ && mailbox_->pending() > 0);
+  if (n < maxCount && xQueueReceive(queue_, &out[n], ready ? 0 : firstWait) == pdPASS) {
+    n++;
+    int64_t deadline = budgetUs ? esp_timer_get_time() + budgetUs : 0;
+    while (n < maxCount) {
+      if (deadline && esp_timer_get_time() >= deadline) break;
+      if (xQueueReceive(queue_, &out[n], 0) != pdPASS) break;
+      n++;
+    }
+  }
+  // Latest mailbox values go after the ordered messages of this batch.
+  if (mailbox_ && n < maxCount) n += mailbox_->take(out + n, maxCount - n);
+  if (n == 0) return 0;
+  int64_t now = esp_timer_get_time();
+  for (size_t i = 0; i < n; i++) recordWait(out[i], now);
+  batches_++;
+  batchedMessages_ += n;
+  if (n > largestBatch_) largestBatch_ = n;
+  return n;
+}
+
+bool QueueBase::hasPending() const {
+  if (urgent_ && uxQueueMessagesWaiting(urgent_) > 0) return true;
+  if (queue_ && uxQueueMessagesWaiting(queue_) > 0) return true;
+  return mailbox_ && mailbox_->pending() > 0;
+}
+
+void QueueBase::recycle(QueueMessage* msg) {
+  if (!msg) return;
+  if (msg->pool) {
+    msg->pool->release(msg);
+    return;
+  }
+  if (msg->shared) sharedPayloadRelease(msg->shared);
+  if (msg->callVariables) delete msg->callVariables;
+  delete msg;
+}
+
+QueueBase::CallLatency* QueueBase::latencyFor(SymbolId callId) {
+  // Only this (consumer) task writes the count
+  size_t count = latencyCount_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < count; i++) {
+    if (latency_[i].callId == callId) return &latency_[i];
+  }
+  if (count >= QUEUE_LATENCY_CALLS - 1) return &latency_[QUEUE_LATENCY_CALLS - 1];
+  CallLatency& e = latency_[count];
+  e.callId = callId;
+  e.wait.reset();
+  e.handler.reset();
+  // Readers see the entry's callId and reset histograms before they see it counted
+  latencyCount_.store(count + 1, std::memory_order_release);
+  return &e;
+}
+
+void QueueBase::recordWait(const QueueMessage* msg, int64_t nowUs) {
+  if (!msg->enqueuedUs) return;
+  int64_t waited = nowUs - msg->enqueuedUs;
+  latencyFor(msg->callId)->wait.record(waited > 0 ? (uint32_t)waited : 0);
+}
+
+void QueueBase::recordHandled(const QueueMessage* msg, uint32_t handlerUs) {
+  if (msg) latencyFor(msg->callId)->handler.record(handlerUs);
+}
+
+void QueueBase::latencyToJson(JsonArray out) const {
+  if (!latency_) return;
+  size_t count = latencyCount_.load(std::memory_order_acquire);
+  for (size_t i = 0; i <= count && i < QUEUE_LATENCY_CALLS; i++) {
+    // The overflow entry sits in the last slot, reached once the table is full
+    size_t idx = i < count ? i : QUEUE_LATENCY_CALLS - 1;
+    const CallLatency& e = latency_[idx];
+    if (i == count && e.wait.count == 0 && e.handler.count == 0) break;
+    JsonObject o = out.createNestedObject();
+    o["call"] = e.callId != SYMBOL_NONE ? SymbolTable::global().name(e.callId) : "(other)";
+    e.wait.toJson(o.createNestedObject("wait_us"));
+    e.handler.toJson(o.createNestedObject("handler_us"));
+  }
 }
 
 String QueueBase::id() const { return owner_->getName(); }
 
+void QueueBase::toJson(JsonObject out) const {
+  out["length"] = cfg_.length;
+  out["waiting"] = queue_ ? (uint32_t)uxQueueMessagesWaiting(queue_) : 0;
+  out["policy"] = queuePolicyName(cfg_.policy);
+  out["send_failures"] = sendFailures_.load(std::memory_order_relaxed);
+  out["dropped"] = dropped_.load(std::memory_order_relaxed);
+  out["blocked"] = blocked_.load(std::memory_order_relaxed);
+  out["batch_size"] = cfg_.batchSize;
+  out["batch_budget_us"] = cfg_.batchBudgetUs;
+  out["batches"] = batches_;
+  out["batched_messages"] = batchedMessages_;
+  out["largest_batch"] = largestBatch_;
+  JsonObject lanes = out.createNestedObject("lanes");
+  for (uint8_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+    QueueHandle_t q = i == QUEUE_LANE_URGENT ? urgent_ : queue_;
+    JsonObject l = lanes.createNestedObject(i == QUEUE_LANE_URGENT ? "urgent" : "bulk");
+    l["length"] = i == QUEUE_LANE_URGENT ? cfg_.urgentLength : cfg_.length;
+    l["waiting"] = q ? (uint32_t)uxQueueMessagesWaiting(q) : 0;
+    l["high_water"] = lanes_[i].highWater.load(std::memory_order_relaxed);
+    l["sent"] = lanes_[i].sent.load(std::memory_order_relaxed);
+  }
+  if (pool_) pool_->toJson(out.createNestedObject("pool"));
+  if (mailbox_) mailbox_->toJson(out.createNestedObject("mailbox"));
+  latencyToJson(out.createNestedArray("latency"));
+}
+
 void QueueBase::RECEIVE_RETURN_CALL_FUNC(QueueMessage* incoming) {
   if (!incoming) return;
-  String toId = incoming->fromQueue;
-  QueueHandle_t toH = ModuleRegistry::getInstance()->findQueue(toId);
-  if (!toH) return;
-  //DynamicJsonDocument* vars = new DynamicJsonDocument(512);
-  //JsonArray arr = vars->createNestedArray("v");
-  //arr.add("RESULT");
-  //arr.add((*incoming->callVariables)["v"]);
-  QueueMessage* resp = new QueueMessage{incoming->eventUUID, toId, id(), EVENT_PROCESS_DONE, CALL_RECEIVE_RETURN, String(incoming->callName), incoming->callVariables};
-  QueueMessage* tmp = resp;
-  xQueueSend(toH, &tmp, cfg_.sendTimeoutTicks);
-}
\ No newline at end of file
+  Module* target = ModuleManager::getInstance()->getModule(incoming->fromQueue);
+  QueueBase* tq = target ? target->getQueue() : nullptr;
+  if (!tq) return;
+  QueueMessage* resp = tq->acquire();
+  if (!resp) return;
+  resp->eventId = incoming->eventId;
+  resp->fromQueue = id();
+  resp->eventType = EVENT_PROCESS_DONE;
+  resp->callType = CALL_RECEIVE_RETURN;
+  resp->callName = incoming->callName;
+  resp->callId = incoming->callId;
+  resp->correlationId = incoming->correlationId;
+  resp->lane = incoming->lane;
+  resp->payloadSize = incoming->payloadSize;
+  memcpy(resp->payload, incoming->payload, incoming->payloadSize);
+  if (incoming->shared) {
+    incoming->shared->refs.fetch_add(1);
+    resp->shared = incoming->shared;
+  }
+  if (incoming->callVariables) resp->callVariables->set(*incoming->callVariables);
+  tq->send(resp);
+}
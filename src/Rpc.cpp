@@ -0,0 +1,228 @@
+#include "Rpc.h"
+#include "ModuleManager.h"
+#include "ModuleRegistry.h"
+#include "WorkerPool.h"
+#include "esp_timer.h"
+
+const char* rpcStatusName(RpcStatus s) {
+  switch (s) {
+    case RPC_PENDING: return "pending";
+    case RPC_OK: return "ok";
+    case RPC_FAILED: return "failed";
+    case RPC_TIMEOUT: return "timeout";
+    case RPC_CANCELLED: return "cancelled";
+    case RPC_FREE: return "free";
+    default: return "unknown";
+  }
+}
+
+Rpc::Rpc()
+    : nextSeq_(1), calls_(0), ok_(0), failed_(0), timeouts_(0), cancelled_(0), late_(0), rejected_(0), inline_(0), pooled_(0) {
+  lock_ = xSemaphoreCreateMutex();
+  for (size_t i = 0; i < RPC_MAX_PENDING; i++) {
+    slots_[i].id = 0;
+    slots_[i].status = RPC_FREE;
+    slots_[i].caller = nullptr;
+    slots_[i].deadlineUs = 0;
+  }
+}
+
+Rpc::Slot* Rpc::slotFor(uint64_t id) {
+  if (id == 0) return nullptr;
+  Slot& s = slots_[id & (RPC_MAX_PENDING - 1)];
+  return (s.id == id && s.status != RPC_FREE) ? &s : nullptr;
+}
+
+void Rpc::freeSlot(Slot& s) {
+  s.id = 0;
+  s.status = RPC_FREE;
+  s.caller = nullptr;
+  s.result = String();
+}
+
+RpcHandle Rpc::call(const String& target, const String& fn, DynamicJsonDocument* args, uint32_t timeoutMs, Module* caller) {
+  expire();
+  Module* mod = ModuleManager::getInstance()->getModule(target);
+  RpcHandle h = {0};
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  if (mod) {
+    for (size_t i = 0; i < RPC_MAX_PENDING; i++) {
+      if (slots_[i].status != RPC_FREE) continue;
+      h.id = (nextSeq_++ << RPC_SLOT_BITS) | i;
+      slots_[i].id = h.id;
+      slots_[i].status = RPC_PENDING;
+      slots_[i].caller = caller;
+      slots_[i].deadlineUs = esp_timer_get_time() + (int64_t)timeoutMs * 1000;
+      calls_++;
+      break;
+    }
+  }
+  if (!h.valid()) rejected_++;
+  xSemaphoreGive(lock_);
+  if (!h.valid()) return h;
+
+  QueueBase* q = mod->getState() == MODULE_ENABLED ? mod->getQueue() : nullptr;
+  if (!q) {
+    // No queue for the runner to drain: run it as a pool job, so the
+    // caller does not wait for the function
+    PoolCall* job = new PoolCall{this, h.id, target, fn, args ? new DynamicJsonDocument(*args) : nullptr};
+    if (WorkerPool::global().submit(poolCall, job, mod->getTaskConfig().core)) {
+      xSemaphoreTake(lock_, portMAX_DELAY);
+      pooled_++;
+      xSemaphoreGive(lock_);
+      return h;
+    }
+    delete job->args;
+    delete job;
+    // Pool full or unavailable: run on the calling task
+    String result;
+    bool ok = ModuleRegistry::getInstance()->callFunction(target, fn, args, result);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    inline_++;
+    xSemaphoreGive(lock_);
+    complete(h.id, ok, result);
+    return h;
+  }
+  QueueMessage* msg = q->acquire();
+  if (msg) {
+    msg->fromQueue = caller ? caller->getName() : String();
+    msg->callName = fn;
+    msg->callId = SymbolTable::global().intern(fn.c_str());
+    msg->correlationId = h.id;
+    msg->lane = QUEUE_LANE_URGENT;  // interactive control calls overtake bulk traffic
+    if (args) msg->callVariables->set(*args);
+  }
+  // Never wait for space: callers are web/serial tasks that must not block
+  if (!msg || !q->send(msg, 0)) {
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    Slot* s = slotFor(h.id);
+    if (s) freeSlot(*s);
+    calls_--;
+    rejected_++;
+    xSemaphoreGive(lock_);
+    h.id = 0;
+  }
+  return h;
+}
+
+void Rpc::serve(Module* target, QueueMessage* msg) {
+  uint64_t id = msg->correlationId;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  Slot* s = slotFor(id);
+  bool live = s && s->status == RPC_PENDING;
+  if (!live) late_++;
+  xSemaphoreGive(lock_);
+  // Cancelled or timed out before it reached the front of the queue
+  if (!live) return;
+  String result;
+  bool ok = ModuleRegistry::getInstance()->callFunction(target->getId(), msg, result);
+  complete(id, ok, result);
+}
+
+void Rpc::poolCall(void* arg) {
+  PoolCall* job = static_cast<PoolCall*>(arg);
+  Rpc* rpc = job->rpc;
+  xSemaphoreTake(rpc->lock_, portMAX_DELAY);
+  Slot* s = rpc->slotFor(job->id);
+  bool live = s && s->status == RPC_PENDING;
+  if (!live) rpc->late_++;
+  xSemaphoreGive(rpc->lock_);
+  // Looked up by name: the target may have been unregistered since call()
+  if (live) {
+    String result;
+    bool ok = ModuleRegistry::getInstance()->callFunction(job->target, job->fn, job->args, result);
+    rpc->complete(job->id, ok, result);
+  }
+  delete job->args;
+  delete job;
+}
+
+void Rpc::complete(uint64_t id, bool ok, const String& result) {
+  Module* wake = nullptr;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  Slot* s = slotFor(id);
+  if (s && s->status == RPC_PENDING) {
+    s->status = ok ? RPC_OK : RPC_FAILED;
+    s->result = result;
+    wake = s->caller;
+    if (ok) ok_++;
+    else failed_++;
+  } else {
+    late_++;
+  }
+  xSemaphoreGive(lock_);
+  if (wake) wake->notifyWork();
+}
+
+RpcStatus Rpc::poll(RpcHandle h, String* result) {
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  Slot* s = slotFor(h.id);
+  RpcStatus st = RPC_UNKNOWN;
+  if (s) {
+    if (s->status == RPC_PENDING && esp_timer_get_time() >= s->deadlineUs) {
+      s->status = RPC_TIMEOUT;
+      timeouts_++;
+    }
+    st = s->status;
+    if (st != RPC_PENDING) {
+      if (result) *result = s->result;
+      freeSlot(*s);
+    }
+  }
+  xSemaphoreGive(lock_);
+  return st;
+}
+
+bool Rpc::cancel(RpcHandle h) {
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  Slot* s = slotFor(h.id);
+  if (s) {
+    if (s->status == RPC_PENDING) cancelled_++;
+    freeSlot(*s);
+  }
+  xSemaphoreGive(lock_);
+  return s != nullptr;
+}
+
+size_t Rpc::expire() {
+  int64_t now = esp_timer_get_time();
+  size_t freed = 0;
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  for (size_t i = 0; i < RPC_MAX_PENDING; i++) {
+    Slot& s = slots_[i];
+    if (s.status == RPC_FREE) continue;
+    if (s.status == RPC_PENDING && now >= s.deadlineUs) {
+      s.status = RPC_TIMEOUT;
+      timeouts_++;
+    }
+    if (s.status != RPC_PENDING && now >= s.deadlineUs + (int64_t)RPC_RESULT_HOLD_MS * 1000) {
+      freeSlot(s);
+      freed++;
+    }
+  }
+  xSemaphoreGive(lock_);
+  return freed;
+}
+
+void Rpc::toJson(JsonObject out) {
+  expire();
+  xSemaphoreTake(lock_, portMAX_DELAY);
+  size_t pending = 0, held = 0;
+  for (size_t i = 0; i < RPC_MAX_PENDING; i++) {
+    if (slots_[i].status == RPC_PENDING) pending++;
+    else if (slots_[i].status != RPC_FREE) held++;
+  }
+  out["slots"] = RPC_MAX_PENDING;
+  out["pending"] = pending;
+  out["unpolled"] = held;
+  out["calls"] = calls_;
+  out["ok"] = ok_;
+  out["failed"] = failed_;
+  out["timeouts"] = timeouts_;
+  out["cancelled"] = cancelled_;
+  out["late"] = late_;
+  out["rejected"] = rejected_;
+  out["inline"] = inline_;
+  out["pooled"] = pooled_;
+  xSemaphoreGive(lock_);
+}
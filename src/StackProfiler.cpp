@@ -0,0 +1,125 @@
+#include "StackProfiler.h"
+#include "ModuleManager.h"
+#include "TaskBase.h"
+#include "modules/CONTROL_FS.h"
+
+StackProfiler::StackProfiler()
+    : record_(false), apply_(true), marginPct_(25), marginBytes_(512), floor_(2048), warnPct_(90),
+      saveIntervalMs_(60000), lastPollMs_(0), lastSaveMs_(0), dirty_(false) {}
+
+void StackProfiler::configure(JsonVariantConst cfg) {
+  if (cfg.containsKey("record")) record_ = cfg["record"];
+  if (cfg.containsKey("apply")) apply_ = cfg["apply"];
+  if (cfg.containsKey("margin_pct")) marginPct_ = cfg["margin_pct"];
+  if (cfg.containsKey("margin_bytes")) marginBytes_ = cfg["margin_bytes"];
+  if (cfg.containsKey("floor")) floor_ = cfg["floor"];
+  if (cfg.containsKey("warn_pct")) warnPct_ = cfg["warn_pct"];
+  if (cfg.containsKey("save_interval_s")) saveIntervalMs_ = (uint32_t)cfg["save_interval_s"] * 1000;
+}
+
+StackProfiler::Entry& StackProfiler::entry(const String& task) {
+  for (Entry& e : entries_) {
+    if (e.task == task) return e;
+  }
+  Entry e;
+  e.task = task;
+  e.configured = 0;
+  e.sized = 0;
+  e.profilePeak = 0;
+  e.peak = 0;
+  e.floored = false;
+  e.warned = false;
+  entries_.push_back(e);
+  return entries_.back();
+}
+
+bool StackProfiler::load() {
+  CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+  if (!fs || !fs->fileExists(STACK_PROFILE_PATH)) return false;
+  DynamicJsonDocument doc(2048);
+  if (deserializeJson(doc, fs->readFile(STACK_PROFILE_PATH))) return false;
+  for (JsonPair kv : doc["tasks"].as<JsonObject>()) entry(kv.key().c_str()).profilePeak = kv.value()["peak"] | 0;
+  return true;
+}
+
+uint32_t StackProfiler::sizeFor(const String& taskName, uint32_t configured) {
+  Entry& e = entry(taskName);
+  e.configured = configured;
+  e.sized = configured;
+  if (!apply_ || e.profilePeak == 0) return configured;
+  uint32_t margin = e.profilePeak * marginPct_ / 100;
+  if (margin < marginBytes_) margin = marginBytes_;
+  uint32_t total = e.profilePeak + margin;
+  uint32_t size = total > TASK_STACK_OVERHEAD ? total - TASK_STACK_OVERHEAD : 0;
+  size = (size + 255) & ~255u;
+  e.floored = size < floor_;
+  if (e.floored) size = floor_;
+  e.sized = size;
+  return size;
+}
+
+void StackProfiler::poll(const std::vector<Module*>& modules) {
+  uint32_t now = millis();
+  if (now - lastPollMs_ < STACK_PROFILE_POLL_MS) return;
+  lastPollMs_ = now;
+  for (Module* mod : modules) {
+    TaskBase* task = mod->getTask();
+    if (!task || !task->handle()) continue;
+    uint32_t allocated = task->getStackSize() + TASK_STACK_OVERHEAD;
+    uint32_t used = task->getStackUsed();
+    Entry& e = entry(task->config().name);
+    if (used > e.peak) {
+      e.peak = used;
+      if (used > e.profilePeak) dirty_ = true;
+    }
+    if (!e.warned && used * 100 >= allocated * warnPct_) {
+      e.warned = true;
+      mod->log(String("Stack use ") + used + "/" + allocated + " bytes (" + e.task + ")", "WARN");
+    }
+  }
+  if (record_ && dirty_ && now - lastSaveMs_ >= saveIntervalMs_) save();
+}
+
+bool StackProfiler::save() {
+  CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+  if (!fs) return false;
+  DynamicJsonDocument doc(2048);
+  JsonObject tasks = doc.createNestedObject("tasks");
+  for (const Entry& e : entries_) {
+    uint32_t peak = e.peak > e.profilePeak ? e.peak : e.profilePeak;
+    if (!peak) continue;
+    JsonObject t = tasks.createNestedObject(e.task);
+    t["peak"] = peak;
+    t["allocated"] = e.sized + TASK_STACK_OVERHEAD;
+  }
+  String out;
+  serializeJson(doc, out);
+  lastSaveMs_ = millis();
+  if (!fs->writeFile(STACK_PROFILE_PATH, out)) return false;
+  dirty_ = false;
+  return true;
+}
+
+int32_t StackProfiler::reclaimed() const {
+  int32_t total = 0;
+  for (const Entry& e : entries_) total += (int32_t)e.configured - (int32_t)e.sized;
+  return total;
+}
+
+void StackProfiler::toJson(JsonObject out) const {
+  out["record"] = record_;
+  out["apply"] = apply_;
+  out["reclaimed_bytes"] = reclaimed();
+  JsonArray tasks = out.createNestedArray("tasks");
+  for (const Entry& e : entries_) {
+    JsonObject t = tasks.createNestedObject();
+    t["task"] = e.task;
+    t["configured"] = e.configured;
+    t["sized"] = e.sized;
+    t["profile_peak"] = e.profilePeak;
+    t["peak"] = e.peak;
+    if (e.sized) t["peak_pct"] = 100.0f * e.peak / (e.sized + TASK_STACK_OVERHEAD);
+    if (e.floored) t["floored"] = true;
+    if (e.warned) t["warned"] = true;
+  }
+}
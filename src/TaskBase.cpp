@@ -38,7 +38,7 @@ bool TaskBase::start(TaskFunction_t fn) {
         ok = xTaskCreatePinnedToCore(
             taskFunctionWrapper, 
             cfg_.name.c_str(), 
-            cfg_.stackSize + 1024, // Add extra stack for wrapper overhead
+            cfg_.stackSize + TASK_STACK_OVERHEAD,
             wrapper, 
             cfg_.priority, 
             &handle_, 
@@ -48,7 +48,7 @@ bool TaskBase::start(TaskFunction_t fn) {
         ok = xTaskCreate(
             taskFunctionWrapper, 
             cfg_.name.c_str(), 
-            cfg_.stackSize + 1024, // Add extra stack for wrapper overhead
+            cfg_.stackSize + TASK_STACK_OVERHEAD,
             wrapper, 
             cfg_.priority, 
             &handle_
@@ -179,14 +179,13 @@ uint32_t TaskBase::getStackHighWaterMark() const {
 }
 
 uint32_t TaskBase::getStackUsed() const {
-    uint32_t highWaterMark = getStackHighWaterMark();
-    return cfg_.stackSize - highWaterMark;
+    if (!handle_) return 0;
+    return cfg_.stackSize + TASK_STACK_OVERHEAD - getStackHighWaterMark();
 }
 
 float TaskBase::getStackUsagePercent() const {
-    if (cfg_.stackSize == 0) return 0.0f;
     uint32_t used = getStackUsed();
-    return (float)used / (float)cfg_.stackSize * 100.0f;
+    return (float)used / (float)(cfg_.stackSize + TASK_STACK_OVERHEAD) * 100.0f;
 }
 
 // Task wrapper function
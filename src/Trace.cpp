@@ -0,0 +1,130 @@
+#include "Trace.h"
+
+#ifdef SYSTEM_TRACE
+
+#include "esp_timer.h"
+
+static const uint8_t TRACE_OTHER_TASK = TRACE_MAX_TASKS;  // tid once the task table is full
+
+Trace& Trace::global() {
+  static Trace trace;
+  return trace;
+}
+
+Trace::Trace() : head_(0), taskCount_(0) {
+  portMUX_INITIALIZE(&lock_);
+  for (size_t i = 0; i < TRACE_CAPACITY; i++) events_[i].seq.store(0, std::memory_order_relaxed);
+}
+
+size_t Trace::slotOf(uint32_t index) {
+  if (index < TRACE_BOOT_EVENTS) return index;
+  return TRACE_BOOT_EVENTS + (index - TRACE_BOOT_EVENTS) % (TRACE_CAPACITY - TRACE_BOOT_EVENTS);
+}
+
+uint8_t Trace::taskId() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  uint8_t count = taskCount_.load(std::memory_order_acquire);
+  for (uint8_t i = 0; i < count; i++) {
+    if (tasks_[i].handle == self) return i;
+  }
+  // First event from this task: copy its name now, the task may be gone by export
+  const char* name = pcTaskGetTaskName(nullptr);
+  uint8_t id = TRACE_OTHER_TASK;
+  portENTER_CRITICAL(&lock_);
+  count = taskCount_.load(std::memory_order_relaxed);
+  for (uint8_t i = 0; i < count && id == TRACE_OTHER_TASK; i++) {
+    if (tasks_[i].handle == self) id = i;
+  }
+  if (id == TRACE_OTHER_TASK && count < TRACE_MAX_TASKS) {
+    tasks_[count].handle = self;
+    strncpy(tasks_[count].name, name ? name : "?", sizeof(tasks_[count].name) - 1);
+    tasks_[count].name[sizeof(tasks_[count].name) - 1] = '\0';
+    taskCount_.store(count + 1, std::memory_order_release);
+    id = count;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return id;
+}
+
+void Trace::record(char ph, const char* cat, const char* name, const char* arg) {
+  int64_t now = esp_timer_get_time();
+  uint8_t tid = taskId();
+  uint32_t index = head_.fetch_add(1, std::memory_order_relaxed);
+  Event& e = events_[slotOf(index)];
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.ph = (uint8_t)ph;
+  e.tid = tid;
+  e.core = (uint8_t)xPortGetCoreID();
+  e.tsUs = now;
+  e.cat = cat;
+  e.name = name;
+  e.arg = arg;
+  e.seq.store(index + 1, std::memory_order_release);
+}
+
+uint32_t Trace::dropped() const {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  return head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+}
+
+void Trace::clear() {
+  head_.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < TRACE_CAPACITY; i++) events_[i].seq.store(0, std::memory_order_release);
+}
+
+static void writeJsonString(Print& out, const char* s) {
+  out.print('"');
+  for (; s && *s; s++) {
+    if (*s == '"' || *s == '\\') out.print('\\');
+    if ((uint8_t)*s >= 0x20) out.print(*s);
+  }
+  out.print('"');
+}
+
+void Trace::writeChromeJson(Print& out) {
+  uint32_t head = head_.load(std::memory_order_acquire);
+  uint32_t ringFirst = TRACE_BOOT_EVENTS;
+  if (head > TRACE_CAPACITY) ringFirst = head - (TRACE_CAPACITY - TRACE_BOOT_EVENTS);
+
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  out.print("{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"ESP32\"}}");
+  uint8_t tasks = taskCount_.load(std::memory_order_acquire);
+  uint8_t names = tasks < TRACE_MAX_TASKS ? tasks : TRACE_OTHER_TASK + 1;
+  for (uint8_t i = 0; i < names; i++) {
+    out.printf(",{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", (unsigned)i);
+    writeJsonString(out, i < tasks ? tasks_[i].name : "other");
+    out.print("}}");
+  }
+
+  for (uint32_t index = 0; index < head; index++) {
+    if (index == TRACE_BOOT_EVENTS && ringFirst > index) index = ringFirst;
+    const Event& e = events_[slotOf(index)];
+    if (e.seq.load(std::memory_order_acquire) != index + 1) continue;
+    char ph = (char)e.ph;
+    uint8_t tid = e.tid;
+    uint8_t core = e.core;
+    int64_t ts = e.tsUs;
+    const char* cat = e.cat;
+    const char* name = e.name;
+    const char* arg = e.arg;
+    // Overwritten by the ring while copying
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != index + 1) continue;
+
+    out.printf(",{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"cat\":", ph, (unsigned)tid, (long long)ts);
+    writeJsonString(out, cat);
+    out.print(",\"name\":");
+    writeJsonString(out, name);
+    if (ph == 'i') out.print(",\"s\":\"t\"");
+    out.printf(",\"args\":{\"core\":%u", (unsigned)core);
+    if (arg) {
+      out.print(",\"arg\":");
+      writeJsonString(out, arg);
+    }
+    out.print("}}");
+  }
+  out.printf("],\"otherData\":{\"recorded\":%u,\"dropped\":%u}}", (unsigned)head, (unsigned)dropped());
+}
+
+#endif
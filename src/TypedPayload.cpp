@@ -0,0 +1,49 @@
+#include "TypedPayload.h"
+
+TypedPayloads::TypedPayloads() : count_(0) { portMUX_INITIALIZE(&lock_); }
+
+bool TypedPayloads::add(const TypedPayloadType& t) {
+  if (t.callId == SYMBOL_NONE) return false;
+  bool ok = true;
+  portENTER_CRITICAL(&lock_);
+  size_t i = 0;
+  for (; i < count_; i++) {
+    if (types_[i].callId == t.callId) break;
+  }
+  if (i < count_) {
+    ok = types_[i].size == t.size;  // one layout per call
+  } else if (count_ < TYPED_PAYLOAD_MAX_TYPES) {
+    types_[count_] = t;
+    count_++;
+  } else {
+    ok = false;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+const TypedPayloadType* TypedPayloads::find(SymbolId callId) const {
+  for (size_t i = 0; i < count_; i++) {
+    if (types_[i].callId == callId) return &types_[i];
+  }
+  return nullptr;
+}
+
+bool TypedPayloads::toJson(const QueueMessage* msg, JsonObject out) const {
+  uint16_t size = 0;
+  const uint8_t* data = queueMessagePayloadData(msg, size);
+  if (!data) return false;
+  const TypedPayloadType* t = find(msg->callId);
+  if (!t || t->size != size) return false;
+  t->toJson(data, out);
+  return true;
+}
+
+bool TypedPayloads::fromJson(JsonVariantConst in, QueueMessage* msg) const {
+  const TypedPayloadType* t = find(msg->callId);
+  if (!t || t->size > QUEUE_PAYLOAD_INLINE) return false;
+  memset(msg->payload, 0, t->size);
+  if (!t->fromJson(in, msg->payload)) return false;
+  msg->payloadSize = t->size;
+  return true;
+}
@@ -0,0 +1,179 @@
+#include "VarStore.h"
+
+const char* varTypeName(VarType t) {
+  switch (t) {
+    case VAR_INT: return "int";
+    case VAR_FLOAT: return "float";
+    case VAR_BOOL: return "bool";
+    case VAR_STRING: return "string";
+    default: return "none";
+  }
+}
+
+VarStore::VarStore() : count_(0), watcherCount_(0) {
+  portMUX_INITIALIZE(&lock_);
+}
+
+VarId VarStore::define(const String& owner, const String& name, VarType type) {
+  SymbolId oid = SymbolTable::global().intern(owner.c_str());
+  SymbolId nid = SymbolTable::global().intern(name.c_str());
+  if (oid == SYMBOL_NONE || nid == SYMBOL_NONE || type == VAR_NONE) return -1;
+  VarId id = -1;
+  portENTER_CRITICAL(&lock_);
+  uint16_t n = count_.load(std::memory_order_relaxed);
+  for (uint16_t i = 0; i < n; i++) {
+    if (slots_[i].owner == oid && slots_[i].name == nid) {
+      id = slots_[i].type == type ? (VarId)i : -1;
+      portEXIT_CRITICAL(&lock_);
+      return id;
+    }
+  }
+  if (n < VAR_STORE_MAX_VARS) {
+    slots_[n].owner = oid;
+    slots_[n].name = nid;
+    slots_[n].type = type;
+    count_.store(n + 1, std::memory_order_release);
+    id = (VarId)n;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return id;
+}
+
+VarId VarStore::find(const String& owner, const String& name) const {
+  SymbolId oid = SymbolTable::global().find(owner.c_str());
+  SymbolId nid = SymbolTable::global().find(name.c_str());
+  if (oid == SYMBOL_NONE || nid == SYMBOL_NONE) return -1;
+  uint16_t n = count_.load(std::memory_order_acquire);
+  for (uint16_t i = 0; i < n; i++) {
+    if (slots_[i].owner == oid && slots_[i].name == nid) return (VarId)i;
+  }
+  return -1;
+}
+
+bool VarStore::set(VarId id, const VarValue& v) {
+  if (id < 0 || (uint16_t)id >= count_.load(std::memory_order_acquire)) return false;
+  Slot& s = slots_[id];
+  if (s.type != v.type) return false;
+  VarValue cur;
+  Watcher hits[VAR_STORE_MAX_WATCHERS];
+  size_t hitCount = 0;
+  portENTER_CRITICAL(&lock_);
+  s.value.read(cur);
+  if (memcmp(&cur, &v, sizeof(VarValue)) != 0) {
+    s.value.write(v);
+    for (size_t i = 0; i < watcherCount_; i++) {
+      if (watchers_[i].id == id) hits[hitCount++] = watchers_[i];
+    }
+  }
+  portEXIT_CRITICAL(&lock_);
+  for (size_t i = 0; i < hitCount; i++) hits[i].cb(id, v, hits[i].ctx);
+  return true;
+}
+
+bool VarStore::setInt(VarId id, int32_t v) {
+  VarValue val;
+  memset(&val, 0, sizeof(val));
+  val.type = VAR_INT;
+  val.i = v;
+  return set(id, val);
+}
+
+bool VarStore::setFloat(VarId id, float v) {
+  VarValue val;
+  memset(&val, 0, sizeof(val));
+  val.type = VAR_FLOAT;
+  val.f = v;
+  return set(id, val);
+}
+
+bool VarStore::setBool(VarId id, bool v) {
+  VarValue val;
+  memset(&val, 0, sizeof(val));
+  val.type = VAR_BOOL;
+  val.b = v;
+  return set(id, val);
+}
+
+bool VarStore::setString(VarId id, const char* v) {
+  VarValue val;
+  memset(&val, 0, sizeof(val));
+  val.type = VAR_STRING;
+  strncpy(val.s, v ? v : "", VAR_STORE_STRING_MAX - 1);
+  return set(id, val);
+}
+
+bool VarStore::get(VarId id, VarValue& out) const {
+  if (id < 0 || (uint16_t)id >= count_.load(std::memory_order_acquire)) return false;
+  slots_[id].value.read(out);
+  return out.type != VAR_NONE;
+}
+
+int32_t VarStore::getInt(VarId id, int32_t fallback) const {
+  VarValue v;
+  return get(id, v) && v.type == VAR_INT ? v.i : fallback;
+}
+
+float VarStore::getFloat(VarId id, float fallback) const {
+  VarValue v;
+  return get(id, v) && v.type == VAR_FLOAT ? v.f : fallback;
+}
+
+bool VarStore::getBool(VarId id, bool fallback) const {
+  VarValue v;
+  return get(id, v) && v.type == VAR_BOOL ? v.b : fallback;
+}
+
+uint32_t VarStore::version(VarId id) const {
+  if (id < 0 || (uint16_t)id >= count_.load(std::memory_order_acquire)) return 0;
+  return slots_[id].value.version();
+}
+
+bool VarStore::subscribe(VarId id, VarCallback cb, void* ctx) {
+  if (id < 0 || !cb) return false;
+  bool ok = false;
+  portENTER_CRITICAL(&lock_);
+  if (watcherCount_ < VAR_STORE_MAX_WATCHERS) {
+    watchers_[watcherCount_].id = id;
+    watchers_[watcherCount_].cb = cb;
+    watchers_[watcherCount_].ctx = ctx;
+    watcherCount_++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&lock_);
+  return ok;
+}
+
+void VarStore::unsubscribe(VarId id, VarCallback cb, void* ctx) {
+  portENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < watcherCount_;) {
+    const Watcher& w = watchers_[i];
+    if (w.id == id && w.cb == cb && w.ctx == ctx) watchers_[i] = watchers_[--watcherCount_];
+    else i++;
+  }
+  portEXIT_CRITICAL(&lock_);
+}
+
+void VarStore::valueToJson(const VarValue& v, JsonObject out) {
+  switch (v.type) {
+    case VAR_INT: out["value"] = v.i; break;
+    case VAR_FLOAT: out["value"] = v.f; break;
+    case VAR_BOOL: out["value"] = v.b; break;
+    case VAR_STRING: out["value"] = String(v.s); break;  // v is a local copy
+    default: out["value"] = nullptr; break;
+  }
+}
+
+void VarStore::toJson(JsonArray out) const {
+  uint16_t n = count_.load(std::memory_order_acquire);
+  for (uint16_t i = 0; i < n; i++) {
+    const Slot& s = slots_[i];
+    VarValue v;
+    uint32_t version = s.value.read(v);
+    JsonObject o = out.createNestedObject();
+    o["module"] = SymbolTable::global().name(s.owner);
+    o["name"] = SymbolTable::global().name(s.name);
+    o["type"] = varTypeName(s.type);
+    valueToJson(v, o);
+    o["version"] = version;
+  }
+}
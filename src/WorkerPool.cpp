@@ -0,0 +1,269 @@
+#include "WorkerPool.h"
+#include "esp_timer.h"
+#include "ModuleManager.h"
+
+WorkerPool& WorkerPool::global() {
+  static WorkerPool pool;
+  return pool;
+}
+
+WorkerPool::WorkerPool() : workerCount_(0), moduleCount_(0), nextWorker_(0), startState_(0), submitted_(0), rejected_(0) {
+  portMUX_INITIALIZE(&lock_);
+  for (size_t i = 0; i < WORKER_POOL_MAX_WORKERS; i++) {
+    Worker& w = workers_[i];
+    w.handle = nullptr;
+    w.core = (uint8_t)(i % portNUM_PROCESSORS);
+    w.head = 0;
+    w.count = 0;
+    w.executed = 0;
+    w.stolen = 0;
+    w.busyUs = 0;
+    portMUX_INITIALIZE(&w.lock);
+  }
+  for (size_t i = 0; i < WORKER_POOL_MAX_MODULES; i++) {
+    modules_[i].module.store(nullptr);
+    modules_[i].dueUs = 0;
+    modules_[i].scheduled.store(false);
+  }
+}
+
+bool WorkerPool::start() {
+  uint8_t state = 0;
+  if (!startState_.compare_exchange_strong(state, 1)) {
+    // Another task is creating the workers (tasks cannot be created in a critical section)
+    while (startState_.load() == 1) vTaskDelay(1);
+    return workerCount_ > 0;
+  }
+  for (size_t i = 0; i < WORKER_POOL_MAX_WORKERS; i++) {
+    Worker& w = workers_[i];
+    char name[16];
+    snprintf(name, sizeof(name), "POOL_%u_%u", (unsigned)w.core, (unsigned)(i / portNUM_PROCESSORS));
+    if (xTaskCreatePinnedToCore(workerMain, name, WORKER_POOL_STACK, &w, WORKER_POOL_PRIORITY, &w.handle, w.core) != pdPASS) {
+      ESP_LOGE("POOL", "Failed to start worker %s", name);
+      break;
+    }
+    workerCount_ = i + 1;
+  }
+  startState_.store(2);
+  return workerCount_ > 0;
+}
+
+bool WorkerPool::push(Worker& w, const WorkItem& item) {
+  bool ok = false;
+  portENTER_CRITICAL(&w.lock);
+  if (w.count < WORKER_POOL_DEQUE_SIZE) {
+    w.items[(w.head + w.count) % WORKER_POOL_DEQUE_SIZE] = item;
+    w.count++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&w.lock);
+  return ok;
+}
+
+bool WorkerPool::popOldest(Worker& w, WorkItem& out) {
+  bool ok = false;
+  portENTER_CRITICAL(&w.lock);
+  if (w.count > 0) {
+    out = w.items[w.head];
+    w.head = (w.head + 1) % WORKER_POOL_DEQUE_SIZE;
+    w.count--;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&w.lock);
+  return ok;
+}
+
+bool WorkerPool::steal(Worker& self, WorkItem& out) {
+  // Rob the longest other deque; its owner keeps the oldest jobs
+  Worker* victim = nullptr;
+  for (size_t i = 0; i < workerCount_; i++) {
+    Worker& w = workers_[i];
+    if (&w != &self && w.count > 0 && (!victim || w.count > victim->count)) victim = &w;
+  }
+  if (!victim) return false;
+  bool ok = false;
+  portENTER_CRITICAL(&victim->lock);
+  if (victim->count > 0) {
+    victim->count--;
+    out = victim->items[(victim->head + victim->count) % WORKER_POOL_DEQUE_SIZE];
+    ok = true;
+  }
+  portEXIT_CRITICAL(&victim->lock);
+  if (ok) self.stolen++;
+  return ok;
+}
+
+bool WorkerPool::submit(WorkFn fn, void* arg, int8_t core) {
+  if (!fn || !start()) return false;
+  if (core < 0 || core >= portNUM_PROCESSORS) core = (int8_t)xPortGetCoreID();
+  WorkItem item = {fn, arg};
+  uint32_t first = nextWorker_.fetch_add(1);
+  // Prefer a worker on the requested core, spill to any other one when its deque is full
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < workerCount_; i++) {
+      Worker& w = workers_[(first + i) % workerCount_];
+      if (pass == 0 && w.core != (uint8_t)core) continue;
+      if (!push(w, item)) continue;
+      xTaskNotifyGive(w.handle);
+      // A backlog is worth stealing: wake a worker on another core
+      if (w.count > 1) {
+        for (size_t j = 0; j < workerCount_; j++) {
+          if (workers_[j].core != w.core) {
+            xTaskNotifyGive(workers_[j].handle);
+            break;
+          }
+        }
+      }
+      portENTER_CRITICAL(&lock_);
+      submitted_++;
+      portEXIT_CRITICAL(&lock_);
+      return true;
+    }
+  }
+  portENTER_CRITICAL(&lock_);
+  rejected_++;
+  portEXIT_CRITICAL(&lock_);
+  return false;
+}
+
+WorkerPool::PoolModule* WorkerPool::find(Module* m) {
+  for (size_t i = 0; i < moduleCount_; i++) {
+    if (modules_[i].module.load() == m) return &modules_[i];
+  }
+  return nullptr;
+}
+
+bool WorkerPool::attach(Module* m) {
+  if (!m || !start()) return false;
+  PoolModule* pm = nullptr;
+  portENTER_CRITICAL(&lock_);
+  pm = find(m);
+  if (!pm) {
+    // A slot freed by detach() first; only the module pointer is ever cleared,
+    // so workers may scan without the lock
+    PoolModule* slot = find(nullptr);
+    if (!slot && moduleCount_ < WORKER_POOL_MAX_MODULES) {
+      slot = &modules_[moduleCount_];
+      slot->scheduled.store(false);
+      moduleCount_++;
+    }
+    if (slot) {
+      slot->dueUs = esp_timer_get_time();
+      slot->module.store(m);
+      pm = slot;
+    }
+  }
+  portEXIT_CRITICAL(&lock_);
+  if (!pm) return false;
+  m->setRunnerTask(workerFor(m->getTaskConfig().core));
+  schedule(*pm, esp_timer_get_time(), nullptr);
+  return true;
+}
+
+void WorkerPool::detach(Module* m) {
+  PoolModule* pm = find(m);
+  if (!pm) return;
+  // Claim the slot: waits until no job of m is queued or running
+  while (pm->scheduled.exchange(true)) vTaskDelay(1);
+  pm->module.store(nullptr);
+  pm->scheduled.store(false);
+  m->setRunnerTask(nullptr);
+}
+
+void WorkerPool::wake(Module* m) {
+  PoolModule* pm = find(m);
+  if (pm) schedule(*pm, INT64_MAX, nullptr);  // due now
+}
+
+TaskHandle_t WorkerPool::workerFor(int8_t core) const {
+  for (size_t i = 0; i < workerCount_; i++) {
+    if (core < 0 || workers_[i].core == (uint8_t)core) return workers_[i].handle;
+  }
+  return workerCount_ ? workers_[0].handle : nullptr;
+}
+
+void WorkerPool::schedule(PoolModule& pm, int64_t now, int64_t* next) {
+  // Claimed before the module is looked at, so detach() cannot clear the slot meanwhile
+  if (pm.scheduled.exchange(true)) return;
+  Module* m = pm.module.load();
+  if (m && m->isRunnable()) {
+    if (pm.dueUs <= now || m->hasWork()) {
+      if (submit(moduleJob, &pm, m->getTaskConfig().core)) return;
+      // Not queued: leave it due, the next idle worker retries
+    } else if (next && pm.dueUs < *next) {
+      *next = pm.dueUs;
+    }
+  }
+  pm.scheduled.store(false);
+}
+
+uint32_t WorkerPool::scheduleDue() {
+  int64_t now = esp_timer_get_time();
+  int64_t next = now + (int64_t)MODULE_IDLE_MAX_MS * 1000;
+  size_t n = moduleCount_;
+  for (size_t i = 0; i < n; i++) {
+    if (!modules_[i].scheduled.load()) schedule(modules_[i], now, &next);
+  }
+  return next > now ? (uint32_t)((next - now + 999) / 1000) : 0;
+}
+
+void WorkerPool::moduleJob(void* arg) {
+  PoolModule& pm = *static_cast<PoolModule*>(arg);
+  Module* m = pm.module.load();
+  uint32_t d = MODULE_IDLE_MAX_MS;
+  if (m->isRunnable()) {
+    m->drainQueue();
+    int64_t t0 = esp_timer_get_time();
+    m->update();
+    m->recordCpu(CPU_WORK_UPDATE, (uint32_t)(esp_timer_get_time() - t0));
+    d = m->nextDeadlineMs();
+  }
+  pm.dueUs = d == MODULE_WAIT_FOREVER ? INT64_MAX : esp_timer_get_time() + (int64_t)d * 1000;
+  pm.scheduled.store(false);
+  // Work that arrived while the job ran found it still scheduled; pick it up now
+  global().schedule(pm, esp_timer_get_time(), nullptr);
+}
+
+void WorkerPool::workerMain(void* arg) {
+  Worker& self = *static_cast<Worker*>(arg);
+  WorkerPool& pool = global();
+  for (;;) {
+    WorkItem item;
+    if (pool.popOldest(self, item) || pool.steal(self, item)) {
+      int64_t t0 = esp_timer_get_time();
+      item.fn(item.arg);
+      self.busyUs += (uint64_t)(esp_timer_get_time() - t0);
+      self.executed++;
+      continue;
+    }
+    // Idle: queue jobs for due modules (this wakes their worker), then sleep until the next one
+    uint32_t waitMs = pool.scheduleDue();
+    if (waitMs == 0) taskYIELD();
+    else ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+  }
+}
+
+void WorkerPool::toJson(JsonObject out) {
+  out["running"] = workerCount_ > 0;
+  portENTER_CRITICAL(&lock_);
+  uint32_t submitted = submitted_;
+  uint32_t rejected = rejected_;
+  portEXIT_CRITICAL(&lock_);
+  out["submitted"] = submitted;
+  out["rejected"] = rejected;
+  JsonArray workers = out.createNestedArray("workers");
+  for (size_t i = 0; i < workerCount_; i++) {
+    const Worker& w = workers_[i];
+    JsonObject o = workers.createNestedObject();
+    o["core"] = w.core;
+    o["queued"] = w.count;
+    o["executed"] = w.executed;
+    o["stolen"] = w.stolen;
+    o["busy_us"] = w.busyUs;
+  }
+  JsonArray mods = out.createNestedArray("modules");
+  for (size_t i = 0; i < moduleCount_; i++) {
+    Module* m = modules_[i].module.load();
+    if (m) mods.add(m->getName());
+  }
+}
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include "Config.h"
 #include "ModuleManager.h"
+#include "Trace.h"
 
 // Include all modules
 #include "modules/CONTROL_FS.h"
@@ -21,10 +22,19 @@ CONTROL_SERIAL* serialModule = nullptr;
 CONTROL_WEB* webModule = nullptr;
 CONTROL_RADAR* radarModule = nullptr;
 
+// Take a pooled message from the LCD queue; nullptr when the pool is exhausted
+static QueueMessage* lcdMessage(QueueBase* qb) {
+    QueueMessage* msg = qb ? qb->acquire() : nullptr;
+    if (!msg) return nullptr;
+    msg->fromQueue = "main";
+    return msg;
+}
+
 void setup() {
     // Initialize Serial first
     Serial.begin(SERIAL_BAUD);
     delay(1000);
+    TRACE_SCOPE("boot", "setup");
     
     DEBUG_I("===========================================");
     DEBUG_I("ESP32 Modular System v1.0.0");
@@ -101,12 +111,12 @@ void setup() {
     // Show status on LCD
     if (lcdModule && lcdModule->getState() == MODULE_ENABLED) {
         QueueBase* qb = lcdModule->getQueue();
-        if (qb) {
-            DynamicJsonDocument* vars = new DynamicJsonDocument(256);
-            (*vars)["title"] = String("System");
-            JsonArray arr = (*vars)["lines"].to<JsonArray>();
+        QueueMessage* msg = lcdMessage(qb);
+        if (msg) {
+            QUEUE_MESSAGE_CALL(msg, "lcd_status");
+            (*msg->callVariables)["title"] = String("System");
+            JsonArray arr = (*msg->callVariables)["lines"].to<JsonArray>();
             arr.add("Initialized");
-            QueueMessage* msg = new QueueMessage{genUUID4(), lcdModule->getName(), String("main"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_status"), vars};
             qb->send(msg);
         }
     }
@@ -124,36 +134,42 @@ void setup() {
     
     if (lcdModule && lcdModule->getState() == MODULE_ENABLED) {
         QueueBase* qb = lcdModule->getQueue();
-        if (qb) {
-            DynamicJsonDocument* v1 = new DynamicJsonDocument(256);
-            (*v1)["title"] = String("System");
-            JsonArray arr1 = (*v1)["lines"].to<JsonArray>();
+        QueueMessage* m1 = lcdMessage(qb);
+        if (m1) {
+            QUEUE_MESSAGE_CALL(m1, "lcd_status");
+            (*m1->callVariables)["title"] = String("System");
+            JsonArray arr1 = (*m1->callVariables)["lines"].to<JsonArray>();
             arr1.add("Ready");
-            QueueMessage* m1 = new QueueMessage{genUUID4(), lcdModule->getName(), String("main"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_status"), v1};
             qb->send(m1);
-            if (wifiModule && wifiModule->getState() == MODULE_ENABLED) {
-                String ip = wifiModule->getIP();
-                DynamicJsonDocument* v2 = new DynamicJsonDocument(256);
-                (*v2)["x"] = 10;
-                (*v2)["y"] = 265;
-                (*v2)["text"] = String("WiFi: ") + wifiModule->getSSID();
-                (*v2)["color"] = (uint16_t)TFT_CYAN;
-                QueueMessage* m2 = new QueueMessage{genUUID4(), lcdModule->getName(), String("main"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_text"), v2};
+        }
+        if (wifiModule && wifiModule->getState() == MODULE_ENABLED) {
+            String ip = wifiModule->getIP();
+            QueueMessage* m2 = lcdMessage(qb);
+            if (m2) {
+                QUEUE_MESSAGE_CALL(m2, "lcd_text");
+                (*m2->callVariables)["x"] = 10;
+                (*m2->callVariables)["y"] = 265;
+                (*m2->callVariables)["text"] = String("WiFi: ") + wifiModule->getSSID();
+                (*m2->callVariables)["color"] = (uint16_t)TFT_CYAN;
                 qb->send(m2);
-                DynamicJsonDocument* v3 = new DynamicJsonDocument(256);
-                (*v3)["x"] = 10;
-                (*v3)["y"] = 280;
-                (*v3)["text"] = String("IP: ") + ip;
-                (*v3)["color"] = (uint16_t)TFT_CYAN;
-                QueueMessage* m3 = new QueueMessage{genUUID4(), lcdModule->getName(), String("main"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_text"), v3};
+            }
+            QueueMessage* m3 = lcdMessage(qb);
+            if (m3) {
+                QUEUE_MESSAGE_CALL(m3, "lcd_text");
+                (*m3->callVariables)["x"] = 10;
+                (*m3->callVariables)["y"] = 280;
+                (*m3->callVariables)["text"] = String("IP: ") + ip;
+                (*m3->callVariables)["color"] = (uint16_t)TFT_CYAN;
                 qb->send(m3);
             }
-            DynamicJsonDocument* v4 = new DynamicJsonDocument(256);
-            (*v4)["x"] = 10;
-            (*v4)["y"] = 295;
-            (*v4)["text"] = String("Web: http://192.168.4.1");
-            (*v4)["color"] = (uint16_t)TFT_YELLOW;
-            QueueMessage* m4 = new QueueMessage{genUUID4(), lcdModule->getName(), String("main"), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_text"), v4};
+        }
+        QueueMessage* m4 = lcdMessage(qb);
+        if (m4) {
+            QUEUE_MESSAGE_CALL(m4, "lcd_text");
+            (*m4->callVariables)["x"] = 10;
+            (*m4->callVariables)["y"] = 295;
+            (*m4->callVariables)["text"] = String("Web: http://192.168.4.1");
+            (*m4->callVariables)["color"] = (uint16_t)TFT_YELLOW;
             qb->send(m4);
         }
     }
@@ -163,6 +179,8 @@ void loop() {
     // Run all module loops
     moduleManager->updateModules();
     
-    // Small delay to prevent watchdog issues
-    delay(10);
+    // Sleep until a task-less module gets a message or one of them is due
+    uint32_t waitMs = moduleManager->loopWaitMs();
+    if (waitMs == 0) taskYIELD();
+    else ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
@@ -1,4 +1,5 @@
 #include "CONTROL_FS.h"
+#include "Trace.h"
 
 CONTROL_FS::CONTROL_FS() : Module("CONTROL_FS") {
     fsMaxSize = FS_MAX_SIZE_DEFAULT;
@@ -100,6 +101,11 @@ bool CONTROL_FS::update() {
     return true;
 }
 
+uint32_t CONTROL_FS::nextDeadlineMs() {
+    // Log rotation check only
+    return 1000;
+}
+
 bool CONTROL_FS::test() {
     log("Testing file system...");
     
@@ -194,10 +200,12 @@ DynamicJsonDocument CONTROL_FS::getStatus() {
         doc["configManager"] = "not_initialized";
     }
     
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
 bool CONTROL_FS::initFileSystem() {
+    TRACE_SCOPE("fs", "mount");
     if (!SPIFFS.begin(true)) {
         Serial.println("SPIFFS Mount Failed");
         return false;
@@ -225,15 +233,17 @@ bool CONTROL_FS::checkAndCreateDirectories() {
 }
 
 bool CONTROL_FS::auditFileSystem(bool fix) {
+    TRACE_SCOPE("fs", "audit");
     log("Starting filesystem audit...");
-    Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
+    Module* lcdMod = lcdHandle.get();
     QueueBase* lcdQ = (lcdMod && lcdMod->getState() == MODULE_ENABLED) ? lcdMod->getQueue() : nullptr;
     auto pushLCD = [&](const String& msg){
-        if (!lcdQ) return;
-        DynamicJsonDocument* vars = new DynamicJsonDocument(128);
-        JsonArray arr = vars->createNestedArray("v");
+        QueueMessage* qm = lcdQ ? lcdQ->acquire() : nullptr;
+        if (!qm) return;
+        qm->fromQueue = moduleName;
+        QUEUE_MESSAGE_CALL(qm, "lcd_log_append");
+        JsonArray arr = qm->callVariables->createNestedArray("v");
         arr.add(msg);
-        QueueMessage* qm = new QueueMessage{genUUID4(), lcdMod->getName(), getName(), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_log_append"), vars};
         lcdQ->send(qm);
     };
     pushLCD("Audit: scanning files...");
@@ -333,6 +343,7 @@ String CONTROL_FS::getLogTimestamp() {
 
 bool CONTROL_FS::writeFile(const String& path, const String& content, const char* mode) {
     if (!fsInitialized) return false;
+    TRACE_SCOPE("fs", "write");
     if (fsMutex) xSemaphoreTake(fsMutex, portMAX_DELAY);
     
     File file = SPIFFS.open(path, mode);
@@ -355,6 +366,7 @@ bool CONTROL_FS::writeFile(const String& path, const String& content, const char
 
 String CONTROL_FS::readFile(const String& path) {
     if (!fsInitialized) return "";
+    TRACE_SCOPE("fs", "read");
     if (fsMutex) xSemaphoreTake(fsMutex, portMAX_DELAY);
     
     if (!fileExists(path)) {
@@ -383,6 +395,7 @@ String CONTROL_FS::readFile(const String& path) {
 
 bool CONTROL_FS::deleteFile(const String& path) {
     if (!fsInitialized) return false;
+    TRACE_SCOPE("fs", "delete");
     if (fsMutex) xSemaphoreTake(fsMutex, portMAX_DELAY);
     
     if (!fileExists(path)) {
@@ -461,6 +474,7 @@ bool CONTROL_FS::writeLog(const String& message, const char* level) {
         return false;
     }
     
+    TRACE_SCOPE("fs", "log");
     String logEntry = getLogTimestamp() + " [" + String(level) + "] " + message + "\n";
     const char* path = LOG_FILE_PATH;
     if (strcmp(level, "DEBUG") == 0) {
@@ -536,6 +550,7 @@ bool CONTROL_FS::saveGlobalConfig(const DynamicJsonDocument& doc) {
         log("ConfigManager has no configuration", "ERROR");
         return false;
     }
+    TRACE_SCOPE("fs", "save global config");
     *cfg = doc;
     ConfigValidationResult v = configManager->validateConfiguration();
     if (v != CONFIG_VALID) {
@@ -599,6 +614,7 @@ bool CONTROL_FS::formatFileSystem() {
 }
 
 bool CONTROL_FS::initConfigManager() {
+    TRACE_SCOPE("config", "init");
     log("Initializing ConfigManager...");
     
     configManager = new ConfigManager();
@@ -46,6 +46,7 @@
  */
 class CONTROL_FS : public Module {
 private:
+    ModuleHandle<Module> lcdHandle{"CONTROL_LCD"};  // only its queue is used
     size_t fsMaxSize;
     size_t logMaxSize;
     bool fsInitialized;
@@ -68,6 +69,7 @@ public:
     bool start() override;
     bool stop() override;
     bool update() override;
+    uint32_t nextDeadlineMs() override;
     bool test() override;
     DynamicJsonDocument getStatus() override;
     
@@ -9,6 +9,10 @@ CONTROL_LCD::CONTROL_LCD() : Module("CONTROL_LCD") {
     lcdInitialized = false;
     brightness = 255;
     rotation = 90;
+    logAppendId = SYMBOL_ID("lcd_log_append");
+    radarUpdateId = SYMBOL_ID("lcd_radar_update");
+    logAppendFn = FunctionHandle{-1};
+    radarUpdateFn = FunctionHandle{-1};
     priority = 90; // High priority
     autoStart = true;
     version = "1.0.1";
@@ -22,11 +26,7 @@ CONTROL_LCD::CONTROL_LCD() : Module("CONTROL_LCD") {
     QueueConfig qcfg = getQueueConfig();
     qcfg.length = 16;
     setQueueConfig(qcfg);
-    lastRadarDistance = -9999;
-    lastRadarSpeed = -9999.0f;
-    lastRadarDir = -99;
-    lastRadarType = -99;
-    lastRadarAngle = -9999;
+    memset(&lastRadar, 0, sizeof(lastRadar));
     firstRadarDraw = true;
 }
 
@@ -66,8 +66,8 @@ bool CONTROL_LCD::init() {
     log("LCD initialized successfully");
     displayWelcome();
     {
-        Module* wifiMod = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
-        String ip = wifiMod ? static_cast<CONTROL_WIFI*>(wifiMod)->getIP() : String("esp32.local");
+        CONTROL_WIFI* wifi = wifiHandle.get();
+        String ip = wifi ? wifi->getIP() : String("esp32.local");
         drawFooterURL(String("http://") + ip);
     }
     
@@ -98,28 +98,14 @@ bool CONTROL_LCD::stop() {
 }
 
 bool CONTROL_LCD::update() {
-    QueueBase* qb = getQueue();
-    if (qb) {
-        QueueMessage* incoming = nullptr;
-        if (qb->receive(incoming)) {
-            if (incoming && incoming->callVariables) {
-                String result;
-                bool ok = ModuleRegistry::getInstance()->callFunction(getName(), incoming->callName, incoming->callVariables, result);
-                if (!ok) {
-                    if (incoming->callName == "lcd_log_append") { fn_lcd_log_append(incoming->callVariables, result); }
-                    else if (incoming->callName == "lcd_radar_update") { fn_lcd_radar_update(incoming->callVariables, result); }
-                    else if (incoming->callName == "lcd_status") { fn_lcd_status(incoming->callVariables, result); }
-                    else if (incoming->callName == "lcd_text") { fn_lcd_text(incoming->callVariables, result); }
-                    else if (incoming->callName == "lcd_boot_step") { fn_lcd_boot_step(incoming->callVariables, result); }
-                }
-                delete incoming->callVariables;
-                delete incoming;
-            } else if (incoming) { delete incoming; }
-        }
-    }
+    // Queued draw calls are dispatched by Module::handleMessage() when the runner drains the queue
     return true;
 }
 
+uint32_t CONTROL_LCD::nextDeadlineMs() {
+    return MODULE_WAIT_FOREVER;
+}
+
 bool CONTROL_LCD::test() {
     log("Testing LCD...");
     
@@ -154,7 +140,7 @@ bool CONTROL_LCD::test() {
 }
 
 DynamicJsonDocument CONTROL_LCD::getStatus() {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(3072);
     
     doc["module"] = moduleName;
     doc["state"] = state == MODULE_ENABLED ? "enabled" : "disabled";
@@ -168,7 +154,9 @@ DynamicJsonDocument CONTROL_LCD::getStatus() {
     doc["brightness"] = brightness;
     doc["rotation"] = rotation;
     doc["initialized"] = lcdInitialized;
+    if (getQueue()) getQueue()->toJson(doc.createNestedObject("queue"));
     
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
@@ -352,8 +340,9 @@ void CONTROL_LCD::drawProgressBar(int16_t x, int16_t y, int16_t w, int16_t h, ui
     tft->setTextDatum(TL_DATUM);
 }
 
-void CONTROL_LCD::drawRadarBox(int d, float v, int dir, int type, int ang, float vx, float vy, float ms, float size, const String& shape, float avgRps) {
+void CONTROL_LCD::drawRadarBox(const RadarSample& s) {
     if (!tft) return;
+    int d = s.d; float v = s.v; int dir = s.dir; int type = s.type; int ang = s.ang;
     int16_t top = 50;
     int16_t h = 200;
     int16_t left = 10;
@@ -387,20 +376,20 @@ void CONTROL_LCD::drawRadarBox(int d, float v, int dir, int type, int ang, float
     tft->setTextColor(TFT_BLACK, TFT_DARKGREY);
     tft->setCursor(textX, textY);
     tft->setTextColor(TFT_BLUE, TFT_DARKGREY);
-    tft->print(String("Vec x") + String(vx, 2)  + " cm/s");
+    tft->print(String("Vec x") + String(s.vx, 2)  + " cm/s");
     tft->setCursor(textX, textY + 20);
-    tft->print(String("Vec y")  + String(vy, 2) + " cm/s");
+    tft->print(String("Vec y")  + String(s.vy, 2) + " cm/s");
     tft->setCursor(textX, textY + 40);
     tft->setTextColor(TFT_DARKGREEN, TFT_DARKGREY);
-    tft->print(String("Move ") + String(ms, 2) + " cm/s");
+    tft->print(String("Move ") + String(s.ms, 2) + " cm/s");
     tft->setCursor(textX, textY + 60);
-    tft->print(String("Size ") + String(size, 2) + " cm");
+    tft->print(String("Size ") + String(s.size, 2) + " cm");
     tft->setCursor(textX, textY + 80);
     tft->setTextColor(TFT_OLIVE, TFT_DARKGREY);
-    tft->print(String("Shape ") + shape + String("  RPS ") + String(avgRps, 1));
+    tft->print(String("Shape ") + radarShapeName(s.shape) + String("  RPS ") + String(s.avgRps, 1));
     {
-        Module* wifiMod = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
-        String ip = wifiMod ? static_cast<CONTROL_WIFI*>(wifiMod)->getIP() : String("esp32.local");
+        CONTROL_WIFI* wifi = wifiHandle.get();
+        String ip = wifi ? wifi->getIP() : String("esp32.local");
         drawFooterURL(String("http://") + ip);
     }
 }
@@ -427,32 +416,12 @@ bool CONTROL_LCD::fn_lcd_log_append(DynamicJsonDocument* params, String& result)
     return true;
 }
 
-bool CONTROL_LCD::fn_lcd_radar_update(DynamicJsonDocument* params, String& result) {
-    int d = (*params)["d"] | -1;
-    float v = (*params)["v"] | 0.0f;
-    int dir = (*params)["dir"] | 0;
-    int type = (*params)["type"] | 0;
-    int ang = (*params)["ang"] | 0;
-    float vx = (*params)["vx"] | 0.0f;
-    float vy = (*params)["vy"] | 0.0f;
-    float ms = (*params)["ms"] | 0.0f;
-    float size = (*params)["size"] | 0.0f;
-    String shape = (*params)["shape"].as<String>();
-    float avgRps = (*params)["avg_rps"] | 0.0f;
-    bool changed = firstRadarDraw || d != lastRadarDistance || ang != lastRadarAngle || dir != lastRadarDir || type != lastRadarType || vx != lastRadarVx || vy != lastRadarVy || ms != lastRadarMS || size != lastSize || shape != lastShape || avgRps != lastAvgRPS;
+bool CONTROL_LCD::fn_lcd_radar_update(const RadarSample& s, String& result) {
+    const RadarSample& p = lastRadar;
+    bool changed = firstRadarDraw || s.d != p.d || s.ang != p.ang || s.dir != p.dir || s.type != p.type || s.vx != p.vx || s.vy != p.vy || s.ms != p.ms || s.size != p.size || s.shape != p.shape || s.avgRps != p.avgRps;
     if (changed) {
-        drawRadarBox(d, v, dir, type, ang, vx, vy, ms, size, shape, avgRps);
-        lastRadarDistance = d;
-        lastRadarSpeed = v;
-        lastRadarDir = dir;
-        lastRadarType = type;
-        lastRadarAngle = ang;
-        lastRadarVx = vx;
-        lastRadarVy = vy;
-        lastRadarMS = ms;
-        lastSize = size;
-        lastShape = shape;
-        lastAvgRPS = avgRps;
+        drawRadarBox(s);
+        lastRadar = s;
         firstRadarDraw = false;
     }
     result = String("ok");
@@ -493,21 +462,45 @@ bool CONTROL_LCD::fn_lcd_boot_step(DynamicJsonDocument* params, String& result)
 
 bool CONTROL_LCD::callFunctionByName(const String& name, DynamicJsonDocument* params, String& result) {
     if (name == "fn_lcd_log_append") return fn_lcd_log_append(params, result);
-    if (name == "fn_lcd_radar_update") return fn_lcd_radar_update(params, result);
+    if (name == "fn_lcd_radar_update") {
+        RadarSample s;
+        memset(&s, 0, sizeof(s));
+        PayloadTraits<RadarSample>::fromJson(params->as<JsonVariantConst>(), s);
+        return fn_lcd_radar_update(s, result);
+    }
     if (name == "fn_lcd_status") return fn_lcd_status(params, result);
     if (name == "fn_lcd_text") return fn_lcd_text(params, result);
     if (name == "fn_lcd_boot_step") return fn_lcd_boot_step(params, result);
     return false;
 }
 
+void CONTROL_LCD::handleMessage(QueueMessage* msg) {
+    if (!msg) return;
+    FunctionHandle fn = FunctionHandle{-1};
+    SymbolId id = queueMessageCallId(msg);
+    if (id == logAppendId) fn = logAppendFn;
+    else if (id == radarUpdateId) fn = radarUpdateFn;
+    if (!fn.valid()) {
+        Module::handleMessage(msg);
+        return;
+    }
+    String result;
+    ModuleRegistry::getInstance()->call(fn, msg, result);
+}
+
 void CONTROL_LCD::registerFunctions() {
-    ModuleRegistry::getInstance()->registerFunctionName(getName(), String("lcd_log_append"), String("fn_lcd_log_append"));
-    ModuleRegistry::getInstance()->registerFunctionName(getName(), String("lcd_radar_update"), String("fn_lcd_radar_update"));
-    ModuleRegistry::getInstance()->registerFunctionName(getName(), String("lcd_status"), String("fn_lcd_status"));
-    ModuleRegistry::getInstance()->registerFunctionName(getName(), String("lcd_text"), String("fn_lcd_text"));
-    ModuleRegistry::getInstance()->registerFunctionName(getName(), String("lcd_boot_step"), String("fn_lcd_boot_step"));
+    // Registered as pointers so queue dispatch is an index lookup plus one call;
+    // callFunctionByName still serves NAME registrations made from serial/web.
+    ModuleRegistry* reg = ModuleRegistry::getInstance();
+    logAppendFn = reg->registerFunctionPointer(getName(), String("lcd_log_append"), [](void* ctx, DynamicJsonDocument* p, String& r) { return ((CONTROL_LCD*)ctx)->fn_lcd_log_append(p, r); });
+    radarUpdateFn = reg->registerFunctionTyped<RadarSample>(getName(), String("lcd_radar_update"), [](void* ctx, const RadarSample& s, String& r) { return ((CONTROL_LCD*)ctx)->fn_lcd_radar_update(s, r); });
+    reg->registerFunctionPointer(getName(), String("lcd_status"), [](void* ctx, DynamicJsonDocument* p, String& r) { return ((CONTROL_LCD*)ctx)->fn_lcd_status(p, r); });
+    reg->registerFunctionPointer(getName(), String("lcd_text"), [](void* ctx, DynamicJsonDocument* p, String& r) { return ((CONTROL_LCD*)ctx)->fn_lcd_text(p, r); });
+    reg->registerFunctionPointer(getName(), String("lcd_boot_step"), [](void* ctx, DynamicJsonDocument* p, String& r) { return ((CONTROL_LCD*)ctx)->fn_lcd_boot_step(p, r); });
+    reg->bus().subscribe(RADAR_SAMPLE_TOPIC, this, "lcd_radar_update");
 }
 
 void CONTROL_LCD::unregisterFunctions() {
+    ModuleRegistry::getInstance()->bus().unsubscribe(RADAR_SAMPLE_TOPIC, this);
     // For now, recreate registry on demand; to fully unregister, recreate ModuleRegistry or add removal API
 }
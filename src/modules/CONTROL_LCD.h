@@ -11,38 +11,39 @@
 
 #include "../ModuleManager.h"
 #include "../../include/Config.h"
+#include "../../include/ModuleRegistry.h"
+#include "CONTROL_RADAR.h"
 #include <vector>
 #include <TFT_eSPI.h>
 
+class CONTROL_WIFI;
+
 class CONTROL_LCD : public Module {
 private:
+    ModuleHandle<CONTROL_WIFI> wifiHandle{"CONTROL_WIFI"};
     TFT_eSPI* tft;
     bool lcdInitialized;
     uint8_t brightness;
     uint8_t rotation;
     std::vector<String> logLines;
-    int lastRadarDistance;
-    float lastRadarSpeed;
-    int lastRadarDir;
-    int lastRadarType;
-    int lastRadarAngle;
-    float lastRadarVx;
-    float lastRadarVy;
-    float lastRadarMS;
-    float lastAvgRPS;
-    float lastSize;
-    String lastShape;
+    RadarSample lastRadar;
     bool firstRadarDraw;
+    // One call per log line and per radar sample: dispatched through the
+    // handles kept at registration instead of the registry index
+    SymbolId logAppendId;
+    SymbolId radarUpdateId;
+    FunctionHandle logAppendFn;
+    FunctionHandle radarUpdateFn;
     
     void setupBacklight();
-    void drawRadarBox(int d, float v, int dir, int type, int ang, float vx, float vy, float ms, float size, const String& shape, float avgRps);
+    void drawRadarBox(const RadarSample& s);
     void registerFunctions();
     void unregisterFunctions();
     void drawFooterURL(const String& url);
     
     // Registered functions (public for NAME dispatch)
     bool fn_lcd_log_append(DynamicJsonDocument* params, String& result);
-    bool fn_lcd_radar_update(DynamicJsonDocument* params, String& result);
+    bool fn_lcd_radar_update(const RadarSample& sample, String& result);
     bool fn_lcd_status(DynamicJsonDocument* params, String& result);
     bool fn_lcd_text(DynamicJsonDocument* params, String& result);
     bool fn_lcd_boot_step(DynamicJsonDocument* params, String& result);
@@ -56,10 +57,12 @@ public:
     bool start() override;
     bool stop() override;
     bool update() override;
+    uint32_t nextDeadlineMs() override;
     bool test() override;
     DynamicJsonDocument getStatus() override;
     bool loadConfig(DynamicJsonDocument& doc) override;
     bool callFunctionByName(const String& name, DynamicJsonDocument* params, String& result) override;
+    void handleMessage(QueueMessage* msg) override;
     
     // LCD control
     TFT_eSPI* getDisplay() { return tft; }
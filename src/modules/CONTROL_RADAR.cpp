@@ -1,9 +1,17 @@
 #include "CONTROL_RADAR.h"
+#include "../../include/ModuleRegistry.h"
 #include "CONTROL_LCD.h"
 #include <Arduino.h>
+#include "esp_timer.h"
 
-CONTROL_RADAR::CONTROL_RADAR() : Module("CONTROL_RADAR") {
+CONTROL_RADAR::CONTROL_RADAR() : Module("CONTROL_RADAR"), sampleActivity("sample", 100000), stepActivity("step", 6000) {
+    // lcd_radar_update is bound by CONTROL_LCD's typed handler; web_radar_update has no
+    // registry handler, so its type is registered here for JSON conversion at the edges
+    TypedPayloads::global().registerType<RadarSample>(SYMBOL_ID("web_radar_update"));
     radarInitialized = false;
+    echoStreaming = false;
+    echoRiseUs = 0;
+    echoRiseSeen = false;
     lastUpdate = 0;
     lastBlink = 0;
     ledState = false;
@@ -61,39 +69,50 @@ CONTROL_RADAR::CONTROL_RADAR() : Module("CONTROL_RADAR") {
     movementSpeedAbs = 0.0f;
     avgRPS = 0.0f;
     sizeEstimate = 0.0f;
-    shapeClass = String("unknown");
+    shapeClass = RADAR_SHAPE_UNKNOWN;
+    PeriodMonitor::global().add(&sampleActivity, "CONTROL_RADAR");
+    PeriodMonitor::global().add(&stepActivity, "CONTROL_RADAR");
+    distanceVar = ModuleRegistry::getInstance()->vars().define("CONTROL_RADAR", "distance_cm", VAR_INT);
 }
 
 CONTROL_RADAR::~CONTROL_RADAR() {
     stop();
+    PeriodMonitor::global().remove(&sampleActivity);
+    PeriodMonitor::global().remove(&stepActivity);
 }
 
 bool CONTROL_RADAR::init() {
     setupPins();
     probeHardware();
     // Log and display pre-start checks
-    Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
+    Module* lcdMod = lcdHandle.get();
     if (lcdMod && lcdMod->getState() == MODULE_ENABLED) {
         QueueBase* qb = lcdMod->getQueue();
-        if (qb) {
-            DynamicJsonDocument* vars = new DynamicJsonDocument(128);
-            (*vars)["msg"] = String("RADAR probe: sensor=") + (sensorPresent?"yes":"no") + ", stepper=" + (stepperPresent?"yes":"no");
-            QueueMessage* msg = new QueueMessage{genUUID4(), lcdMod->getName(), getName(), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_log_append"), vars};
+        QueueMessage* msg = qb ? qb->acquire() : nullptr;
+        if (msg) {
+            msg->fromQueue = moduleName;
+            QUEUE_MESSAGE_CALL(msg, "lcd_log_append");
+            (*msg->callVariables)["msg"] = String("RADAR probe: sensor=") + (sensorPresent?"yes":"no") + ", stepper=" + (stepperPresent?"yes":"no");
             qb->send(msg);
         }
     }
     radarInitialized = true;
+    startEchoStream();
     setState(MODULE_ENABLED);
     return true;
 }
 
 bool CONTROL_RADAR::start() {
     if (!radarInitialized) return init();
+    startEchoStream();
     setState(MODULE_ENABLED);
     return true;
 }
 
 bool CONTROL_RADAR::stop() {
+    stopEchoStream();
+    sampleActivity.pause();
+    stepActivity.pause();
     if (component.ledPin) digitalWrite(component.ledPin, LOW);
     setState(MODULE_DISABLED);
     return true;
@@ -109,88 +128,162 @@ bool CONTROL_RADAR::update() {
     }
     if (buttonsPresent) handleButtons();
     if (stepperPresent && (rotationMode == 1 || rotationMode == 2 || rotationMode == 3)) {
-        unsigned long stepInterval = rotationMode == 1 ? 10 * component.step : (rotationMode == 2 ? 3 * component.step : 6 * component.step);
-        if (now - lastStepMs >= stepInterval) {
+        if (now - lastStepMs >= stepIntervalMs()) {
+            stepActivity.setPeriodUs(stepIntervalMs() * 1000);
+            stepActivity.tick();
             stepMotorOnce();
             lastStepMs = now;
         }
+    } else {
+        stepActivity.pause();
     }
-    if (sensorPresent && now - lastUpdate >= component.speed) {
-        long d = measureDistance();
-        if (d >= 0) {
-            if (lastDistance >= 0) {
-                unsigned long dt = now - lastMeasureMs;
-                if (dt > 0) {
-                    float v = (float)(d - lastDistance) / ((float)dt / 1000.0);
-                    lastSpeed = v;
-                    movementDir = (v > 0) ? 1 : (v < 0 ? -1 : 0);
-                    float rad = angleDeg * 0.01745329252f;
-                    vectorVx = v * cos(rad);
-                    vectorVy = v * sin(rad);
-                    movementSpeedAbs = v >= 0 ? v : -v;
-                }
-            }
-            lastDistance = d;
-            lastMeasureMs = now;
-            distSamples[sampleIndex] = d;
-            timeSamples[sampleIndex] = now;
-            sampleIndex = (sampleIndex + 1) % SAMPLE_WINDOW;
-            if (sampleCount < SAMPLE_WINDOW) sampleCount++;
-            int cnt = 0;
-            for (int i = 0; i < sampleCount; i++) {
-                unsigned long t = timeSamples[i];
-                if (now - t <= 1000) cnt++;
-            }
-            avgRPS = (float)cnt;
-            float mean = 0.0f;
-            for (int i = 0; i < sampleCount; i++) mean += (float)distSamples[i];
-            if (sampleCount > 0) mean /= (float)sampleCount;
-            float var = 0.0f;
-            for (int i = 0; i < sampleCount; i++) {
-                float dd = (float)distSamples[i] - mean;
-                var += dd * dd;
-            }
-            if (sampleCount > 1) var /= (float)(sampleCount - 1);
-            sizeEstimate = sqrtf(var);
-            if (sizeEstimate < 2.0f) shapeClass = String("point");
-            else if (sizeEstimate < 5.0f) shapeClass = String("round");
-            else shapeClass = String("flat");
-            Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
-            if (lcdMod && lcdMod->getState() == MODULE_ENABLED) {
-                QueueBase* qb = lcdMod->getQueue();
-                if (qb) {
-                    DynamicJsonDocument* vars = new DynamicJsonDocument(256);
-                    (*vars)["d"] = (int)d;
-                    (*vars)["v"] = measureMode == 1 ? lastSpeed : 0.0f;
-                    (*vars)["dir"] = measureMode == 1 ? movementDir : 0;
-                    (*vars)["type"] = (int)component.type;
-                    (*vars)["ang"] = (int)angleDeg;
-                    (*vars)["vx"] = vectorVx;
-                    (*vars)["vy"] = vectorVy;
-                    (*vars)["ms"] = movementSpeedAbs;
-                    (*vars)["size"] = sizeEstimate;
-                    (*vars)["shape"] = shapeClass;
-                    (*vars)["avg_rps"] = avgRPS;
-                    QueueMessage* msg = new QueueMessage{genUUID4(), lcdMod->getName(), getName(), EVENT_DATA_READY, CALL_FUNCTION_ASYNC, String("lcd_radar_update"), vars};
-                    qb->send(msg);
-                }
-            }
-            if (rotationMode == 3) {
-                if (movementDir > 0) motorDirFwd = true; else if (movementDir < 0) motorDirFwd = false;
-            }
+    if (sensorPresent && echoStreaming) {
+        // Echo edges arrive through the ISR stream; a ping only has to be fired
+        long d = takeEchoDistance();
+        if (d >= 0) processDistance(d, now);
+        if (now - lastUpdate >= component.speed) {
+            sampleActivity.setPeriodUs((uint32_t)component.speed * 1000);
+            sampleActivity.tick();
+            triggerPing();
+            lastUpdate = now;
         }
+    } else if (sensorPresent && now - lastUpdate >= component.speed) {
+        sampleActivity.setPeriodUs((uint32_t)component.speed * 1000);
+        sampleActivity.tick();
+        long d = measureDistance();
+        if (d >= 0) processDistance(d, now);
         lastUpdate = now;
     }
     return true;
 }
 
+void CONTROL_RADAR::processDistance(long d, unsigned long now) {
+    if (lastDistance >= 0) {
+        unsigned long dt = now - lastMeasureMs;
+        if (dt > 0) {
+            float v = (float)(d - lastDistance) / ((float)dt / 1000.0);
+            lastSpeed = v;
+            movementDir = (v > 0) ? 1 : (v < 0 ? -1 : 0);
+            float rad = angleDeg * 0.01745329252f;
+            vectorVx = v * cos(rad);
+            vectorVy = v * sin(rad);
+            movementSpeedAbs = v >= 0 ? v : -v;
+        }
+    }
+    lastDistance = d;
+    lastMeasureMs = now;
+    ModuleRegistry::getInstance()->vars().setInt(distanceVar, (int32_t)d);
+    distSamples[sampleIndex] = d;
+    timeSamples[sampleIndex] = now;
+    sampleIndex = (sampleIndex + 1) % SAMPLE_WINDOW;
+    if (sampleCount < SAMPLE_WINDOW) sampleCount++;
+    int cnt = 0;
+    for (int i = 0; i < sampleCount; i++) {
+        unsigned long t = timeSamples[i];
+        if (now - t <= 1000) cnt++;
+    }
+    avgRPS = (float)cnt;
+    float mean = 0.0f;
+    for (int i = 0; i < sampleCount; i++) mean += (float)distSamples[i];
+    if (sampleCount > 0) mean /= (float)sampleCount;
+    float var = 0.0f;
+    for (int i = 0; i < sampleCount; i++) {
+        float dd = (float)distSamples[i] - mean;
+        var += dd * dd;
+    }
+    if (sampleCount > 1) var /= (float)(sampleCount - 1);
+    sizeEstimate = sqrtf(var);
+    if (sizeEstimate < 2.0f) shapeClass = RADAR_SHAPE_POINT;
+    else if (sizeEstimate < 5.0f) shapeClass = RADAR_SHAPE_ROUND;
+    else shapeClass = RADAR_SHAPE_FLAT;
+    RadarSample sample;
+    sample.d = (int32_t)d;
+    sample.v = measureMode == 1 ? lastSpeed : 0.0f;
+    sample.dir = (int8_t)(measureMode == 1 ? movementDir : 0);
+    sample.type = component.type;
+    sample.shape = shapeClass;
+    sample.ang = (int16_t)angleDeg;
+    sample.vx = vectorVx;
+    sample.vy = vectorVy;
+    sample.ms = movementSpeedAbs;
+    sample.size = sizeEstimate;
+    sample.avgRps = avgRPS;
+    // Consumers (LCD, web UI) subscribe to the topic themselves
+    ModuleRegistry::getInstance()->bus().publish(SYMBOL_ID(RADAR_SAMPLE_TOPIC), sample, moduleName);
+    if (rotationMode == 3) {
+        if (movementDir > 0) motorDirFwd = true; else if (movementDir < 0) motorDirFwd = false;
+    }
+}
+
+unsigned long CONTROL_RADAR::stepIntervalMs() const {
+    return rotationMode == 1 ? 10 * component.step : (rotationMode == 2 ? 3 * component.step : 6 * component.step);
+}
+
+uint32_t CONTROL_RADAR::nextDeadlineMs() {
+    // Buttons are polled for debouncing
+    if (buttonsPresent) return 10;
+    unsigned long now = millis();
+    uint32_t wait = MODULE_WAIT_FOREVER;
+    auto due = [&](unsigned long last, unsigned long interval) {
+        unsigned long elapsed = now - last;
+        uint32_t w = elapsed >= interval ? 0 : (uint32_t)(interval - elapsed);
+        if (w < wait) wait = w;
+    };
+    if (component.ledPin) due(lastBlink, component.blinkSpeed);
+    if (stepperPresent && (rotationMode == 1 || rotationMode == 2 || rotationMode == 3)) due(lastStepMs, stepIntervalMs());
+    if (sensorPresent) due(lastUpdate, component.speed);
+    return wait;
+}
+
+const char* radarShapeName(uint8_t shape) {
+    switch (shape) {
+        case RADAR_SHAPE_POINT: return "point";
+        case RADAR_SHAPE_ROUND: return "round";
+        case RADAR_SHAPE_FLAT: return "flat";
+        default: return "unknown";
+    }
+}
+
+void PayloadTraits<RadarSample>::toJson(const RadarSample& s, JsonObject out) {
+    out["d"] = s.d;
+    out["v"] = s.v;
+    out["dir"] = s.dir;
+    out["type"] = s.type;
+    out["ang"] = s.ang;
+    out["vx"] = s.vx;
+    out["vy"] = s.vy;
+    out["ms"] = s.ms;
+    out["size"] = s.size;
+    out["shape"] = radarShapeName(s.shape);
+    out["avg_rps"] = s.avgRps;
+}
+
+bool PayloadTraits<RadarSample>::fromJson(JsonVariantConst in, RadarSample& s) {
+    s.d = in["d"] | -1;
+    s.v = in["v"] | 0.0f;
+    s.dir = in["dir"] | 0;
+    s.type = in["type"] | 0;
+    s.ang = in["ang"] | 0;
+    s.vx = in["vx"] | 0.0f;
+    s.vy = in["vy"] | 0.0f;
+    s.ms = in["ms"] | 0.0f;
+    s.size = in["size"] | 0.0f;
+    String shape = in["shape"] | "";
+    s.shape = RADAR_SHAPE_UNKNOWN;
+    for (uint8_t i = RADAR_SHAPE_POINT; i <= RADAR_SHAPE_FLAT; i++) {
+        if (shape == radarShapeName(i)) s.shape = i;
+    }
+    s.avgRps = in["avg_rps"] | 0.0f;
+    return true;
+}
+
 bool CONTROL_RADAR::test() {
     long d = measureDistance();
     return d >= 0;
 }
 
 DynamicJsonDocument CONTROL_RADAR::getStatus() {
-    DynamicJsonDocument doc(512);
+    DynamicJsonDocument doc(1024);
     doc["module"] = moduleName;
     doc["state"] = state == MODULE_ENABLED ? "enabled" : "disabled";
     doc["distance_cm"] = getDistance();
@@ -198,10 +291,19 @@ DynamicJsonDocument CONTROL_RADAR::getStatus() {
     doc["direction"] = movementDir;
     doc["angle_deg"] = (int)angleDeg;
     doc["type"] = component.type;
+    if (echoStreaming) {
+        JsonObject es = doc.createNestedObject("echo_stream");
+        es["capacity"] = echoStream.capacity();
+        es["pending"] = echoStream.size();
+        es["edges"] = echoStream.pushed();
+        es["overruns"] = echoStream.overruns();
+    }
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
 bool CONTROL_RADAR::loadConfig(DynamicJsonDocument& doc) {
+    Module::loadConfig(doc);
     if (doc.containsKey("CONTROL_RADAR")) {
         JsonObject cfg = doc["CONTROL_RADAR"];
         component.enabled = cfg["enabled"] | false;
@@ -277,7 +379,60 @@ long CONTROL_RADAR::measureDistance() {
 }
 
 long CONTROL_RADAR::getDistance() {
-    return measureDistance();
+    // While streaming, a blocking pulseIn() would race the ISR for the same edges
+    return echoStreaming ? lastDistance : measureDistance();
+}
+
+void IRAM_ATTR CONTROL_RADAR::onEchoEdge(void* arg) {
+    CONTROL_RADAR* self = static_cast<CONTROL_RADAR*>(arg);
+    RadarEchoEdge e;
+    e.us = (uint32_t)esp_timer_get_time();
+    e.level = (uint8_t)digitalRead(self->component.echoPin);
+    self->echoStream.push(e);
+    // A falling edge completes a pulse; wake the task only then
+    if (!e.level) self->notifyWorkFromISR();
+}
+
+void CONTROL_RADAR::startEchoStream() {
+    if (echoStreaming || !queueCfg.allowISR || !sensorPresent) return;
+    echoRiseSeen = false;
+    attachInterruptArg(digitalPinToInterrupt(component.echoPin), onEchoEdge, this, CHANGE);
+    echoStreaming = true;
+    log("Echo capture via ISR stream");
+}
+
+void CONTROL_RADAR::stopEchoStream() {
+    if (!echoStreaming) return;
+    detachInterrupt(digitalPinToInterrupt(component.echoPin));
+    echoStreaming = false;
+}
+
+void CONTROL_RADAR::triggerPing() {
+    digitalWrite(component.trigPin, LOW);
+    delayMicroseconds(2);
+    digitalWrite(component.trigPin, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(component.trigPin, LOW);
+}
+
+long CONTROL_RADAR::takeEchoDistance() {
+    RadarEchoEdge edges[16];
+    long distance = -1;
+    size_t n;
+    while ((n = echoStream.pop(edges, 16)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (edges[i].level) {
+                echoRiseUs = edges[i].us;
+                echoRiseSeen = true;
+            } else if (echoRiseSeen) {
+                uint32_t duration = edges[i].us - echoRiseUs;
+                // Same 30 ms window measureDistance() gives pulseIn()
+                if (duration <= 30000) distance = (long)(duration / 58);
+                echoRiseSeen = false;
+            }
+        }
+    }
+    return distance;
 }
 
 bool CONTROL_RADAR::setComponent(uint8_t type, uint8_t trig, uint8_t echo, uint8_t led) {
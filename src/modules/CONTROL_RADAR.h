@@ -10,12 +10,18 @@
 #define CONTROL_RADAR_H
 
 #include "../ModuleManager.h"
+#include "../../include/TypedPayload.h"
+#include "../../include/SpscRing.h"
+#include "../../include/PeriodMonitor.h"
 
 // Radar types
 #define RADAR_TYPE_MBT1 1
 #define RADAR_TYPE_DIYW1 2
 #define RADAR_TYPE_NONE 0
 
+// EventBus topic carrying one RadarSample per processed measurement
+#define RADAR_SAMPLE_TOPIC "radar/sample"
+
 /**
  * @struct RadarComponent
  * @brief Configuration and runtime parameters for radar hardware.
@@ -39,6 +45,46 @@ struct RadarComponent {
     bool enabled;
 };
 
+// Object shape classes estimated from distance spread
+enum RadarShape : uint8_t { RADAR_SHAPE_UNKNOWN = 0, RADAR_SHAPE_POINT, RADAR_SHAPE_ROUND, RADAR_SHAPE_FLAT };
+const char* radarShapeName(uint8_t shape);
+
+/**
+ * @struct RadarSample
+ * @brief One processed radar measurement, carried as a typed queue payload.
+ * @details Published on RADAR_SAMPLE_TOPIC and delivered to subscribers as
+ *          lcd_radar_update / web_radar_update without touching JSON;
+ *          PayloadTraits<RadarSample> converts at the serial/web edges.
+ */
+struct RadarSample {
+    int32_t d;
+    float v;
+    int8_t dir;
+    uint8_t type;
+    uint8_t shape;
+    int16_t ang;
+    float vx;
+    float vy;
+    float ms;
+    float size;
+    float avgRps;
+};
+
+/**
+ * @struct RadarEchoEdge
+ * @brief One echo pin transition captured by the edge ISR.
+ */
+struct RadarEchoEdge {
+    uint32_t us;
+    uint8_t level;
+};
+
+template <>
+struct PayloadTraits<RadarSample> {
+    static void toJson(const RadarSample& s, JsonObject out);
+    static bool fromJson(JsonVariantConst in, RadarSample& s);
+};
+
 /**
  * @class CONTROL_RADAR
  * @brief Radar sensor and motor control for object detection and measurement.
@@ -50,6 +96,7 @@ struct RadarComponent {
  */
 class CONTROL_RADAR : public Module {
 private:
+    ModuleHandle<CONTROL_LCD> lcdHandle{"CONTROL_LCD"};
     RadarComponent component;
     bool radarInitialized;
     unsigned long lastUpdate;
@@ -82,7 +129,22 @@ private:
     float movementSpeedAbs;
     float avgRPS;
     float sizeEstimate;
-    String shapeClass;
+    uint8_t shapeClass;
+    // Echo edges from the ISR when freertos.queue.allow_isr is set; replaces pulseIn()
+    SpscRing<RadarEchoEdge, 64> echoStream;
+    bool echoStreaming;
+    uint32_t echoRiseUs;
+    bool echoRiseSeen;
+    // Actual cadence of sampling (component.speed) and stepping (stepIntervalMs)
+    PeriodicActivity sampleActivity;
+    PeriodicActivity stepActivity;
+    VarId distanceVar;  // CONTROL_RADAR.distance_cm, last processed distance
+    static void onEchoEdge(void* arg);
+    void startEchoStream();
+    void stopEchoStream();
+    void triggerPing();
+    long takeEchoDistance();
+    void processDistance(long d, unsigned long now);
     void probeHardware();
     
     void setupPins();
@@ -93,6 +155,7 @@ private:
     void setMeasureMode(int mode);
     void blinkSignal(int count);
     void stepMotorOnce();
+    unsigned long stepIntervalMs() const;
     void releaseStepper();
     bool isObjectDetected(long threshold = 100);
     
@@ -105,6 +168,8 @@ public:
     bool start() override;
     bool stop() override;
     bool update() override;
+    uint32_t nextDeadlineMs() override;
+    bool hasPendingInput() override { return echoStreaming && !echoStream.empty(); }
     bool test() override;
     DynamicJsonDocument getStatus() override;
     
@@ -4,12 +4,17 @@
 #include "CONTROL_LCD.h"
 #include "CONTROL_RADAR.h"
 #include "../../include/ModuleRegistry.h"
+#include "../../include/WorkerPool.h"
+#include "../../include/PeriodMonitor.h"
+#include "../../include/Trace.h"
 #include <WiFi.h>
 #include <esp_system.h>
 
 CONTROL_SERIAL::CONTROL_SERIAL() : Module("CONTROL_SERIAL") {
     bufferIndex = 0;
     serialInitialized = false;
+    topActive = false;
+    topNextMs = 0;
     memset(inputBuffer, 0, SERIAL_BUFFER_SIZE);
     priority = 80;
     autoStart = true;
@@ -69,9 +74,54 @@ bool CONTROL_SERIAL::update() {
     if (state != MODULE_ENABLED) return true;
     
     processSerial();
+    pollCalls();
+    if (topActive && (long)(millis() - topNextMs) >= 0) {
+        printTop();
+        topNextMs = millis() + SERIAL_TOP_INTERVAL_MS;
+    }
     return true;
 }
 
+void CONTROL_SERIAL::printTop() {
+    Serial.print("\033[2J\033[H");  // clear screen, cursor home
+    Serial.println("========== CPU (any key to stop) ==========");
+    Serial.println("module             busy%   update avg/max us   msg avg/max us   call avg/max us");
+    for (Module* mod : ModuleManager::getInstance()->getModules()) {
+        DynamicJsonDocument doc(768);
+        mod->cpuToJson(doc.to<JsonObject>());
+        Serial.printf("%-18s %5.2f   %7u/%8u   %6u/%8u   %6u/%8u\n", mod->getName().c_str(), doc["busy_pct"].as<float>(),
+                      doc["update"]["avg_us"].as<unsigned>(), doc["update"]["max_us"].as<unsigned>(),
+                      doc["message"]["avg_us"].as<unsigned>(), doc["message"]["max_us"].as<unsigned>(),
+                      doc["call"]["avg_us"].as<unsigned>(), doc["call"]["max_us"].as<unsigned>());
+    }
+    DynamicJsonDocument doc(4096);
+    cpuMonitor.sample(doc.to<JsonObject>());
+    if (!doc["supported"].as<bool>()) {
+        Serial.println("FreeRTOS trace facility disabled: no per-task view");
+        return;
+    }
+    if (!doc["run_time_stats"].as<bool>()) Serial.println("FreeRTOS run-time stats disabled: no task loads");
+    for (JsonObject c : doc["cores"].as<JsonArray>()) {
+        if (c.containsKey("load_pct")) Serial.printf("core %d: %5.1f%% busy\n", c["core"].as<int>(), c["load_pct"].as<float>());
+    }
+    Serial.println("task               core prio stack_free  load%");
+    for (JsonObject t : doc["tasks"].as<JsonArray>()) {
+        Serial.printf("%-18s %4d %4u %10u  %5.1f\n", t["name"].as<const char*>(), t["core"] | -1, t["priority"].as<unsigned>(),
+                      t["stack_free"].as<unsigned>(), t["load_pct"] | 0.0f);
+    }
+}
+
+void CONTROL_SERIAL::pollCalls() {
+    for (size_t i = 0; i < pendingCalls.size();) {
+        String result;
+        RpcStatus st = ModuleRegistry::getInstance()->rpc().poll(pendingCalls[i].handle, &result);
+        if (st == RPC_PENDING) { i++; continue; }
+        if (st == RPC_OK) Serial.println("CALL OK " + pendingCalls[i].label + ": " + result);
+        else Serial.println("CALL FAIL " + pendingCalls[i].label + " (" + rpcStatusName(st) + ")");
+        pendingCalls.erase(pendingCalls.begin() + i);
+    }
+}
+
 bool CONTROL_SERIAL::test() {
     log("Testing serial control...");
     
@@ -86,7 +136,7 @@ bool CONTROL_SERIAL::test() {
 }
 
 DynamicJsonDocument CONTROL_SERIAL::getStatus() {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1536);
     
     doc["module"] = moduleName;
     doc["state"] = state == MODULE_ENABLED ? "enabled" : "disabled";
@@ -95,13 +145,21 @@ DynamicJsonDocument CONTROL_SERIAL::getStatus() {
     doc["autoStart"] = autoStart;
     doc["debug"] = debugEnabled;
     doc["initialized"] = serialInitialized;
+    doc["pending_calls"] = pendingCalls.size();
     
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
 void CONTROL_SERIAL::processSerial() {
     while (Serial.available() > 0) {
         char c = Serial.read();
+        if (topActive) {
+            topActive = false;
+            Serial.println("\nCPU view stopped");
+            printPrompt();
+            continue;
+        }
         
         if (c == '\n' || c == '\r') {
             if (bufferIndex > 0) {
@@ -242,9 +300,8 @@ void CONTROL_SERIAL::processCommand(const String& command) {
             String value = command.substring(sp3 + 1);
             
             if (checkSafetyLimits(moduleName, "config_set", key + "=" + value)) {
-                Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-                if (fsModule) {
-                    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+                CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+                if (fs) {
                     ConfigManager* cfg = fs->getConfigManager();
                     if (cfg && cfg->getConfiguration()) {
                         DynamicJsonDocument& doc = *cfg->getConfiguration();
@@ -278,9 +335,8 @@ void CONTROL_SERIAL::processCommand(const String& command) {
             String jsonStr = command.substring(sp2 + 1);
             
             if (checkSafetyLimits(moduleName, "config_setjson", jsonStr)) {
-                Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-                if (fsModule) {
-                    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+                CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+                if (fs) {
                     ConfigManager* cfg = fs->getConfigManager();
                     if (cfg && cfg->getConfiguration()) {
                         DynamicJsonDocument& doc = *cfg->getConfiguration();
@@ -413,8 +469,19 @@ void CONTROL_SERIAL::processCommand(const String& command) {
                 } else {
                     Serial.println("Usage: func register name <module> <function>");
                 }
+            } else if (rest.startsWith("eval ")) {
+                int sp1 = rest.indexOf(' ');
+                int sp2 = rest.indexOf(' ', sp1 + 1);
+                int sp3 = sp2 > sp1 ? rest.indexOf(' ', sp2 + 1) : -1;
+                if (sp1 > 0 && sp2 > sp1 && sp3 > sp2) {
+                    String moduleName = rest.substring(sp1 + 1, sp2);
+                    String functionName = rest.substring(sp2 + 1, sp3);
+                    cmdFunctionRegisterEval(moduleName, functionName, rest.substring(sp3 + 1));
+                } else {
+                    Serial.println("Usage: func register eval <module> <function> <code>");
+                }
             } else {
-                Serial.println("Only 'name' type registration supported");
+                Serial.println("Usage: func register name|eval <module> <function> [code]");
             }
         } else if (fargs.startsWith("remove ")) {
             int sp = fargs.indexOf(' ');
@@ -427,7 +494,7 @@ void CONTROL_SERIAL::processCommand(const String& command) {
                 Serial.println("Usage: func remove <module> <function>");
             }
         } else {
-            Serial.println("Usage: func list <module> | func call <module> <function> [json] | func register name <module> <function> | func remove <module> <function>");
+            Serial.println("Usage: func list <module> | func call <module> <function> [json] | func register name|eval <module> <function> [code] | func remove <module> <function>");
         }
     }
     else if (cmd.startsWith("lcd brightness ")) {
@@ -437,9 +504,9 @@ void CONTROL_SERIAL::processCommand(const String& command) {
             Serial.println("Error: Brightness must be 0-255");
             return;
         }
-        Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
+        CONTROL_LCD* lcdMod = lcdHandle.get();
         if (lcdMod) { 
-            static_cast<CONTROL_LCD*>(lcdMod)->setBrightness((uint8_t)val); 
+            lcdMod->setBrightness((uint8_t)val); 
             Serial.println("LCD brightness updated"); 
         }
         else Serial.println("LCD module not available");
@@ -451,9 +518,9 @@ void CONTROL_SERIAL::processCommand(const String& command) {
             Serial.println("Error: Rotation must be 0-3");
             return;
         }
-        Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
+        CONTROL_LCD* lcdMod = lcdHandle.get();
         if (lcdMod) { 
-            static_cast<CONTROL_LCD*>(lcdMod)->setRotation((uint8_t)val); 
+            lcdMod->setRotation((uint8_t)val); 
             Serial.println("LCD rotation updated"); 
         }
         else Serial.println("LCD module not available");
@@ -468,9 +535,9 @@ void CONTROL_SERIAL::processCommand(const String& command) {
             else if (modeStr == "auto") mode = 3; 
             else mode = 0;
             
-            Module* r = ModuleManager::getInstance()->getModule("CONTROL_RADAR");
+            CONTROL_RADAR* r = radarHandle.get();
             if (r) { 
-                static_cast<CONTROL_RADAR*>(r)->setRotationModePublic(mode); 
+                r->setRotationModePublic(mode); 
                 Serial.println("RADAR rotation mode updated"); 
             }
             else Serial.println("RADAR module not available");
@@ -478,9 +545,9 @@ void CONTROL_SERIAL::processCommand(const String& command) {
         else if (cmd.startsWith("radar measure ")) {
             String m = command.substring(13);
             int mode = (m == "movement") ? 1 : 0;
-            Module* r = ModuleManager::getInstance()->getModule("CONTROL_RADAR");
+            CONTROL_RADAR* r = radarHandle.get();
             if (r) { 
-                static_cast<CONTROL_RADAR*>(r)->setMeasureModePublic(mode); 
+                r->setMeasureModePublic(mode); 
                 Serial.println("RADAR measure mode updated"); 
             }
             else Serial.println("RADAR module not available");
@@ -502,9 +569,9 @@ void CONTROL_SERIAL::processCommand(const String& command) {
                 if (comma < 0) break; 
                 start = comma + 1;
             }
-            Module* r = ModuleManager::getInstance()->getModule("CONTROL_RADAR");
+            CONTROL_RADAR* r = radarHandle.get();
             if (r && idx == 4) { 
-                static_cast<CONTROL_RADAR*>(r)->setStepperULN2003((uint8_t)a[0],(uint8_t)a[1],(uint8_t)a[2],(uint8_t)a[3]); 
+                r->setStepperULN2003((uint8_t)a[0],(uint8_t)a[1],(uint8_t)a[2],(uint8_t)a[3]); 
                 Serial.println("RADAR ULN2003 pins set"); 
             }
             else Serial.println("RADAR module not available or args error");
@@ -589,7 +656,7 @@ void CONTROL_SERIAL::cmdStatus() {
 void CONTROL_SERIAL::cmdModules() {
     Serial.println("\n========== Modules ==========");
     
-    auto modules = ModuleManager::getInstance()->getModules();
+    const auto& modules = ModuleManager::getInstance()->getModules();
     for (Module* mod : modules) {
         Serial.print(mod->getName());
         Serial.print(" - ");
@@ -669,14 +736,12 @@ void CONTROL_SERIAL::cmdModuleConfig(const String& moduleName) {
 }
 
 void CONTROL_SERIAL::cmdLogs(int lines) {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
     
-    if (!fsModule) {
+    if (!fs) {
         Serial.println("FS module not available");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     if (lines > 200) { Serial.println("Warning: Line count capped at 200"); lines = 200; }
     String logs = fs->readLogs(lines);
     
@@ -686,14 +751,12 @@ void CONTROL_SERIAL::cmdLogs(int lines) {
 }
 
 void CONTROL_SERIAL::cmdClearLogs() {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
     
-    if (!fsModule) {
+    if (!fs) {
         Serial.println("FS module not available");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     if (fs->clearLogs()) {
         Serial.println("Logs cleared successfully");
     } else {
@@ -794,6 +857,14 @@ void CONTROL_SERIAL::cmdHelpDetailed(const String& command) {
         Serial.println("Subcommands:");
         Serial.println("- system info - Show detailed system information");
         Serial.println("- system stats - Show performance statistics");
+        Serial.println("- system latency - Queue wait / handler time percentiles per call");
+        Serial.println("- system top - Live CPU time per module, task and core");
+        Serial.println("- system stacks [save] - Task stack sizes and peaks; save writes the profile");
+        Serial.println("- system cores [save] - Load-balanced core plan; save applies it on next boot");
+        Serial.println("- system periodic [reset] - Jitter and deadline misses of periodic activities");
+        Serial.println("- system vars - Shared variables published by modules");
+        Serial.println("- system boot - Boot time per phase, critical path and per-module timings");
+        Serial.println("- system trace [clear] - Dump the timeline as Chrome trace JSON; clear empties it");
         Serial.println("- system reset - Reset to factory defaults");
         Serial.println("- system update - Check for system updates");
     }
@@ -833,12 +904,14 @@ void CONTROL_SERIAL::cmdHelpDetailed(const String& command) {
         Serial.println("- func list <module>");
         Serial.println("- func call <module> <function> [json]");
         Serial.println("- func register name <module> <function>");
+        Serial.println("- func register eval <module> <function> <code>");
         Serial.println("- func remove <module> <function>");
         Serial.println("");
         Serial.println("Examples:");
         Serial.println("- func list CONTROL_LCD");
         Serial.println("- func call CONTROL_LCD lcd_text {\"x\":10,\"y\":20,\"text\":\"Hello\"}");
         Serial.println("- func register name CONTROL_LCD lcd_text");
+        Serial.println("- func register eval CONTROL_RADAR too_close return $distance_cm < $limit");
         Serial.println("- func remove CONTROL_LCD lcd_text");
         Serial.println("");
         Serial.println("Notes:");
@@ -891,9 +964,8 @@ void CONTROL_SERIAL::cmdConfig(const String& args) {
         cmdModuleConfig(moduleName);
     }
     else if (configCmd == "backup") {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (fsModule) {
-            CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (fs) {
             ConfigManager* configMgr = fs->getConfigManager();
             if (configMgr) {
                 if (configMgr->createBackup("manual_backup")) {
@@ -916,9 +988,8 @@ void CONTROL_SERIAL::cmdConfig(const String& args) {
         Serial.println("Restore functionality not yet implemented");
     }
     else if (configCmd == "validate") {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (fsModule) {
-            CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (fs) {
             ConfigManager* configMgr = fs->getConfigManager();
             if (configMgr) {
                 DynamicJsonDocument* cfgDoc = configMgr->getConfiguration();
@@ -937,9 +1008,8 @@ void CONTROL_SERIAL::cmdConfig(const String& args) {
         }
     }
     else if (configCmd == "schema") {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (!fsModule) { Serial.println("FS module not available"); return; }
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (!fs) { Serial.println("FS module not available"); return; }
         String schema = fs->readFile("/schema.json");
         if (schema.length() == 0) { Serial.println("No schema found"); }
         else { Serial.println(schema); }
@@ -966,10 +1036,19 @@ void CONTROL_SERIAL::cmdFunctionList(const String& moduleName) {
 void CONTROL_SERIAL::cmdFunctionRegisterName(const String& moduleName, const String& functionName) {
     Module* mod = ModuleManager::getInstance()->getModule(moduleName);
     if (!mod) { Serial.println("Module not found: " + moduleName); return; }
-    bool ok = ModuleRegistry::getInstance()->registerFunctionName(moduleName, functionName, functionName);
+    bool ok = ModuleRegistry::getInstance()->registerFunctionName(moduleName, functionName, functionName).valid();
     Serial.println(ok ? "Registered" : "Register failed");
 }
 
+void CONTROL_SERIAL::cmdFunctionRegisterEval(const String& moduleName, const String& functionName, const String& code) {
+    Module* mod = ModuleManager::getInstance()->getModule(moduleName);
+    if (!mod) { Serial.println("Module not found: " + moduleName); return; }
+    String err;
+    bool ok = ModuleRegistry::getInstance()->registerFunctionEval(moduleName, functionName, code, &err).valid();
+    if (ok) Serial.println("Registered");
+    else Serial.println("Register failed" + (err.length() ? ": " + err : String()));
+}
+
 void CONTROL_SERIAL::cmdFunctionRemove(const String& moduleName, const String& functionName) {
     bool ok = ModuleRegistry::getInstance()->unregisterFunction(moduleName, functionName);
     Serial.println(ok ? "Removed" : "Remove failed");
@@ -984,9 +1063,18 @@ void CONTROL_SERIAL::cmdFunctionCall(const String& moduleName, const String& fun
             return;
         }
     }
-    String result;
-    bool ok = ModuleRegistry::getInstance()->callFunction(moduleName, functionName, &params, result);
-    Serial.println(ok ? String("CALL OK: ") + result : String("CALL FAIL"));
+    if (pendingCalls.size() >= SERIAL_MAX_PENDING_CALLS) {
+        Serial.println("CALL FAIL: too many calls in flight");
+        return;
+    }
+    // Runs on the target's task; the result is printed by pollCalls() once it arrives
+    RpcHandle h = ModuleRegistry::getInstance()->rpc().call(moduleName, functionName, &params, RPC_DEFAULT_TIMEOUT_MS, this);
+    if (!h.valid()) {
+        Serial.println("CALL FAIL: could not queue call");
+        return;
+    }
+    pendingCalls.push_back(PendingCall{h, moduleName + ":" + functionName});
+    pollCalls();
 }
 
 void CONTROL_SERIAL::cmdSystem(const String& args) {
@@ -1010,9 +1098,8 @@ void CONTROL_SERIAL::cmdSystem(const String& args) {
         Serial.print("  Largest Free Block: "); Serial.print(ESP.getMaxAllocHeap()); Serial.println(" bytes");
         
         Serial.println("\nNetwork:");
-        Module* wifiModule = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
-        if (wifiModule && wifiModule->getState() == MODULE_ENABLED) {
-            CONTROL_WIFI* wifi = static_cast<CONTROL_WIFI*>(wifiModule);
+        CONTROL_WIFI* wifi = wifiHandle.get();
+        if (wifi && wifi->getState() == MODULE_ENABLED) {
             Serial.print("  WiFi SSID: "); Serial.println(wifi->getSSID());
             Serial.print("  IP Address: "); Serial.println(wifi->getIP());
             Serial.print("  MAC Address: "); Serial.println(WiFi.macAddress());
@@ -1022,9 +1109,8 @@ void CONTROL_SERIAL::cmdSystem(const String& args) {
         }
         
         Serial.println("\nFilesystem:");
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (fsModule && fsModule->getState() == MODULE_ENABLED) {
-            CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (fs && fs->getState() == MODULE_ENABLED) {
             Serial.print("  Total Space: "); Serial.print(fs->getTotalSpace()); Serial.println(" bytes");
             Serial.print("  Used Space: "); Serial.print(fs->getUsedSpace()); Serial.println(" bytes");
             Serial.print("  Free Space: "); Serial.print(fs->getFreeSpace()); Serial.println(" bytes");
@@ -1056,7 +1142,7 @@ void CONTROL_SERIAL::cmdSystem(const String& args) {
         Serial.print("Reset Reason: "); Serial.println(rrStr);
         
         // Module statistics
-        auto modules = ModuleManager::getInstance()->getModules();
+        const auto& modules = ModuleManager::getInstance()->getModules();
         Serial.print("Total Modules: "); Serial.println(modules.size());
         
         int enabledCount = 0;
@@ -1074,9 +1160,177 @@ void CONTROL_SERIAL::cmdSystem(const String& args) {
         Serial.print("  Enabled: "); Serial.println(enabledCount);
         Serial.print("  Disabled: "); Serial.println(disabledCount);
         Serial.print("  Error: "); Serial.println(errorCount);
+
+        // Event bus topics
+        DynamicJsonDocument busDoc(1024);
+        ModuleRegistry::getInstance()->bus().toJson(busDoc.to<JsonObject>());
+        Serial.println("Event Bus:");
+        for (JsonObject t : busDoc["topics"].as<JsonArray>()) {
+            Serial.printf("  %-16s subs=%u published=%u delivered=%u dropped=%u\n",
+                          t["topic"].as<const char*>(), t["subscribers"].as<unsigned>(), t["published"].as<unsigned>(),
+                          t["delivered"].as<unsigned>(), t["dropped"].as<unsigned>());
+        }
+        Serial.print("  Payload slots free: "); Serial.print(busDoc["payload_free"].as<unsigned>());
+        Serial.print("/"); Serial.println(busDoc["payload_slots"].as<unsigned>());
+
+        // Shared worker pool
+        if (WorkerPool::global().isRunning()) {
+            DynamicJsonDocument poolDoc(1024);
+            WorkerPool::global().toJson(poolDoc.to<JsonObject>());
+            Serial.print("Worker Pool: submitted="); Serial.print(poolDoc["submitted"].as<unsigned>());
+            Serial.print(" rejected="); Serial.println(poolDoc["rejected"].as<unsigned>());
+            for (JsonObject w : poolDoc["workers"].as<JsonArray>()) {
+                Serial.printf("  core %u: queued=%u executed=%u stolen=%u busy=%llums\n", w["core"].as<unsigned>(),
+                              w["queued"].as<unsigned>(), w["executed"].as<unsigned>(), w["stolen"].as<unsigned>(),
+                              w["busy_us"].as<unsigned long long>() / 1000);
+            }
+            Serial.print("  Modules:");
+            for (JsonVariant m : poolDoc["modules"].as<JsonArray>()) { Serial.print(" "); Serial.print(m.as<const char*>()); }
+            Serial.println();
+        }
+
+        // Task-less modules sharing loop()
+        DynamicJsonDocument schedDoc(1024);
+        ModuleManager::getInstance()->getScheduler().toJson(schedDoc.to<JsonArray>());
+        if (schedDoc.size() > 0) {
+            Serial.println("Loop Scheduler:");
+            for (JsonObject e : schedDoc.as<JsonArray>()) {
+                Serial.printf("  %-16s period=%dms runs=%u overruns=%u late p95=%uus max=%uus run max=%uus\n",
+                              e["module"].as<const char*>(), e["period_ms"].isNull() ? -1 : e["period_ms"].as<int>(),
+                              e["runs"].as<unsigned>(), e["overruns"].as<unsigned>(), e["late_us"]["p95"].as<unsigned>(),
+                              e["late_us"]["max"].as<unsigned>(), e["max_run_us"].as<unsigned>());
+            }
+        }
         
         Serial.println("============================================");
     }
+    else if (systemCmd == "latency") {
+        Serial.println("\n========== Message Latency (us) ==========");
+        Serial.println("queue/call                         wait p50/p95/p99/max     handler p50/p95/p99/max");
+        for (Module* mod : ModuleManager::getInstance()->getModules()) {
+            QueueBase* q = mod->getQueue();
+            if (!q) continue;
+            DynamicJsonDocument doc(2048);
+            q->latencyToJson(doc.to<JsonArray>());
+            for (JsonObject e : doc.as<JsonArray>()) {
+                String label = mod->getName() + "/" + e["call"].as<String>();
+                JsonObject w = e["wait_us"];
+                JsonObject h = e["handler_us"];
+                Serial.printf("%-34s %5u/%5u/%5u/%6u   %5u/%5u/%5u/%6u  n=%u\n", label.c_str(),
+                              w["p50"].as<unsigned>(), w["p95"].as<unsigned>(), w["p99"].as<unsigned>(), w["max"].as<unsigned>(),
+                              h["p50"].as<unsigned>(), h["p95"].as<unsigned>(), h["p99"].as<unsigned>(), h["max"].as<unsigned>(),
+                              w["count"].as<unsigned>());
+            }
+        }
+        Serial.println("===========================================");
+    }
+    else if (systemCmd == "stacks" || systemCmd == "stacks save") {
+        StackProfiler& sp = ModuleManager::getInstance()->getStackProfiler();
+        DynamicJsonDocument doc(2048);
+        sp.toJson(doc.to<JsonObject>());
+        Serial.println("\n========== Task Stacks (bytes) ==========");
+        Serial.println("task                    configured  sized  profile  peak   peak%");
+        for (JsonObject t : doc["tasks"].as<JsonArray>()) {
+            Serial.printf("%-22s %10u %6u %8u %5u %6.1f%s\n", t["task"].as<const char*>(), t["configured"].as<unsigned>(),
+                          t["sized"].as<unsigned>(), t["profile_peak"].as<unsigned>(), t["peak"].as<unsigned>(),
+                          t["peak_pct"] | 0.0f, t["warned"] ? "  WARN" : (t["floored"] ? "  floor" : ""));
+        }
+        Serial.print("Reclaimed: "); Serial.print(doc["reclaimed_bytes"].as<int>()); Serial.println(" bytes");
+        Serial.print("Recording: "); Serial.println(doc["record"].as<bool>() ? "on" : "off");
+        if (systemCmd == "stacks save") Serial.println(sp.save() ? "Profile saved to " STACK_PROFILE_PATH : "Profile save failed");
+    }
+    else if (systemCmd == "cores" || systemCmd == "cores save") {
+        ModuleManager* mm = ModuleManager::getInstance();
+        DynamicJsonDocument doc(3072);
+        mm->getCorePlanner().plan(mm->getModules(), doc.to<JsonObject>());
+        Serial.println("\n========== Core Affinity Plan ==========");
+        Serial.println("task                   load%  core -> proposed");
+        for (JsonObject t : doc["tasks"].as<JsonArray>()) {
+            Serial.printf("%-22s %5.1f  %4d -> %d%s\n", t["task"].as<const char*>(), t["load_pct"].as<float>(),
+                          t["core"].as<int>(), t["proposed"].as<int>(), t["pinned"] ? "  (pinned)" : "");
+        }
+        JsonArray before = doc["before_pct"];
+        JsonArray after = doc["after_pct"];
+        for (size_t c = 0; c < before.size(); c++) {
+            Serial.printf("core %u: %5.1f%% -> %5.1f%%\n", (unsigned)c, before[c].as<float>(), after[c].as<float>());
+        }
+        if (!doc["base_measured"].as<bool>()) Serial.println("(run-time stats unavailable: non-module load not included)");
+        Serial.print("Moves: "); Serial.println(doc["moves"].as<unsigned>());
+        if (systemCmd == "cores save") {
+            String error;
+            if (mm->getCorePlanner().save(mm->getModules(), &error)) Serial.println("Plan saved to " CORE_PLAN_PATH ", applied on next boot");
+            else Serial.println("Plan not saved: " + error);
+        }
+    }
+    else if (systemCmd == "periodic" || systemCmd == "periodic reset") {
+        if (systemCmd == "periodic reset") {
+            PeriodMonitor::global().resetAll();
+            Serial.println("Periodic activity stats cleared");
+            return;
+        }
+        DynamicJsonDocument doc(4096);
+        JsonArray acts = doc.to<JsonArray>();
+        PeriodMonitor::global().toJson(acts);
+        Serial.println("\n========== Periodic Activities ==========");
+        Serial.println("activity                 period_us   ticks misses  late p50/p99/max us   early max us");
+        for (JsonObject a : acts) {
+            String label = a["module"].as<String>() + "." + a["name"].as<String>();
+            Serial.printf("%-24s %9u %7u %6u  %6u/%6u/%7u   %7u\n", label.c_str(), a["period_us"].as<unsigned>(),
+                          a["ticks"].as<unsigned>(), a["misses"].as<unsigned>(), a["late_us"]["p50"].as<unsigned>(),
+                          a["late_us"]["p99"].as<unsigned>(), a["late_us"]["max"].as<unsigned>(), a["early_us"]["max"].as<unsigned>());
+        }
+        if (acts.size() == 0) Serial.println("(no periodic activities registered)");
+    }
+    else if (systemCmd == "vars") {
+        DynamicJsonDocument doc(4096);
+        JsonArray vars = doc.to<JsonArray>();
+        ModuleRegistry::getInstance()->vars().toJson(vars);
+        Serial.println("\n========== Shared Variables ==========");
+        for (JsonObject v : vars) {
+            String value;
+            serializeJson(v["value"], value);
+            Serial.printf("%-34s %-6s %-16s v%u\n", (v["module"].as<String>() + "." + v["name"].as<String>()).c_str(),
+                          v["type"].as<const char*>(), value.c_str(), v["version"].as<unsigned>());
+        }
+    }
+    else if (systemCmd == "boot") {
+        DynamicJsonDocument doc(3072);
+        JsonObject boot = doc.to<JsonObject>();
+        ModuleManager::getInstance()->getBootGraph().toJson(boot);
+        Serial.println("\n========== Boot ==========");
+        Serial.printf("Total: %u ms\n", boot["boot_ms"].as<unsigned>());
+        for (JsonObject p : boot["phases"].as<JsonArray>()) {
+            String path;
+            for (JsonVariant n : p["critical_path"].as<JsonArray>()) path += (path.length() ? " > " : "") + n.as<String>();
+            Serial.printf("\n%s: %u ms (sequential %u ms, %u workers%s)\n", p["name"].as<const char*>(), p["total_ms"].as<unsigned>(),
+                          p["sequential_ms"].as<unsigned>(), p["workers"].as<unsigned>(), p["cycle"].as<bool>() ? ", cycle ignored" : "");
+            Serial.printf("  critical path %u ms: %s\n", p["critical_ms"].as<unsigned>(), path.c_str());
+            for (JsonObject m : p["modules"].as<JsonArray>()) {
+                Serial.printf("  %-16s +%5u ms %6u ms core %d %s\n", m["name"].as<const char*>(), m["start_ms"].as<unsigned>(),
+                              m["dur_ms"].as<unsigned>(), m["core"].as<int>(), m["skipped"].as<bool>() ? "skipped" : (m["ok"].as<bool>() ? "ok" : "FAILED"));
+            }
+        }
+    }
+    else if (systemCmd == "trace" || systemCmd == "trace clear") {
+#ifdef SYSTEM_TRACE
+        if (systemCmd == "trace clear") {
+            Trace::global().clear();
+            Serial.println("Trace cleared");
+            return;
+        }
+        // Paste into chrome://tracing or ui.perfetto.dev
+        Serial.println("\n========== Trace (Chrome JSON) ==========");
+        Trace::global().writeChromeJson(Serial);
+        Serial.println();
+        Serial.printf("%u events recorded, %u dropped\n", (unsigned)Trace::global().recorded(), (unsigned)Trace::global().dropped());
+#else
+        Serial.println("Tracing disabled, build with -DSYSTEM_TRACE (env esp32dev-trace)");
+#endif
+    }
+    else if (systemCmd == "top") {
+        topActive = true;
+        topNextMs = millis();
+    }
     else if (systemCmd == "reset") {
         Serial.println("System reset functionality not yet implemented");
     }
@@ -1084,23 +1338,22 @@ void CONTROL_SERIAL::cmdSystem(const String& args) {
         Serial.println("System update functionality not yet implemented");
     }
     else if (systemCmd == "fscheck") {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (!fsModule) { Serial.println("FS module not available"); return; }
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (!fs) { Serial.println("FS module not available"); return; }
         Serial.println("Running filesystem audit...");
         bool ok = fs->auditFileSystem(true);
         Serial.println(ok ? "FS audit passed" : "FS audit found issues");
     }
     else {
         Serial.println("Unknown system command: " + systemCmd);
-        Serial.println("Available: info, stats, reset, update, fscheck");
+        Serial.println("Available: info, stats, latency, top, stacks [save], cores [save], periodic [reset], vars, boot, trace [clear], reset, update, fscheck");
     }
 }
 
 void CONTROL_SERIAL::cmdModuleCommand(const String& moduleName, const String& command, const String& args) {
     // Route module-specific commands
     if (moduleName == "CONTROL_LCD") {
-        Module* lcdMod = ModuleManager::getInstance()->getModule("CONTROL_LCD");
+        CONTROL_LCD* lcdMod = lcdHandle.get();
         if (!lcdMod) {
             Serial.println("LCD module not available");
             return;
@@ -1112,7 +1365,7 @@ void CONTROL_SERIAL::cmdModuleCommand(const String& moduleName, const String& co
                 Serial.println("Error: Brightness must be 0-255");
                 return;
             }
-            static_cast<CONTROL_LCD*>(lcdMod)->setBrightness((uint8_t)brightness);
+            lcdMod->setBrightness((uint8_t)brightness);
             Serial.println("LCD brightness set to " + String(brightness));
         }
         else if (command == "rotation") {
@@ -1126,7 +1379,7 @@ void CONTROL_SERIAL::cmdModuleCommand(const String& moduleName, const String& co
                 Serial.println("Error: Rotation must be 0-3 or 0/90/180/270 degrees");
                 return;
             }
-            static_cast<CONTROL_LCD*>(lcdMod)->setRotation((uint8_t)mapped);
+            lcdMod->setRotation((uint8_t)mapped);
             Serial.println("LCD rotation set to " + String(mapped));
         }
         else {
@@ -1135,7 +1388,7 @@ void CONTROL_SERIAL::cmdModuleCommand(const String& moduleName, const String& co
         }
     }
     else if (moduleName == "CONTROL_RADAR") {
-        Module* radarMod = ModuleManager::getInstance()->getModule("CONTROL_RADAR");
+        CONTROL_RADAR* radarMod = radarHandle.get();
         if (!radarMod) {
             Serial.println("RADAR module not available");
             return;
@@ -1151,12 +1404,12 @@ void CONTROL_SERIAL::cmdModuleCommand(const String& moduleName, const String& co
                 Serial.println("Error: Mode must be slow, fast, auto, or off");
                 return;
             }
-            static_cast<CONTROL_RADAR*>(radarMod)->setRotationModePublic(mode);
+            radarMod->setRotationModePublic(mode);
             Serial.println("RADAR rotation mode set to " + args);
         }
         else if (command == "measure") {
             int mode = (args == "movement") ? 1 : 0;
-            static_cast<CONTROL_RADAR*>(radarMod)->setMeasureModePublic(mode);
+            radarMod->setMeasureModePublic(mode);
             Serial.println("RADAR measure mode set to " + args);
         }
         else {
@@ -1176,6 +1429,10 @@ void CONTROL_SERIAL::cmdRealTimeStatus() {
     
     unsigned long startTime = millis();
     int updateCount = 0;
+    // WiFi publishes its state and RSSI to the VarStore; resolved once, read without locks
+    VarStore& vars = ModuleRegistry::getInstance()->vars();
+    VarId wifiState = vars.find("CONTROL_WIFI", "state");
+    VarId wifiRssi = vars.find("CONTROL_WIFI", "rssi");
     
     while (Serial.available() == 0 && updateCount < 100) { // Limit to 100 updates or key press
         Serial.print("\r"); // Clear line
@@ -1185,7 +1442,7 @@ void CONTROL_SERIAL::cmdRealTimeStatus() {
         Serial.print("Free Heap: "); Serial.print(ESP.getFreeHeap()); Serial.print(" ");
         
         // Module status summary
-        auto modules = ModuleManager::getInstance()->getModules();
+        const auto& modules = ModuleManager::getInstance()->getModules();
         int enabledCount = 0;
         for (Module* mod : modules) {
             if (mod->getState() == MODULE_ENABLED) enabledCount++;
@@ -1193,10 +1450,8 @@ void CONTROL_SERIAL::cmdRealTimeStatus() {
         Serial.print("Modules: "); Serial.print(enabledCount); Serial.print("/"); Serial.print(modules.size());
         
         // WiFi status if available
-        Module* wifiModule = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
-        if (wifiModule && wifiModule->getState() == MODULE_ENABLED) {
-            CONTROL_WIFI* wifi = static_cast<CONTROL_WIFI*>(wifiModule);
-            Serial.print(" WiFi: "); Serial.print(wifi->getRSSI()); Serial.print("dBm");
+        if (vars.getInt(wifiState) == MODULE_ENABLED) {
+            Serial.print(" WiFi: "); Serial.print(vars.getInt(wifiRssi)); Serial.print("dBm");
         }
         
         updateCount++;
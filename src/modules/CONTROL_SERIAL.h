@@ -10,8 +10,17 @@
 #define CONTROL_SERIAL_H
 
 #include "../ModuleManager.h"
+#include "../../include/Rpc.h"
+#include "../../include/CpuMonitor.h"
 
 #define SERIAL_BUFFER_SIZE 256
+// Outstanding "func call" requests; further calls are refused until one finishes
+#define SERIAL_MAX_PENDING_CALLS 4
+// Refresh period of the "system top" live view
+#define SERIAL_TOP_INTERVAL_MS 1000
+
+class CONTROL_RADAR;
+class CONTROL_WIFI;
 
 /**
  * @class CONTROL_SERIAL
@@ -24,10 +33,26 @@
  */
 class CONTROL_SERIAL : public Module {
 private:
+    ModuleHandle<CONTROL_LCD> lcdHandle{"CONTROL_LCD"};
+    ModuleHandle<CONTROL_RADAR> radarHandle{"CONTROL_RADAR"};
+    ModuleHandle<CONTROL_WIFI> wifiHandle{"CONTROL_WIFI"};
     char inputBuffer[SERIAL_BUFFER_SIZE];
     int bufferIndex;
     bool serialInitialized;
+    struct PendingCall {
+        RpcHandle handle;
+        String label;
+    };
+    std::vector<PendingCall> pendingCalls;
+    // "system top" live view: redrawn from update() until a key is pressed
+    bool topActive;
+    unsigned long topNextMs;
+    CpuMonitor cpuMonitor;
     
+    /** @brief Print results of finished "func call" requests. */
+    void pollCalls();
+    /** @brief Redraw the per-module / per-task CPU view. */
+    void printTop();
     void processCommand(const String& command);
     void printHelp();
     void printPrompt();
@@ -57,6 +82,7 @@ private:
     void cmdFunctionList(const String& moduleName);
     void cmdFunctionCall(const String& moduleName, const String& functionName, const String& jsonArgs);
     void cmdFunctionRegisterName(const String& moduleName, const String& functionName);
+    void cmdFunctionRegisterEval(const String& moduleName, const String& functionName, const String& code);
     void cmdFunctionRemove(const String& moduleName, const String& functionName);
     
     /**
@@ -12,12 +12,19 @@
 #include "CONTROL_WIFI.h"
 #include "CONTROL_RADAR.h"
 #include "ConfigManager.h"
+#include "../../include/ModuleRegistry.h"
+#include "../../include/WorkerPool.h"
+#include "../../include/PeriodMonitor.h"
+#include "../../include/Trace.h"
 
 CONTROL_WEB::CONTROL_WEB() : Module("CONTROL_WEB") {
     server = nullptr;
     serverRunning = false;
     port = 80;
+    radarSnap = RadarSnapshot{-1, 0.0f, 0, 0, 0, false};
+    portMUX_INITIALIZE(&radarSnapLock);
     priority = 70;
+    dependsOn("CONTROL_WIFI");  // started once connected, stopped while disconnected
     autoStart = true;
     version = "1.0.0";
     setUseQueue(true);
@@ -43,7 +50,7 @@ bool CONTROL_WEB::init() {
     log("Initializing web server...");
     
     // Check if WiFi is available
-    Module* wifiModule = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
+    Module* wifiModule = wifiHandle.get();
     if (!wifiModule || wifiModule->getState() != MODULE_ENABLED) {
         log("WiFi module not available", "WARN");
         // Can still init, but won't be useful without WiFi
@@ -75,14 +82,15 @@ bool CONTROL_WEB::start() {
     
     server->begin();
     serverRunning = true;
+    // The queue is created after start(); the bus skips us until it exists
+    ModuleRegistry::getInstance()->bus().subscribe(RADAR_SAMPLE_TOPIC, this, "web_radar_update");
     
     setState(MODULE_ENABLED);
     log("Web server started");
     
     // Get IP from WiFi module
-    Module* wifiModule = ModuleManager::getInstance()->getModule("CONTROL_WIFI");
-    if (wifiModule) {
-        CONTROL_WIFI* wifi = static_cast<CONTROL_WIFI*>(wifiModule);
+    CONTROL_WIFI* wifi = wifiHandle.get();
+    if (wifi) {
         log("Server available at: http://" + wifi->getIP());
     }
     
@@ -95,6 +103,7 @@ bool CONTROL_WEB::stop() {
         server->end();
         serverRunning = false;
     }
+    ModuleRegistry::getInstance()->bus().unsubscribe(RADAR_SAMPLE_TOPIC, this);
     
     setState(MODULE_DISABLED);
     log("Web server stopped");
@@ -106,6 +115,25 @@ bool CONTROL_WEB::update() {
     return true;
 }
 
+uint32_t CONTROL_WEB::nextDeadlineMs() {
+    // Requests are served by AsyncTCP; the task only wakes for queued messages
+    return MODULE_WAIT_FOREVER;
+}
+
+void CONTROL_WEB::handleMessage(QueueMessage* msg) {
+    if (!msg) return;
+    if (msg->callId != SYMBOL_ID("web_radar_update")) {
+        Module::handleMessage(msg);
+        return;
+    }
+    const RadarSample* sample = queueMessagePayloadAs<RadarSample>(msg);
+    if (!sample) return;
+    RadarSnapshot s{sample->d, sample->v, sample->dir, sample->ang, sample->type, true};
+    portENTER_CRITICAL(&radarSnapLock);
+    radarSnap = s;
+    portEXIT_CRITICAL(&radarSnapLock);
+}
+
 bool CONTROL_WEB::test() {
     log("Testing web server...");
     
@@ -137,9 +165,8 @@ DynamicJsonDocument CONTROL_WEB::getStatus() {
     doc["port"] = port;
     
     // Add ConfigManager statistics if available
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (fsModule) {
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (fs) {
         ConfigManager* cfg = fs->getConfigManager();
         if (cfg) {
             JsonObject configStats = doc["config_manager"].to<JsonObject>();
@@ -152,6 +179,7 @@ DynamicJsonDocument CONTROL_WEB::getStatus() {
         }
     }
     
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
@@ -188,9 +216,8 @@ void CONTROL_WEB::setupRoutes() {
         content.reserve(4096);
         content = "<h1>Configuration Schema</h1>";
         content += "<a href='/' >Back to Home</a><hr>";
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (fsModule) {
-            CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (fs) {
             String schema = fs->readFile("/schema.json");
             if (schema.length() == 0) schema = "(no schema)";
             content += "<pre>" + schema + "</pre>";
@@ -244,6 +271,14 @@ void CONTROL_WEB::setupAPIRoutes() {
         this->handleAPIModuleCommand(request);
     });
     
+    // API Module function call: queued on the module's task, result fetched by id
+    server->on("/api/module/call", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPIModuleCall(request);
+    });
+    server->on("/api/module/result", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPIModuleResult(request);
+    });
+    
     // API Configuration management
     server->on("/api/config/backup", HTTP_GET, [this](AsyncWebServerRequest *request) {
         this->handleAPIConfigBackup(request);
@@ -262,9 +297,8 @@ void CONTROL_WEB::setupAPIRoutes() {
     });
     // API filesystem audit
     server->on("/api/fs/check", HTTP_POST, [this](AsyncWebServerRequest *request) {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (!fsModule) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (!fs) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
         bool fix = request->hasParam("fix") ? (request->getParam("fix")->value() == "1") : true;
         bool ok = fs->auditFileSystem(fix);
         request->send(200, "application/json", ok ? "{\"ok\":true}" : "{\"ok\":false}");
@@ -278,9 +312,8 @@ void CONTROL_WEB::setupAPIRoutes() {
     });
     // API Schema get/save
     server->on("/api/config/schema", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (!fsModule) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (!fs) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
         String schema = fs->readFile("/schema.json");
         if (schema.length() == 0) schema = "{}";
         request->send(200, "application/json", schema);
@@ -288,9 +321,8 @@ void CONTROL_WEB::setupAPIRoutes() {
     server->on("/api/config/schema", HTTP_POST, [this](AsyncWebServerRequest *request) {
         if (!request->hasParam("plain", true)) { request->send(400, "application/json", "{\"error\":\"No schema data provided\"}"); return; }
         String schemaData = request->getParam("plain", true)->value();
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (!fsModule) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (!fs) { request->send(503, "application/json", "{\"error\":\"FS module not available\"}"); return; }
         if (!fs->writeFile("/schema.json", schemaData)) { request->send(500, "application/json", "{\"error\":\"Failed to write schema\"}"); return; }
         ConfigManager* cfg = fs->getConfigManager();
         if (cfg) cfg->loadSchemaFromFile("/schema.json");
@@ -306,6 +338,31 @@ void CONTROL_WEB::setupAPIRoutes() {
         this->handleAPISystemStats(request);
     });
     
+    // API Core affinity plan from measured task load (?save=1 applies it on next boot)
+    server->on("/api/system/cores", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPISystemCores(request);
+    });
+    
+    // API Jitter and deadline misses of periodic activities (?reset=1 clears them)
+    server->on("/api/system/periodic", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPISystemPeriodic(request);
+    });
+    
+    // API Shared variables published by modules (VarStore)
+    server->on("/api/system/vars", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPISystemVars(request);
+    });
+    
+    // API Boot timing per phase (parallel init/start over the dependency graph)
+    server->on("/api/system/boot", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPISystemBoot(request);
+    });
+    
+    // API Boot/runtime timeline as Chrome trace JSON (builds with -DSYSTEM_TRACE)
+    server->on("/api/system/trace", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        this->handleAPISystemTrace(request);
+    });
+    
     // API Safety and limits
     server->on("/api/safety/limits", HTTP_GET, [this](AsyncWebServerRequest *request) {
         this->handleAPISafetyLimits(request);
@@ -392,16 +449,16 @@ void CONTROL_WEB::handleDisplay(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPIRadar(AsyncWebServerRequest *request) {
-    Module* radarModule = ModuleManager::getInstance()->getModule("CONTROL_RADAR");
     int d = -1; float v = 0.0f; int dir = 0; int ang = 0; int type = 0;
-    if (radarModule) {
-        CONTROL_RADAR* radar = static_cast<CONTROL_RADAR*>(radarModule);
-        DynamicJsonDocument status = radar->getStatus();
-        d = status["distance_cm"] | d;
-        v = status["speed_cms"] | v;
-        dir = status["direction"] | dir;
-        ang = status["angle_deg"] | ang;
-        type = status["type"] | type;
+    portENTER_CRITICAL(&radarSnapLock);
+    RadarSnapshot snap = radarSnap;
+    portEXIT_CRITICAL(&radarSnapLock);
+    if (snap.valid) {
+        d = snap.d; v = snap.v; dir = snap.dir; ang = snap.ang; type = snap.type;
+    } else {
+        // No sample delivered to us yet: the last distance the radar published
+        VarStore& vars = ModuleRegistry::getInstance()->vars();
+        d = vars.getInt(vars.find("CONTROL_RADAR", "distance_cm"), d);
     }
     DynamicJsonDocument doc(256);
     doc["d"] = d;
@@ -421,7 +478,7 @@ void CONTROL_WEB::handleControls(AsyncWebServerRequest *request) {
     
     // Module controls
     content += "<h2>Module Controls</h2>";
-    auto modules = ModuleManager::getInstance()->getModules();
+    const auto& modules = ModuleManager::getInstance()->getModules();
     
     for (Module* mod : modules) {
         content += "<div class='module-control'>";
@@ -561,9 +618,8 @@ void CONTROL_WEB::handleAPIModuleConfig(AsyncWebServerRequest *request) {
 
 void CONTROL_WEB::handleAPIModuleSet(AsyncWebServerRequest *request) {
     String moduleName = request->getParam("module")->value();
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (!fsModule) { request->send(503, "text/plain", "FS not available"); return; }
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (!fs) { request->send(503, "text/plain", "FS not available"); return; }
     ConfigManager* cfg = fs->getConfigManager();
     if (!cfg || !cfg->getConfiguration()) { request->send(500, "text/plain", "ConfigManager not ready"); return; }
     DynamicJsonDocument& doc = *cfg->getConfiguration();
@@ -599,10 +655,9 @@ void CONTROL_WEB::handleAPIModuleAutostart(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPILogs(AsyncWebServerRequest *request) {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
     
-    if (fsModule) {
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    if (fs) {
         String logs;
         if (request->hasParam("level") && request->getParam("level")->value() == "debug") {
             logs = fs->readFile("/logs/debug.log");
@@ -640,6 +695,64 @@ void CONTROL_WEB::handleAPITest(AsyncWebServerRequest *request) {
     request->send(200, "application/json", "{\"message\":\"Test endpoint\"}");
 }
 
+void CONTROL_WEB::handleAPIModuleCall(AsyncWebServerRequest *request) {
+    if (!request->hasParam("module") || !request->hasParam("fn")) {
+        request->send(400, "application/json", "{\"error\":\"Missing module or fn parameter\"}");
+        return;
+    }
+    String moduleName = request->getParam("module")->value();
+    String fn = request->getParam("fn")->value();
+    DynamicJsonDocument params(1024);
+    if (request->hasParam("args")) {
+        if (deserializeJson(params, request->getParam("args")->value()) != DeserializationError::Ok) {
+            request->send(400, "application/json", "{\"error\":\"Invalid args JSON\"}");
+            return;
+        }
+    }
+    uint32_t timeoutMs = request->hasParam("timeout_ms") ? request->getParam("timeout_ms")->value().toInt() : RPC_DEFAULT_TIMEOUT_MS;
+    // Returns at once; the AsyncTCP task never waits for the target module
+    RpcHandle h = ModuleRegistry::getInstance()->rpc().call(moduleName, fn, &params, timeoutMs, this);
+    if (!h.valid()) {
+        request->send(503, "application/json", "{\"error\":\"Call could not be queued\"}");
+        return;
+    }
+    DynamicJsonDocument response(128);
+    // 64-bit IDs do not survive a JavaScript number, so they travel as strings
+    char id[24];
+    snprintf(id, sizeof(id), "%llu", (unsigned long long)h.id);
+    response["id"] = id;
+    response["status"] = rpcStatusName(RPC_PENDING);
+    String out;
+    serializeJson(response, out);
+    request->send(202, "application/json", out);
+}
+
+void CONTROL_WEB::handleAPIModuleResult(AsyncWebServerRequest *request) {
+    if (!request->hasParam("id")) {
+        request->send(400, "application/json", "{\"error\":\"Missing id parameter\"}");
+        return;
+    }
+    RpcHandle h = {strtoull(request->getParam("id")->value().c_str(), nullptr, 10)};
+    Rpc& rpc = ModuleRegistry::getInstance()->rpc();
+    if (request->hasParam("cancel")) {
+        bool ok = rpc.cancel(h);
+        request->send(ok ? 200 : 404, "application/json", ok ? "{\"status\":\"cancelled\"}" : "{\"error\":\"Unknown call id\"}");
+        return;
+    }
+    String result;
+    RpcStatus st = rpc.poll(h, &result);
+    if (st == RPC_UNKNOWN) {
+        request->send(404, "application/json", "{\"error\":\"Unknown call id\"}");
+        return;
+    }
+    DynamicJsonDocument response(1024);
+    response["status"] = rpcStatusName(st);
+    if (st == RPC_OK || st == RPC_FAILED) response["result"] = result;
+    String out;
+    serializeJson(response, out);
+    request->send(st == RPC_PENDING ? 202 : 200, "application/json", out);
+}
+
 void CONTROL_WEB::handleAPIModuleCommand(AsyncWebServerRequest *request) {
     if (!request->hasParam("module") || !request->hasParam("command")) {
         request->send(400, "application/json", "{\"error\":\"Missing module or command parameter\"}");
@@ -693,9 +806,8 @@ void CONTROL_WEB::handleAPIModuleCommand(AsyncWebServerRequest *request) {
         return;
     } else if (command == "clearlogs") {
         // Clear logs for this module (if FS is available)
-        Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-        if (fsModule) {
-            CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+        CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+        if (fs) {
             String logFile = "/logs/" + moduleName + ".log";
             success = fs->writeFile(logFile, ""); // Clear the log file
             message = success ? "Module logs cleared" : "Failed to clear module logs";
@@ -728,13 +840,11 @@ void CONTROL_WEB::handleAPIModuleCommand(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPIConfigBackup(AsyncWebServerRequest *request) {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (!fsModule) {
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (!fs) {
         request->send(503, "application/json", "{\"error\":\"FS module not available\"}");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     ConfigManager* configManager = fs->getConfigManager();
     
     if (!configManager) {
@@ -755,13 +865,11 @@ void CONTROL_WEB::handleAPIConfigBackup(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPIConfigValidate(AsyncWebServerRequest *request) {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (!fsModule) {
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (!fs) {
         request->send(503, "application/json", "{\"error\":\"FS module not available\"}");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     ConfigManager* configManager = fs->getConfigManager();
     
     if (!configManager) {
@@ -782,13 +890,11 @@ void CONTROL_WEB::handleAPIConfigValidate(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPIConfigExport(AsyncWebServerRequest *request) {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (!fsModule) {
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (!fs) {
         request->send(503, "application/json", "{\"error\":\"FS module not available\"}");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     ConfigManager* configManager = fs->getConfigManager();
     
     if (!configManager) {
@@ -815,13 +921,11 @@ void CONTROL_WEB::handleAPIConfigImport(AsyncWebServerRequest *request) {
     
     String configData = request->getParam("plain", true)->value();
     
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (!fsModule) {
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (!fs) {
         request->send(503, "application/json", "{\"error\":\"FS module not available\"}");
         return;
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     ConfigManager* configManager = fs->getConfigManager();
     
     if (!configManager) {
@@ -891,7 +995,7 @@ void CONTROL_WEB::handleAPISystemInfo(AsyncWebServerRequest *request) {
 }
 
 void CONTROL_WEB::handleAPISystemStats(AsyncWebServerRequest *request) {
-    DynamicJsonDocument doc(2048);
+    DynamicJsonDocument doc(12288);
     
     // Module statistics
     JsonArray modules = doc["modules"].to<JsonArray>();
@@ -902,16 +1006,29 @@ void CONTROL_WEB::handleAPISystemStats(AsyncWebServerRequest *request) {
         modStats["priority"] = mod->getPriority();
         modStats["auto_start"] = mod->isAutoStart();
         modStats["version"] = mod->getVersion();
+        if (mod->getQueue()) mod->getQueue()->toJson(modStats.createNestedObject("queue"));
+        mod->cpuToJson(modStats.createNestedObject("cpu"));
         
         // Get detailed status
         DynamicJsonDocument status = mod->getStatus();
         modStats["status"] = status;
     }
     
+    // Event bus topics: published / delivered / dropped per topic
+    ModuleRegistry::getInstance()->bus().toJson(doc["bus"].to<JsonObject>());
+    ModuleRegistry::getInstance()->rpc().toJson(doc["rpc"].to<JsonObject>());
+    // FreeRTOS run time per task and core since the previous request
+    cpuMonitor.sample(doc["cpu"].to<JsonObject>());
+    // Stack sizes: configured vs profiled, peak use
+    ModuleManager::getInstance()->getStackProfiler().toJson(doc["stacks"].to<JsonObject>());
+    // Shared worker pool: per-worker jobs, steals and busy time
+    WorkerPool::global().toJson(doc["workers"].to<JsonObject>());
+    // Task-less modules on loop(): cadence, lateness and overruns
+    ModuleManager::getInstance()->getScheduler().toJson(doc["scheduler"].to<JsonArray>());
+    
     // ConfigManager statistics if available
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (fsModule) {
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (fs) {
         ConfigManager* configManager = fs->getConfigManager();
         if (configManager) {
             JsonObject configStats = doc["config_manager"].to<JsonObject>();
@@ -929,6 +1046,58 @@ void CONTROL_WEB::handleAPISystemStats(AsyncWebServerRequest *request) {
     request->send(200, "application/json", response);
 }
 
+void CONTROL_WEB::handleAPISystemCores(AsyncWebServerRequest *request) {
+    ModuleManager* mm = ModuleManager::getInstance();
+    DynamicJsonDocument doc(3072);
+    mm->getCorePlanner().plan(mm->getModules(), doc.to<JsonObject>());
+    if (request->hasParam("save")) {
+        String error;
+        bool saved = mm->getCorePlanner().save(mm->getModules(), &error);
+        doc["saved"] = saved;
+        if (!saved) doc["save_error"] = error;
+    }
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void CONTROL_WEB::handleAPISystemPeriodic(AsyncWebServerRequest *request) {
+    if (request->hasParam("reset")) PeriodMonitor::global().resetAll();
+    DynamicJsonDocument doc(4096);
+    PeriodMonitor::global().toJson(doc["activities"].to<JsonArray>());
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void CONTROL_WEB::handleAPISystemVars(AsyncWebServerRequest *request) {
+    DynamicJsonDocument doc(4096);
+    ModuleRegistry::getInstance()->vars().toJson(doc["vars"].to<JsonArray>());
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void CONTROL_WEB::handleAPISystemBoot(AsyncWebServerRequest *request) {
+    DynamicJsonDocument doc(3072);
+    ModuleManager::getInstance()->getBootGraph().toJson(doc.to<JsonObject>());
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void CONTROL_WEB::handleAPISystemTrace(AsyncWebServerRequest *request) {
+#ifdef SYSTEM_TRACE
+    // Written straight into the response, no JsonDocument copy of the whole trace
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    Trace::global().writeChromeJson(*response);
+    if (request->hasParam("clear") && request->getParam("clear")->value() == "1") Trace::global().clear();
+    request->send(response);
+#else
+    request->send(501, "application/json", "{\"error\":\"tracing disabled, build with -DSYSTEM_TRACE\"}");
+#endif
+}
+
 void CONTROL_WEB::handleAPISafetyLimits(AsyncWebServerRequest *request) {
     DynamicJsonDocument doc(512);
     
@@ -963,9 +1132,8 @@ void CONTROL_WEB::handleAPISafetyStatus(AsyncWebServerRequest *request) {
     status["backup_available"] = false; // Will be updated below
     
     // Check if backup is available
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
-    if (fsModule) {
-        CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
+    if (fs) {
         ConfigManager* configManager = fs->getConfigManager();
         if (configManager) {
             ConfigManager::ConfigStats stats = configManager->getStatistics();
@@ -983,7 +1151,7 @@ String CONTROL_WEB::getModulesHTML() {
     html += "<table>";
     html += "<tr><th>Module</th><th>State</th><th>Priority</th><th>Version</th><th>Auto Start</th></tr>";
     
-    auto modules = ModuleManager::getInstance()->getModules();
+    const auto& modules = ModuleManager::getInstance()->getModules();
     for (Module* mod : modules) {
         html += "<tr>";
         html += "<td>" + mod->getName() + "</td>";
@@ -999,13 +1167,11 @@ String CONTROL_WEB::getModulesHTML() {
 }
 
 String CONTROL_WEB::getLogsHTML() {
-    Module* fsModule = ModuleManager::getInstance()->getModule("CONTROL_FS");
+    CONTROL_FS* fs = ModuleManager::getInstance()->getFS();
     
-    if (!fsModule) {
+    if (!fs) {
         return "<p>FS module not available</p>";
     }
-    
-    CONTROL_FS* fs = static_cast<CONTROL_FS*>(fsModule);
     String logs = fs->readLogs(100);
     
     String html = "<pre>" + logs + "</pre>";
@@ -1015,7 +1181,7 @@ String CONTROL_WEB::getLogsHTML() {
 String CONTROL_WEB::getConfigHTML() {
     String html = "<h2>Module Configuration</h2>";
     
-    auto modules = ModuleManager::getInstance()->getModules();
+    const auto& modules = ModuleManager::getInstance()->getModules();
     for (Module* mod : modules) {
         html += "<div class='module'>";
         html += "<h3>" + mod->getName() + "</h3>";
@@ -12,6 +12,9 @@
 #include "../ModuleManager.h"
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
+#include "../../include/CpuMonitor.h"
+
+class CONTROL_WIFI;
 
 /**
  * @class CONTROL_WEB
@@ -24,10 +27,18 @@
  */
 class CONTROL_WEB : public Module {
 private:
+    ModuleHandle<CONTROL_WIFI> wifiHandle{"CONTROL_WIFI"};
     AsyncWebServer* server;
     bool serverRunning;
     uint16_t port;
     
+    // Latest radar sample, delivered as web_radar_update (coalesced by the mailbox)
+    struct RadarSnapshot { int d; float v; int dir; int ang; int type; bool valid; };
+    RadarSnapshot radarSnap;
+    portMUX_TYPE radarSnapLock;
+    // Task/core loads for /api/system/stats, measured between requests
+    CpuMonitor cpuMonitor;
+    
     // Setup routes
     void setupRoutes();
     void setupAPIRoutes();
@@ -48,12 +59,19 @@ private:
     void handleAPIModuleSet(AsyncWebServerRequest *request);
     void handleAPIModuleAutostart(AsyncWebServerRequest *request);
     void handleAPIModuleCommand(AsyncWebServerRequest *request);
+    void handleAPIModuleCall(AsyncWebServerRequest *request);
+    void handleAPIModuleResult(AsyncWebServerRequest *request);
     void handleAPIConfigBackup(AsyncWebServerRequest *request);
     void handleAPIConfigValidate(AsyncWebServerRequest *request);
     void handleAPIConfigExport(AsyncWebServerRequest *request);
     void handleAPIConfigImport(AsyncWebServerRequest *request);
     void handleAPISystemInfo(AsyncWebServerRequest *request);
     void handleAPISystemStats(AsyncWebServerRequest *request);
+    void handleAPISystemCores(AsyncWebServerRequest *request);
+    void handleAPISystemPeriodic(AsyncWebServerRequest *request);
+    void handleAPISystemVars(AsyncWebServerRequest *request);
+    void handleAPISystemBoot(AsyncWebServerRequest *request);
+    void handleAPISystemTrace(AsyncWebServerRequest *request);
     void handleAPISafetyLimits(AsyncWebServerRequest *request);
     void handleAPISafetyStatus(AsyncWebServerRequest *request);
     void handleAPILogs(AsyncWebServerRequest *request);
@@ -75,6 +93,8 @@ public:
     bool start() override;
     bool stop() override;
     bool update() override;
+    uint32_t nextDeadlineMs() override;
+    void handleMessage(QueueMessage* msg) override;
     bool test() override;
     DynamicJsonDocument getStatus() override;
     
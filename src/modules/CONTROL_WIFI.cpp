@@ -1,10 +1,16 @@
 #include "CONTROL_WIFI.h"
+#include "../../include/ModuleRegistry.h"
+#include "../../include/Trace.h"
 
 CONTROL_WIFI::CONTROL_WIFI() : Module("CONTROL_WIFI") {
     wifiInitialized = false;
     isConnected = false;
     lastConnectionCheck = 0;
     reconnectInterval = 30000; // 30 seconds
+    lastRssiMs = 0;
+    VarStore& vars = ModuleRegistry::getInstance()->vars();
+    rssiVar = vars.define("CONTROL_WIFI", "rssi", VAR_INT);
+    connectedVar = vars.define("CONTROL_WIFI", "connected", VAR_BOOL);
     
     // Default configuration
     config.ssid = "ESP32-AP";
@@ -118,13 +124,28 @@ bool CONTROL_WIFI::update() {
                     // Try to reconnect
                     reconnect();
                 }
+                ModuleRegistry::getInstance()->vars().setBool(connectedVar, isConnected);
             }
         }
     }
+    if (millis() - lastRssiMs >= WIFI_RSSI_INTERVAL_MS) {
+        lastRssiMs = millis();
+        VarStore& vars = ModuleRegistry::getInstance()->vars();
+        vars.setInt(rssiVar, getRSSI());
+        vars.setBool(connectedVar, isConnected);  // also picks up start()/stop()
+    }
     
     return true;
 }
 
+uint32_t CONTROL_WIFI::nextDeadlineMs() {
+    unsigned long elapsed = millis() - lastConnectionCheck;
+    uint32_t wait = elapsed > reconnectInterval ? 0 : (uint32_t)(reconnectInterval - elapsed + 1);
+    unsigned long sinceRssi = millis() - lastRssiMs;
+    uint32_t rssiWait = sinceRssi >= WIFI_RSSI_INTERVAL_MS ? 0 : (uint32_t)(WIFI_RSSI_INTERVAL_MS - sinceRssi);
+    return rssiWait < wait ? rssiWait : wait;
+}
+
 bool CONTROL_WIFI::test() {
     log("Testing WiFi...");
     
@@ -147,7 +168,7 @@ bool CONTROL_WIFI::test() {
 }
 
 DynamicJsonDocument CONTROL_WIFI::getStatus() {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1536);
     
     doc["module"] = moduleName;
     doc["state"] = state == MODULE_ENABLED ? "enabled" : "disabled";
@@ -174,6 +195,7 @@ DynamicJsonDocument CONTROL_WIFI::getStatus() {
     
     doc["mac"] = WiFi.macAddress();
     
+    cpuToJson(doc.createNestedObject("cpu"));
     return doc;
 }
 
@@ -221,6 +243,7 @@ bool CONTROL_WIFI::setMode(CustomWiFiMode mode) {
 }
 
 bool CONTROL_WIFI::startAP() {
+    TRACE_SCOPE("wifi", "start AP");
     log("Starting Access Point...");
     
     WiFi.mode(WIFI_AP);
@@ -266,6 +289,7 @@ bool CONTROL_WIFI::startClient() {
 }
 
 bool CONTROL_WIFI::connectToNetwork() {
+    TRACE_SCOPE("wifi", "connect");
     log("Connecting to: " + config.ssid);
     
     WiFi.begin(config.ssid.c_str(), config.password.c_str());
@@ -12,6 +12,9 @@
 #include "../ModuleManager.h"
 #include <WiFi.h>
 
+// How often RSSI is republished to the registry's VarStore while connected
+#define WIFI_RSSI_INTERVAL_MS 2000
+
 /**
  * @enum CustomWiFiMode
  * @brief Operating modes for WiFi subsystem.
@@ -66,6 +69,9 @@ private:
     bool isConnected;
     unsigned long lastConnectionCheck;
     unsigned long reconnectInterval;
+    unsigned long lastRssiMs;
+    VarId rssiVar;       // CONTROL_WIFI.rssi
+    VarId connectedVar;  // CONTROL_WIFI.connected
     
     bool startAP();
     bool startClient();
@@ -83,6 +89,7 @@ public:
     bool stop() override;
     /** @brief Periodic WiFi maintenance and reconnection checks. @return True if work done. */
     bool update() override;
+    uint32_t nextDeadlineMs() override;
     /** @brief Run self-test for WiFi module. @return True if tests pass. */
     bool test() override;
     /** @brief Current WiFi status as JSON. @return Status document. */
@@ -109,6 +116,8 @@ public:
     
     /** @brief Connection state flag. @return True if connected (client mode). */
     bool isWiFiConnected() { return isConnected; }
+    // Dependents (CONTROL_WEB) run only while connected (or serving the AP)
+    bool isReady() override { return state == MODULE_ENABLED && isConnected; }
     /** @brief Current SSID. @return SSID string. */
     String getSSID();
     /** @brief Current IP address. @return IP as string. */
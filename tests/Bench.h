@@ -0,0 +1,50 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * Shared fixture of the benchmarks in tests/: timers, a sink the optimizer
+ * cannot drop, and the module/function set the dispatch benchmarks register
+ * (CONTROL_LCD's calls among the stock modules). Builds on the host
+ * (std::chrono) and on the board (esp_timer).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+static volatile uint32_t benchSink = 0;
+
+static const char* const kBenchModules[] = {"CONTROL_FS", "CONTROL_WIFI", "CONTROL_SERIAL", "CONTROL_WEB", "CONTROL_RADAR", "CONTROL_LCD"};
+static const size_t kBenchModuleCount = sizeof(kBenchModules) / sizeof(kBenchModules[0]);
+static const char* const kBenchFunctions[] = {"lcd_log_append", "lcd_radar_update", "lcd_status", "lcd_text", "lcd_boot_step"};
+static const size_t kBenchFunctionCount = sizeof(kBenchFunctions) / sizeof(kBenchFunctions[0]);
+
+static inline double benchNowNs() {
+#ifdef ARDUINO
+  return esp_timer_get_time() * 1000.0;
+#else
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Average ns of body(i) over i = 0 .. iterations-1.
+template <typename F>
+static double nsPerOp(size_t iterations, F body) {
+  double t0 = benchNowNs();
+  for (size_t i = 0; i < iterations; i++) body(i);
+  return (benchNowNs() - t0) / iterations;
+}
+
+// ns per item of a single body() that processes items items.
+template <typename F>
+static double nsPerItem(size_t items, F body) {
+  double t0 = benchNowNs();
+  body();
+  return (benchNowNs() - t0) / items;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * EVAL bytecode microbenchmark (host)
+ *
+ * Per-call cost of an EVAL registry function against the same logic written
+ * as a native function (registerFunctionPointer). Both read their parameters
+ * from a DynamicJsonDocument and return text, as ModuleRegistry::invoke does;
+ * the EVAL side binds the document through the registry's JsonEvalEnv and
+ * runs the program compiled once up front.
+ *
+ * Build and run on the host:
+ *   g++ -std=gnu++11 -O2 -Iinclude -I.pio/libdeps/esp32dev/ArduinoJson/src src/EvalVm.cpp tests/EvalVm_Benchmark.cpp -o /tmp/eval_bench && /tmp/eval_bench
+ */
+
+#include <ArduinoJson.h>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include "EvalVm.h"
+#include "JsonEvalEnv.h"
+#include "Bench.h"
+
+typedef std::function<bool(void*, DynamicJsonDocument*, std::string&)> Fn;
+
+static bool callEval(const EvalProgram& p, DynamicJsonDocument* params, std::string& result) {
+  JsonEvalEnv env(params);
+  char out[EVAL_OUTPUT_MAX];
+  bool ok = p.run(env, out, sizeof(out)) == EVAL_OK;
+  result = out;
+  return ok;
+}
+
+static const char* kThreshold = "return $distance_cm < $limit";
+static bool nativeThreshold(void*, DynamicJsonDocument* params, std::string& result) {
+  float d = (*params)["distance_cm"];
+  float limit = (*params)["limit"];
+  result = d < limit ? "1" : "0";
+  return true;
+}
+
+static const char* kConvert =
+    "c = ($f - 32) * 5 / 9\n"
+    "if (c > $limit) { return fmt(\"HOT %.1f C\", c) }\n"
+    "return clamp(round(c), 0, 100)";
+static bool nativeConvert(void*, DynamicJsonDocument* params, std::string& result) {
+  float c = ((float)(*params)["f"] - 32) * 5 / 9;
+  char out[EVAL_OUTPUT_MAX];
+  if (c > (float)(*params)["limit"]) snprintf(out, sizeof(out), "HOT %.1f C", c);
+  else snprintf(out, sizeof(out), "%ld", (long)std::min(std::max(roundf(c), 0.0f), 100.0f));
+  result = out;
+  return true;
+}
+
+static bool bench(const char* label, const char* source, Fn native, DynamicJsonDocument& doc, size_t n) {
+  EvalProgram p;
+  if (!p.compile(source)) {
+    printf("%s: compile failed: %s\n", label, p.error().c_str());
+    return false;
+  }
+  std::string a, b;
+  native(nullptr, &doc, a);
+  callEval(p, &doc, b);
+  if (a != b) {
+    printf("%s: results differ: native '%s' eval '%s'\n", label, a.c_str(), b.c_str());
+    return false;
+  }
+  double nativeNs = nsPerOp(n, [&](size_t) { native(nullptr, &doc, a); });
+  double evalNs = nsPerOp(n, [&](size_t) { callEval(p, &doc, b); });
+  printf("%-11s native %7.1f ns/call | eval %7.1f ns/call (%zu instructions) | %.1fx\n", label, nativeNs, evalNs,
+         p.instructions(), evalNs / nativeNs);
+  return true;
+}
+
+int main() {
+  const size_t N = 1000000;
+  DynamicJsonDocument doc(256);
+  doc["distance_cm"] = 42.5;
+  doc["limit"] = 50;
+  doc["f"] = 98.6;
+
+  bool ok = bench("threshold", kThreshold, nativeThreshold, doc, N);
+  ok = bench("convert", kConvert, nativeConvert, doc, N) && ok;
+  doc["f"] = 212;
+  ok = bench("convert/hot", kConvert, nativeConvert, doc, N) && ok;
+  return ok ? 0 : 1;
+}
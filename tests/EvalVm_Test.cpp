@@ -0,0 +1,114 @@
+/**
+ * EvalVm unit tests (host)
+ *
+ * Compiles small programs and checks their results, $parameter writes,
+ * failure paths and that malformed source is rejected with an error.
+ *
+ * Build and run on the host:
+ *   g++ -std=gnu++11 -O2 -Iinclude src/EvalVm.cpp tests/EvalVm_Test.cpp -o /tmp/eval_test && /tmp/eval_test
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include "EvalVm.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                \
+    }                                                            \
+  } while (0)
+
+struct MapEnv : EvalEnv {
+  std::map<std::string, float> vars;
+  bool get(const char* name, float& out) override {
+    std::map<std::string, float>::iterator it = vars.find(name);
+    if (it == vars.end()) return false;
+    out = it->second;
+    return true;
+  }
+  void set(const char* name, float value) override { vars[name] = value; }
+};
+
+static std::string run(const char* source, MapEnv& env, EvalStatus expect = EVAL_OK) {
+  EvalProgram p;
+  if (!p.compile(source)) {
+    printf("compile failed for '%s': %s\n", source, p.error().c_str());
+    failures++;
+    return "";
+  }
+  char out[EVAL_OUTPUT_MAX];
+  CHECK(p.run(env, out, sizeof(out)) == expect);
+  return out;
+}
+
+static void testExpressions() {
+  MapEnv env;
+  env.vars["x"] = 7;
+  CHECK(run("return 1 + 2 * 3", env) == "7");
+  CHECK(run("return (1 + 2) * 3", env) == "9");
+  CHECK(run("return $x % 4", env) == "3");
+  CHECK(run("return $x / 2", env) == "3.5");
+  CHECK(run("return -$x", env) == "-7");
+  CHECK(run("return $x > 5 && !($x > 10)", env) == "1");
+  CHECK(run("return $x < 5 || false", env) == "0");
+  CHECK(run("return $x >= 7 ? 10 : 20", env) == "10");
+  CHECK(run("return max(min($x, 3), 1) + abs(-2)", env) == "5");
+  CHECK(run("return clamp($x, 0, 5) + floor(1.7) + ceil(1.2)", env) == "8");
+  CHECK(run("return round(2.5) + sqrt(16)", env) == "7");
+  CHECK(run("return $missing", env) == "0");
+}
+
+static void testStatements() {
+  MapEnv env;
+  env.vars["f"] = 212;
+  env.vars["limit"] = 50;
+  const char* src =
+      "c = ($f - 32) * 5 / 9\n"
+      "if (c > $limit) { $alarm = 1; return fmt(\"HOT %.1f C\", c) }\n"
+      "else { $alarm = 0 }\n"
+      "return c";
+  CHECK(run(src, env) == "HOT 100.0 C");
+  CHECK(env.vars["alarm"] == 1);
+  env.vars["f"] = 50;
+  CHECK(run(src, env) == "10");
+  CHECK(env.vars["alarm"] == 0);
+  CHECK(run("return \"done\"", env) == "done");
+  CHECK(run("$y = 3", env) == "");
+  CHECK(env.vars["y"] == 3);
+  CHECK(run("if ($f > 100) fail; return 1", env) == "1");
+  env.vars["f"] = 150;
+  run("if ($f > 100) fail; return 1", env, EVAL_FAILED);
+}
+
+static void testErrors() {
+  const char* bad[] = {"return (1 + 2", "x = ", "return foo(1)", "return fmt(\"%d\", 1)", "if 1 return 2", "return \"open"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    EvalProgram p;
+    CHECK(!p.compile(bad[i]));
+    CHECK(!p.valid());
+    CHECK(!p.error().empty());
+  }
+  // A failed compile leaves no program behind
+  EvalProgram p;
+  CHECK(p.compile("return 1"));
+  CHECK(!p.compile("return +"));
+  CHECK(!p.valid());
+}
+
+int main() {
+  testExpressions();
+  testStatements();
+  testErrors();
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("EvalVm: all tests passed\n");
+  return 0;
+}
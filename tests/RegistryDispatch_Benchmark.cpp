@@ -0,0 +1,163 @@
+/**
+ * Registry dispatch benchmark (on device)
+ *
+ * Times the real ModuleRegistry against a copy of its string-keyed
+ * predecessor (BaselineFunctions below: "module:function" String key,
+ * std::map lookup, the entry copied out, the module found by a name scan of
+ * ModuleManager, a NAME handler resolved through callFunctionByName). Six
+ * modules are registered with the stock names and CONTROL_LCD's five calls
+ * are registered both ways, as the baseline and the current CONTROL_LCD do.
+ *
+ * Queue dispatch: a pooled-style message (callName and callId set) handed to
+ * Module::handleMessage, and to call(handle, msg) as CONTROL_LCD does for its
+ * hot calls, against what CONTROL_LCD::update used to do with it.
+ * Direct calls: callFunction(moduleName, functionName) and call(handle)
+ * against the baseline's by-name call.
+ *
+ * Build, flash and read the results (the sketch replaces src/main.cpp):
+ *   pio run -e esp32dev-bench -t upload && pio device monitor
+ */
+
+// include/ has an unrelated ModuleManager.h
+#include "../src/ModuleManager.h"
+#include "ModuleRegistry.h"
+#include "Bench.h"
+#include <functional>
+#include <map>
+
+static bool benchHandler(void*, DynamicJsonDocument*, String&) {
+    benchSink++;
+    return true;
+}
+
+class BenchModule : public Module {
+public:
+    explicit BenchModule(const char* name) : Module(name) {}
+    bool init() override { return true; }
+    bool start() override { return true; }
+    bool stop() override { return true; }
+    bool update() override { return true; }
+    bool test() override { return true; }
+    DynamicJsonDocument getStatus() override { return DynamicJsonDocument(64); }
+    // CONTROL_LCD's NAME handler chain
+    bool callFunctionByName(const String& name, DynamicJsonDocument* params, String& result) override {
+        if (name == "fn_lcd_log_append") return benchHandler(this, params, result);
+        if (name == "fn_lcd_radar_update") return benchHandler(this, params, result);
+        if (name == "fn_lcd_status") return benchHandler(this, params, result);
+        if (name == "fn_lcd_text") return benchHandler(this, params, result);
+        if (name == "fn_lcd_boot_step") return benchHandler(this, params, result);
+        return false;
+    }
+};
+
+// ModuleManager::getModule before interning
+static Module* baselineGetModule(const String& name) {
+    for (auto* mod : ModuleManager::getInstance()->getModules()) {
+        if (mod->getName() == name) {
+            return mod;
+        }
+    }
+    return nullptr;
+}
+
+// ModuleRegistry::Functions before interning
+class BaselineFunctions {
+public:
+    enum CallType { NAME = 0, POINTER = 1, DYNAMIC = 2 };
+    struct FunctionEntry {
+        String moduleName;
+        String functionName;
+        String handleName;
+        CallType callType;
+        std::function<bool(void*, DynamicJsonDocument*, String&)> func;
+        String evalCode;
+    };
+
+    static String keyOf(const String& moduleName, const String& functionName) { return moduleName + String(":") + functionName; }
+    FunctionEntry get(const String& key) const { auto it = entries_.find(key); return it != entries_.end() ? it->second : FunctionEntry{}; }
+
+    void registerFunctionName(const String& moduleName, const String& functionName, const String& handleName) {
+        FunctionEntry fe; fe.moduleName = moduleName; fe.functionName = functionName; fe.handleName = handleName; fe.callType = NAME;
+        entries_[keyOf(moduleName, functionName)] = fe;
+    }
+
+    bool call(const String& moduleName, const String& functionName, DynamicJsonDocument* params, String& result) {
+        FunctionEntry fe = get(keyOf(moduleName, functionName));
+        Module* mod = baselineGetModule(moduleName);
+        void* ctx = (void*)mod;
+        bool ok = false;
+        if (fe.callType == NAME) {
+            if (mod) ok = mod->callFunctionByName(fe.handleName.length() ? fe.handleName : functionName, params, result);
+        } else if (fe.callType == POINTER || fe.callType == DYNAMIC) {
+            if (fe.func) ok = fe.func(ctx, params, result);
+        }
+        return ok;
+    }
+
+private:
+    std::map<String, FunctionEntry> entries_;
+};
+
+static BaselineFunctions baseline;
+static const size_t kIterations = 20000;
+
+static void report(const char* label, double oldNs, double newNs) {
+    Serial.printf("%-16s baseline %8.0f ns | ModuleRegistry %8.0f ns | %.1fx\n", label, oldNs, newNs, oldNs / newNs);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    ModuleManager* mm = ModuleManager::getInstance();
+    for (size_t i = 0; i < kBenchModuleCount; i++) mm->registerModule(new BenchModule(kBenchModules[i]));
+    Module* lcd = mm->getModule("CONTROL_LCD");
+
+    ModuleRegistry* reg = ModuleRegistry::getInstance();
+    FunctionHandle handles[kBenchFunctionCount];
+    String names[kBenchFunctionCount];
+    for (size_t f = 0; f < kBenchFunctionCount; f++) {
+        names[f] = kBenchFunctions[f];
+        baseline.registerFunctionName(lcd->getName(), names[f], String("fn_") + names[f]);
+        handles[f] = reg->registerFunctionPointer(lcd->getName(), names[f], benchHandler);
+    }
+
+    DynamicJsonDocument params(64);
+    QueueMessage msgs[kBenchFunctionCount] = {};
+    for (size_t f = 0; f < kBenchFunctionCount; f++) {
+        msgs[f].toQueue = lcd->getName();
+        msgs[f].fromQueue = "bench";
+        msgs[f].callName = kBenchFunctions[f];
+        msgs[f].callVariables = &params;
+        msgs[f].toId = lcd->getId();
+        msgs[f].callId = SymbolTable::global().intern(kBenchFunctions[f]);
+    }
+
+    double oldMsg = nsPerOp(kIterations, [&](size_t i) {
+        QueueMessage* m = &msgs[i % kBenchFunctionCount];
+        String result;
+        baseline.call(lcd->getName(), m->callName, m->callVariables, result);
+    });
+    double newMsg = nsPerOp(kIterations, [&](size_t i) { lcd->handleMessage(&msgs[i % kBenchFunctionCount]); });
+    double handleMsg = nsPerOp(kIterations, [&](size_t i) {
+        String result;
+        reg->call(handles[i % kBenchFunctionCount], &msgs[i % kBenchFunctionCount], result);
+    });
+
+    String result;
+    double oldName = nsPerOp(kIterations, [&](size_t i) { baseline.call(lcd->getName(), names[i % kBenchFunctionCount], &params, result); });
+    double newName = nsPerOp(kIterations, [&](size_t i) { reg->callFunction(lcd->getName(), names[i % kBenchFunctionCount], &params, result); });
+    double handleNs = nsPerOp(kIterations, [&](size_t i) { reg->call(handles[i % kBenchFunctionCount], &params, result); });
+    double hashNs = nsPerOp(kIterations, [&](size_t) { benchSink += SYMBOL_ID("lcd_radar_update"); });
+
+    Serial.printf("Registry dispatch, %u calls each, %u MHz\n", (unsigned)kIterations, (unsigned)ESP.getCpuFreqMHz());
+    report("queue message", oldMsg, newMsg);
+    report("  by handle", oldMsg, handleMsg);
+    report("call by name", oldName, newName);
+    report("  by handle", oldName, handleNs);
+    Serial.printf("SYMBOL_ID(literal) %8.0f ns\n", hashNs);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,107 @@
+/**
+ * SpscRing unit tests (host)
+ *
+ * Covers ordering, bulk pop, wrap-around of the free-running indices,
+ * overrun counting when the ring is full, and a two-thread producer/consumer
+ * run that checks every item arrives exactly once and in order.
+ *
+ * Build and run on the host:
+ *   g++ -std=gnu++11 -O2 -pthread -Iinclude tests/SpscRing_Test.cpp -o /tmp/spsc_test && /tmp/spsc_test
+ */
+
+#include <cstdio>
+#include <thread>
+#include "SpscRing.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      failures++;                                                \
+    }                                                            \
+  } while (0)
+
+static void testOrderAndBulkPop() {
+  SpscRing<int, 8> ring;
+  CHECK(ring.empty());
+  for (int i = 0; i < 5; i++) CHECK(ring.push(i));
+  CHECK(ring.size() == 5);
+  int out[8];
+  CHECK(ring.pop(out, 3) == 3);
+  CHECK(out[0] == 0 && out[1] == 1 && out[2] == 2);
+  CHECK(ring.pop(out, 8) == 2);
+  CHECK(out[0] == 3 && out[1] == 4);
+  CHECK(ring.pop(out, 8) == 0);
+  int one;
+  CHECK(!ring.pop(one));
+}
+
+static void testOverrun() {
+  SpscRing<int, 4> ring;
+  for (int i = 0; i < 4; i++) CHECK(ring.push(i));
+  CHECK(!ring.push(99));
+  CHECK(!ring.push(100));
+  CHECK(ring.overruns() == 2);
+  CHECK(ring.pushed() == 4);
+  // Overrun drops the new item, the oldest ones survive
+  int out[4];
+  CHECK(ring.pop(out, 4) == 4);
+  CHECK(out[0] == 0 && out[3] == 3);
+  CHECK(ring.push(5));
+  CHECK(ring.pop(out[0]) && out[0] == 5);
+}
+
+static void testWrapAround() {
+  SpscRing<uint32_t, 16> ring;
+  uint32_t next = 0, expect = 0;
+  uint32_t out[16];
+  for (int round = 0; round < 1000; round++) {
+    for (int i = 0; i < 11; i++) CHECK(ring.push(next++));
+    size_t n = ring.pop(out, 16);
+    CHECK(n == 11);
+    for (size_t i = 0; i < n; i++) CHECK(out[i] == expect++);
+  }
+  CHECK(ring.overruns() == 0);
+}
+
+static void testThreads() {
+  static SpscRing<uint32_t, 256> ring;
+  const uint32_t N = 2000000;
+  std::thread producer([&]() {
+    for (uint32_t i = 0; i < N;) {
+      if (ring.push(i)) i++;
+      else std::this_thread::yield();
+    }
+  });
+  uint32_t expect = 0;
+  bool ordered = true;
+  uint32_t out[64];
+  while (expect < N) {
+    size_t n = ring.pop(out, 64);
+    if (!n) std::this_thread::yield();
+    for (size_t i = 0; i < n; i++) {
+      if (out[i] != expect) ordered = false;
+      expect++;
+    }
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(expect == N);
+  CHECK(ring.empty());
+  CHECK(ring.pushed() == N);
+}
+
+int main() {
+  testOrderAndBulkPop();
+  testOverrun();
+  testWrapAround();
+  testThreads();
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("SpscRing: all tests passed\n");
+  return 0;
+}